@@ -0,0 +1,191 @@
+/*
+    SPDX-FileCopyrightText: 2022 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#include "kwindowinfo.h"
+#include "kwindowsystem.h"
+#include "nettesthelper.h"
+#include "netwm.h"
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+#include <private/qtx11extras_p.h>
+#else
+#include <QX11Info>
+#endif
+#include <qtest_widgets.h>
+
+#include <xcb/xcb_icccm.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static const int s_windowCount = 200;
+static const NET::Properties s_properties = NET::WMName | NET::WMVisibleName | NET::WMDesktop | NET::WMWindowType | NET::WMState | NET::WMGeometry;
+static const NET::Properties2 s_properties2 = NET::WM2WindowClass | NET::WM2TransientFor;
+// all the string properties of a window
+static const NET::Properties s_stringProperties = NET::WMName | NET::WMVisibleName | NET::WMIconName | NET::WMVisibleIconName;
+static const NET::Properties2 s_stringProperties2 = NET::WM2WindowClass | NET::WM2WindowRole | NET::WM2ClientMachine | NET::WM2DesktopFileName
+    | NET::WM2GTKApplicationId | NET::WM2AppMenuObjectPath | NET::WM2AppMenuServiceName | NET::WM2Activities | NET::WM2StartupId;
+
+// counts the C++ heap allocations of the thread while enabled
+static thread_local bool s_countAllocations = false;
+static std::atomic<int> s_allocations(0);
+
+void *operator new(std::size_t size)
+{
+    if (s_countAllocations) {
+        ++s_allocations;
+    }
+    if (void *p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+class KWindowInfoX11Benchmark : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void benchmarkWindowInfoLoop();
+    void benchmarkWindowInfos();
+    void benchmarkWindowInfoAllocations();
+
+private:
+    QList<WId> m_windows;
+    xcb_window_t m_stringsWindow = XCB_WINDOW_NONE;
+};
+
+void KWindowInfoX11Benchmark::initTestCase()
+{
+    if (!KWindowSystem::isPlatformX11()) {
+        QSKIP("This test requires X11");
+    }
+    xcb_connection_t *c = QX11Info::connection();
+    KXUtils::Atom netWmName(c, QByteArrayLiteral("_NET_WM_NAME"));
+    KXUtils::Atom utf8String(c, QByteArrayLiteral("UTF8_STRING"));
+    for (int i = 0; i < s_windowCount; ++i) {
+        const xcb_window_t w = xcb_generate_id(c);
+        const uint32_t values[] = {true};
+        xcb_create_window(c,
+                          XCB_COPY_FROM_PARENT,
+                          w,
+                          QX11Info::appRootWindow(),
+                          i,
+                          i,
+                          100,
+                          100,
+                          0,
+                          XCB_COPY_FROM_PARENT,
+                          XCB_COPY_FROM_PARENT,
+                          XCB_CW_OVERRIDE_REDIRECT,
+                          values);
+        const QByteArray name = QByteArrayLiteral("benchmark window ") + QByteArray::number(i);
+        xcb_change_property(c, XCB_PROP_MODE_REPLACE, w, netWmName, utf8String, 8, name.length(), name.constData());
+        xcb_icccm_set_wm_class(c, w, 42, "kwindowinfobenchmark\0KWindowInfoBenchmark");
+        m_windows << w;
+    }
+
+    // a window with all the string properties set
+    m_stringsWindow = xcb_generate_id(c);
+    const uint32_t values[] = {true};
+    xcb_create_window(c,
+                      XCB_COPY_FROM_PARENT,
+                      m_stringsWindow,
+                      QX11Info::appRootWindow(),
+                      0,
+                      0,
+                      100,
+                      100,
+                      0,
+                      XCB_COPY_FROM_PARENT,
+                      XCB_COPY_FROM_PARENT,
+                      XCB_CW_OVERRIDE_REDIRECT,
+                      values);
+    auto setString = [c, this](const QByteArray &name, xcb_atom_t type, const QByteArray &value) {
+        KXUtils::Atom atom(c, name);
+        xcb_change_property(c, XCB_PROP_MODE_REPLACE, m_stringsWindow, atom, type, 8, value.length(), value.constData());
+    };
+    setString(QByteArrayLiteral("_NET_WM_NAME"), utf8String, QByteArrayLiteral("~/src/kwindowsystem : vim kwindowinfo.cpp"));
+    setString(QByteArrayLiteral("_NET_WM_VISIBLE_NAME"), utf8String, QByteArrayLiteral("~/src/kwindowsystem : vim kwindowinfo.cpp <2>"));
+    setString(QByteArrayLiteral("_NET_WM_ICON_NAME"), utf8String, QByteArrayLiteral("vim kwindowinfo.cpp"));
+    setString(QByteArrayLiteral("_NET_WM_VISIBLE_ICON_NAME"), utf8String, QByteArrayLiteral("vim kwindowinfo.cpp <2>"));
+    setString(QByteArrayLiteral("WM_WINDOW_ROLE"), XCB_ATOM_STRING, QByteArrayLiteral("MainWindow#1"));
+    setString(QByteArrayLiteral("WM_CLIENT_MACHINE"), XCB_ATOM_STRING, QByteArrayLiteral("localhost"));
+    setString(QByteArrayLiteral("_KDE_NET_WM_DESKTOP_FILE"), utf8String, QByteArrayLiteral("org.kde.konsole"));
+    setString(QByteArrayLiteral("_GTK_APPLICATION_ID"), utf8String, QByteArrayLiteral("org.kde.konsole"));
+    setString(QByteArrayLiteral("_KDE_NET_WM_APPMENU_OBJECT_PATH"), XCB_ATOM_STRING, QByteArrayLiteral("/MenuBar/1"));
+    setString(QByteArrayLiteral("_KDE_NET_WM_APPMENU_SERVICE_NAME"), XCB_ATOM_STRING, QByteArrayLiteral(":1.42"));
+    setString(QByteArrayLiteral("_KDE_NET_WM_ACTIVITIES"), XCB_ATOM_STRING, QByteArrayLiteral("00000000-0000-0000-0000-000000000000"));
+    setString(QByteArrayLiteral("_NET_STARTUP_ID"), utf8String, QByteArrayLiteral("konsole-1234-host-_TIME42"));
+    xcb_icccm_set_wm_class(c, m_stringsWindow, 24, "konsole\0org.kde.konsole");
+    xcb_flush(c);
+}
+
+void KWindowInfoX11Benchmark::cleanupTestCase()
+{
+    xcb_connection_t *c = QX11Info::connection();
+    for (WId w : std::as_const(m_windows)) {
+        xcb_destroy_window(c, w);
+    }
+    xcb_destroy_window(c, m_stringsWindow);
+    xcb_flush(c);
+}
+
+void KWindowInfoX11Benchmark::benchmarkWindowInfoLoop()
+{
+    QBENCHMARK {
+        QList<KWindowInfo> infos;
+        infos.reserve(m_windows.count());
+        for (WId w : std::as_const(m_windows)) {
+            infos << KWindowInfo(w, s_properties, s_properties2);
+        }
+    }
+}
+
+void KWindowInfoX11Benchmark::benchmarkWindowInfos()
+{
+    QBENCHMARK {
+        const QList<KWindowInfo> infos = KWindowSystem::windowInfos(m_windows, s_properties, s_properties2);
+        Q_UNUSED(infos)
+    }
+}
+
+void KWindowInfoX11Benchmark::benchmarkWindowInfoAllocations()
+{
+    {
+        const KWindowInfo info(m_stringsWindow, s_stringProperties, s_stringProperties2);
+        QCOMPARE(info.name(), QStringLiteral("~/src/kwindowsystem : vim kwindowinfo.cpp"));
+        QCOMPARE(info.windowClassClass(), QByteArrayLiteral("org.kde.konsole"));
+        QCOMPARE(info.applicationMenuServiceName(), QByteArrayLiteral(":1.42"));
+    }
+
+    // the allocations to create and destroy a KWindowInfo, which don't depend on the number of strings read
+    s_allocations = 0;
+    s_countAllocations = true;
+    {
+        const KWindowInfo info(m_stringsWindow, s_stringProperties, s_stringProperties2);
+        Q_UNUSED(info)
+    }
+    s_countAllocations = false;
+    QTest::setBenchmarkResult(s_allocations, QTest::Events);
+}
+
+QTEST_MAIN(KWindowInfoX11Benchmark)
+
+#include "kwindowinfox11benchmark.moc"
@@ -9,6 +9,7 @@
 #include "nettesthelper.h"
 #include "netwm.h"
 
+#include <QFutureWatcher>
 #include <QScreen>
 #include <QSignalSpy>
 #include <QSysInfo>
@@ -59,6 +60,9 @@ private Q_SLOTS:
     void testGeometry();
     void testDesktopFileName();
     void testPid();
+    void testFetchAsync();
+    void testWindowInfos();
+    void testValidity();
 
     // actionSupported is not tested as it's too window manager specific
     // we could write a test against KWin's behavior, but that would fail on
@@ -794,6 +798,125 @@ void KWindowInfoX11Test::testPid()
     QCOMPARE(info.pid(), getpid());
 }
 
+void KWindowInfoX11Test::testFetchAsync()
+{
+    const NET::Properties properties = NET::WMName | NET::WMState | NET::XAWMState | NET::WMGeometry;
+    const NET::Properties2 properties2 = NET::WM2WindowClass;
+
+    QFutureWatcher<KWindowInfo> watcher;
+    QSignalSpy finishedSpy(&watcher, &QFutureWatcher<KWindowInfo>::finished);
+    QVERIFY(finishedSpy.isValid());
+    watcher.setFuture(KWindowInfo::fetchAsync(window->winId(), properties, properties2));
+    QVERIFY(finishedSpy.wait());
+
+    const KWindowInfo info = watcher.result();
+    const KWindowInfo reference(window->winId(), properties, properties2);
+    QCOMPARE(info.win(), window->winId());
+    QVERIFY(info.valid());
+    QCOMPARE(info.name(), QStringLiteral("kwindowinfox11test"));
+    QCOMPARE(info.name(), reference.name());
+    QCOMPARE(info.mappingState(), reference.mappingState());
+    QCOMPARE(info.geometry(), reference.geometry());
+    QCOMPARE(info.windowClassName(), reference.windowClassName());
+
+    // a window which doesn't exist still finishes the future
+    watcher.setFuture(KWindowInfo::fetchAsync(XCB_WINDOW_NONE, properties, properties2));
+    QVERIFY(finishedSpy.wait());
+    QVERIFY(!watcher.result().valid());
+}
+
+void KWindowInfoX11Test::testWindowInfos()
+{
+    const NET::Properties properties = NET::WMName | NET::WMVisibleName | NET::WMDesktop | NET::WMWindowType | NET::WMState | NET::WMGeometry;
+    const NET::Properties2 properties2 = NET::WM2WindowClass | NET::WM2TransientFor;
+    xcb_connection_t *c = QX11Info::connection();
+    KXUtils::Atom netWmName(c, QByteArrayLiteral("_NET_WM_NAME"));
+    KXUtils::Atom utf8String(c, QByteArrayLiteral("UTF8_STRING"));
+    QList<WId> windows;
+    for (int i = 0; i < 20; ++i) {
+        const xcb_window_t w = xcb_generate_id(c);
+        const uint32_t values[] = {true};
+        xcb_create_window(c,
+                          XCB_COPY_FROM_PARENT,
+                          w,
+                          QX11Info::appRootWindow(),
+                          i,
+                          i,
+                          100,
+                          100,
+                          0,
+                          XCB_COPY_FROM_PARENT,
+                          XCB_COPY_FROM_PARENT,
+                          XCB_CW_OVERRIDE_REDIRECT,
+                          values);
+        const QByteArray name = QByteArrayLiteral("window ") + QByteArray::number(i);
+        xcb_change_property(c, XCB_PROP_MODE_REPLACE, w, netWmName, utf8String, 8, name.length(), name.constData());
+        xcb_icccm_set_wm_class(c, w, 32, "kwindowinfotest\0KWindowInfoTest");
+        windows << w;
+    }
+    xcb_flush(c);
+
+    const QList<KWindowInfo> infos = KWindowSystem::windowInfos(windows, properties, properties2);
+    QCOMPARE(infos.count(), windows.count());
+    for (int i = 0; i < infos.count(); ++i) {
+        const KWindowInfo single(windows.at(i), properties, properties2);
+        const KWindowInfo &bulk = infos.at(i);
+        QCOMPARE(bulk.win(), windows.at(i));
+        QCOMPARE(bulk.valid(true), single.valid(true));
+        QCOMPARE(bulk.name(), single.name());
+        QCOMPARE(bulk.name(), QStringLiteral("window %1").arg(i));
+        QCOMPARE(bulk.windowClassName(), single.windowClassName());
+        QCOMPARE(bulk.windowClassClass(), QByteArrayLiteral("KWindowInfoTest"));
+        QCOMPARE(bulk.geometry(), single.geometry());
+        QCOMPARE(bulk.geometry(), QRect(i, i, 100, 100));
+        QCOMPARE(bulk.desktop(), single.desktop());
+        QCOMPARE(bulk.windowType(NET::AllTypesMask), single.windowType(NET::AllTypesMask));
+    }
+
+    // an empty list must not reach the windowing system at all
+    QVERIFY(KWindowSystem::windowInfos(QList<WId>(), properties, properties2).isEmpty());
+
+    for (WId w : std::as_const(windows)) {
+        xcb_destroy_window(c, w);
+    }
+    xcb_flush(c);
+}
+
+void KWindowInfoX11Test::testValidity()
+{
+    xcb_connection_t *c = QX11Info::connection();
+    auto createWindow = [c] {
+        const xcb_window_t w = xcb_generate_id(c);
+        xcb_create_window(c, XCB_COPY_FROM_PARENT, w, QX11Info::appRootWindow(), 0, 0, 10, 10, 0, XCB_COPY_FROM_PARENT, XCB_COPY_FROM_PARENT, 0, nullptr);
+        return w;
+    };
+    const xcb_window_t first = createWindow();
+    const xcb_window_t destroyed = createWindow();
+    const xcb_window_t last = createWindow();
+    // only the legacy name, read in the same roundtrip as the other properties
+    xcb_change_property(c, XCB_PROP_MODE_REPLACE, first, XCB_ATOM_WM_NAME, XCB_ATOM_STRING, 8, 5, "first");
+    xcb_destroy_window(c, destroyed);
+    xcb_flush(c);
+
+    const NET::Properties properties = NET::WMName | NET::WMGeometry;
+    QVERIFY(KWindowInfo(first, properties).valid(true));
+    QCOMPARE(KWindowInfo(first, properties).name(), QStringLiteral("first"));
+    QVERIFY(!KWindowInfo(destroyed, properties).valid(true));
+
+    // the error of one window doesn't affect the others fetched together
+    const QList<KWindowInfo> infos = KWindowSystem::windowInfos({first, destroyed, last}, properties);
+    QCOMPARE(infos.count(), 3);
+    QVERIFY(infos.at(0).valid(true));
+    QCOMPARE(infos.at(0).name(), QStringLiteral("first"));
+    QVERIFY(!infos.at(1).valid(true));
+    QVERIFY(infos.at(2).valid(true));
+    QCOMPARE(infos.at(2).geometry().size(), QSize(10, 10));
+
+    xcb_destroy_window(c, first);
+    xcb_destroy_window(c, last);
+    xcb_flush(c);
+}
+
 QTEST_MAIN(KWindowInfoX11Test)
 
 #include "kwindowinfox11test.moc"
@@ -0,0 +1,182 @@
+/*
+    SPDX-FileCopyrightText: 2022 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#include "kwindowshadow.h"
+#include "kwindowsystem.h"
+
+#include <QImage>
+#include <QWindow>
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+#include <private/qtx11extras_p.h>
+#else
+#include <QX11Info>
+#endif
+#include <qtest_widgets.h>
+
+class KWindowShadowX11Benchmark : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void cleanup();
+
+    void benchmarkUpload_data();
+    void benchmarkUpload();
+    void benchmarkPopupShadows();
+    void benchmarkResize_data();
+    void benchmarkResize();
+
+private:
+    void addSizes();
+};
+
+static QImage createImage(const QSize &size)
+{
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    for (int y = 0; y < image.height(); ++y) {
+        QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+        for (int x = 0; x < image.width(); ++x) {
+            const int alpha = (x + y) & 0xff;
+            line[x] = qPremultiply(qRgba(x & 0xff, y & 0xff, 0x80, alpha));
+        }
+    }
+    return image;
+}
+
+// what a shell sets on each of its popups
+static void setPopupShadow(KWindowShadow *shadow, const QImage &corner, const QImage &edge)
+{
+    auto tile = [](const QImage &image) {
+        KWindowShadowTile::Ptr tile = KWindowShadowTile::Ptr::create();
+        tile->setImage(image);
+        return tile;
+    };
+    shadow->setTopLeftTile(tile(corner));
+    shadow->setTopTile(tile(edge));
+    shadow->setTopRightTile(tile(corner));
+    shadow->setRightTile(tile(edge));
+    shadow->setBottomRightTile(tile(corner));
+    shadow->setBottomTile(tile(edge));
+    shadow->setBottomLeftTile(tile(corner));
+    shadow->setLeftTile(tile(edge));
+    shadow->setPadding(QMargins(64, 64, 64, 64));
+}
+
+void KWindowShadowX11Benchmark::initTestCase()
+{
+    if (!KWindowSystem::isPlatformX11()) {
+        QSKIP("This test requires X11");
+    }
+}
+
+void KWindowShadowX11Benchmark::cleanup()
+{
+    qunsetenv("QT_X11_NO_MITSHM");
+}
+
+void KWindowShadowX11Benchmark::addSizes()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<bool>("shm");
+
+    // corner tiles of a shadow at scale 1, 2 and 4, a bottom edge along a 4K screen and a
+    // tile larger than a request can be even with BIG-REQUESTS
+    const QList<QSize> sizes{QSize(128, 128), QSize(256, 256), QSize(512, 512), QSize(3840, 128), QSize(2048, 2048)};
+    for (const QSize &size : sizes) {
+        QTest::addRow("%dx%d shm", size.width(), size.height()) << size << true;
+        QTest::addRow("%dx%d socket", size.width(), size.height()) << size << false;
+    }
+}
+
+void KWindowShadowX11Benchmark::benchmarkUpload_data()
+{
+    addSizes();
+}
+
+void KWindowShadowX11Benchmark::benchmarkUpload()
+{
+    QFETCH(QSize, size);
+    QFETCH(bool, shm);
+    if (!shm) {
+        qputenv("QT_X11_NO_MITSHM", "1");
+    }
+
+    xcb_connection_t *c = QX11Info::connection();
+    const QImage image = createImage(size);
+    QBENCHMARK {
+        KWindowShadowTile tile;
+        tile.setImage(image);
+        QVERIFY(tile.create());
+        // the upload through the socket doesn't wait for the server
+        free(xcb_get_input_focus_reply(c, xcb_get_input_focus(c), nullptr));
+    }
+}
+
+void KWindowShadowX11Benchmark::benchmarkPopupShadows()
+{
+    // the shadows of the popups of a shell at scale 2
+    const QImage corner = createImage(QSize(128, 128));
+    const QImage edge = createImage(QSize(1, 128));
+    QList<QWindow *> windows;
+    for (int i = 0; i < 50; ++i) {
+        windows << new QWindow;
+        windows.last()->create();
+    }
+
+    xcb_connection_t *c = QX11Info::connection();
+    QBENCHMARK {
+        QList<KWindowShadow *> shadows;
+        for (QWindow *window : std::as_const(windows)) {
+            KWindowShadow *shadow = new KWindowShadow;
+            setPopupShadow(shadow, corner, edge);
+            shadow->setWindow(window);
+            QVERIFY(shadow->create());
+            shadows << shadow;
+        }
+        free(xcb_get_input_focus_reply(c, xcb_get_input_focus(c), nullptr));
+        qDeleteAll(shadows);
+    }
+    qDeleteAll(windows);
+}
+
+void KWindowShadowX11Benchmark::benchmarkResize_data()
+{
+    QTest::addColumn<bool>("recreate");
+
+    QTest::newRow("update") << false;
+    QTest::newRow("recreate") << true;
+}
+
+void KWindowShadowX11Benchmark::benchmarkResize()
+{
+    QFETCH(bool, recreate);
+
+    // a popup animating its size changes the padding every frame
+    QWindow window;
+    window.create();
+    KWindowShadow shadow;
+    setPopupShadow(&shadow, createImage(QSize(128, 128)), createImage(QSize(1, 128)));
+    shadow.setWindow(&window);
+    QVERIFY(shadow.create());
+
+    xcb_connection_t *c = QX11Info::connection();
+    int frame = 0;
+    QBENCHMARK {
+        const int padding = 64 + (frame++ % 32);
+        shadow.setPadding(QMargins(padding, padding, padding, padding));
+        if (recreate) {
+            shadow.destroy();
+            QVERIFY(shadow.create());
+        } else {
+            QVERIFY(shadow.update());
+        }
+        free(xcb_get_input_focus_reply(c, xcb_get_input_focus(c), nullptr));
+    }
+}
+
+QTEST_MAIN(KWindowShadowX11Benchmark)
+
+#include "kwindowshadowx11benchmark.moc"
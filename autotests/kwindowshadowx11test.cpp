@@ -0,0 +1,261 @@
+/*
+    SPDX-FileCopyrightText: 2022 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#include "kwindowshadow.h"
+#include "kwindowsystem.h"
+#include "nettesthelper.h"
+
+#include <QImage>
+#include <QWindow>
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+#include <private/qtx11extras_p.h>
+#else
+#include <QX11Info>
+#endif
+#include <qtest_widgets.h>
+
+#include <cstring>
+
+class KWindowShadowX11Test : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void cleanup();
+
+    void testUpload_data();
+    void testUpload();
+    void testSharedTiles();
+    void testUpdate();
+};
+
+static QImage createImage(const QSize &size)
+{
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    for (int y = 0; y < image.height(); ++y) {
+        QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+        for (int x = 0; x < image.width(); ++x) {
+            const int alpha = (x + y) & 0xff;
+            line[x] = qPremultiply(qRgba(x & 0xff, y & 0xff, 0x80, alpha));
+        }
+    }
+    return image;
+}
+
+static QList<xcb_pixmap_t> shadowPixmaps(QWindow *window)
+{
+    xcb_connection_t *c = QX11Info::connection();
+    KXUtils::Atom atom(c, QByteArrayLiteral("_KDE_NET_WM_SHADOW"));
+    const auto cookie = xcb_get_property(c, false, window->winId(), atom, XCB_ATOM_CARDINAL, 0, 12);
+    QScopedPointer<xcb_get_property_reply_t, QScopedPointerPodDeleter> property(xcb_get_property_reply(c, cookie, nullptr));
+    if (property.isNull() || property->value_len != 12) {
+        return {};
+    }
+    // the eight tiles come first, then the padding
+    const uint32_t *data = reinterpret_cast<const uint32_t *>(xcb_get_property_value(property.data()));
+    return QList<xcb_pixmap_t>(data, data + 8);
+}
+
+static bool pixmapExists(xcb_pixmap_t pixmap)
+{
+    xcb_connection_t *c = QX11Info::connection();
+    xcb_generic_error_t *error = nullptr;
+    QScopedPointer<xcb_get_geometry_reply_t, QScopedPointerPodDeleter> reply(xcb_get_geometry_reply(c, xcb_get_geometry(c, pixmap), &error));
+    free(error);
+    return !reply.isNull();
+}
+
+// what a shell sets on each of its popups
+static void setPopupShadow(KWindowShadow *shadow, const QImage &corner, const QImage &edge)
+{
+    auto tile = [](const QImage &image) {
+        KWindowShadowTile::Ptr tile = KWindowShadowTile::Ptr::create();
+        tile->setImage(image);
+        return tile;
+    };
+    shadow->setTopLeftTile(tile(corner));
+    shadow->setTopTile(tile(edge));
+    shadow->setTopRightTile(tile(corner));
+    shadow->setRightTile(tile(edge));
+    shadow->setBottomRightTile(tile(corner));
+    shadow->setBottomTile(tile(edge));
+    shadow->setBottomLeftTile(tile(corner));
+    shadow->setLeftTile(tile(edge));
+    shadow->setPadding(QMargins(64, 64, 64, 64));
+}
+
+void KWindowShadowX11Test::initTestCase()
+{
+    if (!KWindowSystem::isPlatformX11()) {
+        QSKIP("This test requires X11");
+    }
+}
+
+void KWindowShadowX11Test::cleanup()
+{
+    qunsetenv("QT_X11_NO_MITSHM");
+}
+
+void KWindowShadowX11Test::testUpload_data()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<bool>("shm");
+
+    // a single pixel, corner tiles of a shadow at scale 1, 2 and 4, a bottom edge along a
+    // 4K screen and a tile larger than a request can be even with BIG-REQUESTS
+    const QList<QSize> sizes{QSize(1, 1), QSize(128, 128), QSize(256, 256), QSize(512, 512), QSize(3840, 128), QSize(2048, 2048)};
+    for (const QSize &size : sizes) {
+        QTest::addRow("%dx%d shm", size.width(), size.height()) << size << true;
+        QTest::addRow("%dx%d socket", size.width(), size.height()) << size << false;
+    }
+}
+
+void KWindowShadowX11Test::testUpload()
+{
+    QFETCH(QSize, size);
+    QFETCH(bool, shm);
+    if (!shm) {
+        qputenv("QT_X11_NO_MITSHM", "1");
+    }
+
+    QWindow window;
+    window.create();
+    const QImage image = createImage(size);
+    KWindowShadowTile::Ptr tile = KWindowShadowTile::Ptr::create();
+    tile->setImage(image);
+    QVERIFY(tile->create());
+
+    KWindowShadow shadow;
+    shadow.setTopTile(tile);
+    shadow.setPadding(QMargins(1, 1, 1, 1));
+    shadow.setWindow(&window);
+    QVERIFY(shadow.create());
+
+    // read the tile back from the server, the top one comes first
+    xcb_connection_t *c = QX11Info::connection();
+    KXUtils::Atom atom(c, QByteArrayLiteral("_KDE_NET_WM_SHADOW"));
+    const auto cookie = xcb_get_property(c, false, window.winId(), atom, XCB_ATOM_CARDINAL, 0, 12);
+    QScopedPointer<xcb_get_property_reply_t, QScopedPointerPodDeleter> property(xcb_get_property_reply(c, cookie, nullptr));
+    QVERIFY(!property.isNull());
+    QCOMPARE(property->value_len, 12u);
+    const xcb_pixmap_t pixmap = reinterpret_cast<const uint32_t *>(xcb_get_property_value(property.data()))[0];
+
+    const auto imageCookie = xcb_get_image(c, XCB_IMAGE_FORMAT_Z_PIXMAP, pixmap, 0, 0, size.width(), size.height(), ~0);
+    QScopedPointer<xcb_get_image_reply_t, QScopedPointerPodDeleter> reply(xcb_get_image_reply(c, imageCookie, nullptr));
+    QVERIFY(!reply.isNull());
+    QCOMPARE(xcb_get_image_data_length(reply.data()), int(image.sizeInBytes()));
+    QCOMPARE(memcmp(xcb_get_image_data(reply.data()), image.constBits(), image.sizeInBytes()), 0);
+}
+
+void KWindowShadowX11Test::testSharedTiles()
+{
+    QWindow window1;
+    window1.create();
+    QWindow window2;
+    window2.create();
+
+    // separately created images with the same pixels
+    QScopedPointer<KWindowShadow> shadow1(new KWindowShadow);
+    setPopupShadow(shadow1.data(), createImage(QSize(64, 64)), createImage(QSize(1, 64)));
+    shadow1->setWindow(&window1);
+    QVERIFY(shadow1->create());
+    QScopedPointer<KWindowShadow> shadow2(new KWindowShadow);
+    setPopupShadow(shadow2.data(), createImage(QSize(64, 64)), createImage(QSize(1, 64)));
+    shadow2->setWindow(&window2);
+    QVERIFY(shadow2->create());
+
+    const QList<xcb_pixmap_t> pixmaps = shadowPixmaps(&window1);
+    QCOMPARE(pixmaps.count(), 8);
+    QCOMPARE(shadowPixmaps(&window2), pixmaps);
+    // the corners and the edges differ
+    QVERIFY(pixmaps.at(0) != pixmaps.at(1));
+    QCOMPARE(pixmaps.at(0), pixmaps.at(2));
+
+    // a different image gets its own pixmap
+    QImage changed = createImage(QSize(64, 64));
+    changed.setPixel(10, 10, 0);
+    KWindowShadowTile::Ptr tile = KWindowShadowTile::Ptr::create();
+    tile->setImage(changed);
+    QWindow window3;
+    window3.create();
+    KWindowShadow shadow3;
+    shadow3.setTopTile(tile);
+    shadow3.setWindow(&window3);
+    QVERIFY(shadow3.create());
+    QVERIFY(!pixmaps.contains(shadowPixmaps(&window3).at(0)));
+
+    // the pixmaps go away with the last tile using them
+    shadow1.reset();
+    QVERIFY(pixmapExists(pixmaps.at(0)));
+    shadow2.reset();
+    QVERIFY(!pixmapExists(pixmaps.at(0)));
+    QVERIFY(!pixmapExists(pixmaps.at(1)));
+}
+
+void KWindowShadowX11Test::testUpdate()
+{
+    QWindow window;
+    window.create();
+
+    // watch the property changes from another connection
+    xcb_connection_t *c = xcb_connect(nullptr, nullptr);
+    QVERIFY(!xcb_connection_has_error(c));
+    const uint32_t mask = XCB_EVENT_MASK_PROPERTY_CHANGE;
+    xcb_change_window_attributes(c, window.winId(), XCB_CW_EVENT_MASK, &mask);
+    free(xcb_get_input_focus_reply(c, xcb_get_input_focus(c), nullptr));
+    auto propertyChanges = [c]() {
+        free(xcb_get_input_focus_reply(QX11Info::connection(), xcb_get_input_focus(QX11Info::connection()), nullptr));
+        free(xcb_get_input_focus_reply(c, xcb_get_input_focus(c), nullptr));
+        int count = 0;
+        while (xcb_generic_event_t *event = xcb_poll_for_event(c)) {
+            if ((event->response_type & ~0x80) == XCB_PROPERTY_NOTIFY) {
+                ++count;
+            }
+            free(event);
+        }
+        return count;
+    };
+
+    KWindowShadow shadow;
+    setPopupShadow(&shadow, createImage(QSize(64, 64)), createImage(QSize(1, 64)));
+    shadow.setWindow(&window);
+    QVERIFY(shadow.create());
+    QCOMPARE(propertyChanges(), 1);
+    const QList<xcb_pixmap_t> pixmaps = shadowPixmaps(&window);
+
+    // nothing changed
+    QVERIFY(shadow.update());
+    QCOMPARE(propertyChanges(), 0);
+    // changed back and forth
+    shadow.setPadding(QMargins(10, 10, 10, 10));
+    shadow.setPadding(QMargins(64, 64, 64, 64));
+    QVERIFY(shadow.update());
+    QCOMPARE(propertyChanges(), 0);
+
+    // one tile swapped, the others stay
+    QImage changed = createImage(QSize(64, 64));
+    changed.setPixel(10, 10, 0);
+    KWindowShadowTile::Ptr tile = KWindowShadowTile::Ptr::create();
+    tile->setImage(changed);
+    shadow.setTopLeftTile(tile);
+    shadow.setPadding(QMargins(32, 32, 32, 32));
+    QVERIFY(shadow.update());
+    QCOMPARE(propertyChanges(), 1);
+    QVERIFY(tile->isCreated());
+
+    const QList<xcb_pixmap_t> updated = shadowPixmaps(&window);
+    QCOMPARE(updated.count(), 8);
+    QVERIFY(updated.at(7) != pixmaps.at(7));
+    QCOMPARE(updated.mid(0, 7), pixmaps.mid(0, 7));
+    // the old top left tile is not used anymore, but the pixmap is still used by the other corners
+    QVERIFY(pixmapExists(pixmaps.at(7)));
+
+    xcb_disconnect(c);
+}
+
+QTEST_MAIN(KWindowShadowX11Test)
+
+#include "kwindowshadowx11test.moc"
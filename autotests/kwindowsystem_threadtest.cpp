@@ -9,11 +9,19 @@
 #include "nettesthelper.h"
 #include "netwm.h"
 
+#include <QMutex>
 #include <QRunnable>
 #include <QSignalSpy>
 #include <QTest>
 #include <QThread>
 #include <QThreadPool>
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+#include <private/qtx11extras_p.h>
+#else
+#include <QX11Info>
+#endif
+
+#include <algorithm>
 
 class KWindowSystemThreadTest : public QObject
 {
@@ -23,6 +31,8 @@ private Q_SLOTS:
 
     void testWindowAdded();
     void testAccessFromThread();
+    void testSnapshotFromThread();
+    void testChangeQueue();
 
 private:
     QWidget *m_widget;
@@ -55,6 +65,44 @@ public:
     QStringList m_names;
 };
 
+class SnapshotReader : public QThread
+{
+public:
+    void run() override
+    {
+        m_snapshot = KWindowSystem::snapshot();
+    }
+
+    KWindowSystemSnapshot m_snapshot;
+};
+
+class ChangeQueueConsumer : public QThread
+{
+public:
+    void run() override
+    {
+        KWindowChange change;
+        while (m_queue.wait()) {
+            while (m_queue.tryTake(change)) {
+                QMutexLocker locker(&m_mutex);
+                m_changes << change;
+            }
+        }
+    }
+
+    bool hasChange(WId window, KWindowChange::Kind kind)
+    {
+        QMutexLocker locker(&m_mutex);
+        return std::any_of(m_changes.cbegin(), m_changes.cend(), [window, kind](const KWindowChange &change) {
+            return change.window == window && (change.kinds & kind);
+        });
+    }
+
+    KWindowChangeQueue m_queue;
+    QMutex m_mutex;
+    QList<KWindowChange> m_changes;
+};
+
 void KWindowSystemThreadTest::initTestCase()
 {
     m_widget = nullptr;
@@ -95,6 +143,59 @@ void KWindowSystemThreadTest::testAccessFromThread()
     QVERIFY(!listerThread.m_names.isEmpty());
 }
 
+void KWindowSystemThreadTest::testSnapshotFromThread()
+{
+    SnapshotReader reader;
+    reader.start();
+    QVERIFY(reader.wait(5000));
+    const KWindowSystemSnapshot snapshot = reader.m_snapshot;
+    QVERIFY(snapshot.isValid());
+    QVERIFY(snapshot.windows().contains(m_widget->winId()));
+    QVERIFY(snapshot.stackingOrder().contains(m_widget->winId()));
+    QCOMPARE(snapshot.currentDesktop(), KWindowSystem::currentDesktop());
+    QCOMPARE(snapshot.numberOfDesktops(), KWindowSystem::numberOfDesktops());
+    QCOMPARE(snapshot.workArea(), KWindowSystem::workArea());
+
+    // a new snapshot once the main thread processed the change, the old one stays as it was
+    QWidget widget;
+    widget.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&widget));
+    QTRY_VERIFY(KWindowSystem::snapshot().windows().contains(widget.winId()));
+    QVERIFY(KWindowSystem::snapshot().serial() > snapshot.serial());
+    QVERIFY(!snapshot.windows().contains(widget.winId()));
+
+    reader.start();
+    QVERIFY(reader.wait(5000));
+    QVERIFY(reader.m_snapshot.windows().contains(widget.winId()));
+}
+
+void KWindowSystemThreadTest::testChangeQueue()
+{
+    ChangeQueueConsumer consumer;
+    QCOMPARE(consumer.m_queue.capacity(), 4096);
+    KWindowSystem::addChangeQueue(&consumer.m_queue);
+    consumer.start();
+
+    QScopedPointer<QWidget> widget(new QWidget);
+    widget->show();
+    QVERIFY(QTest::qWaitForWindowExposed(widget.data()));
+    const WId window = widget->winId();
+    QTRY_VERIFY(consumer.hasChange(window, KWindowChange::Added));
+
+    NETWinInfo info(QX11Info::connection(), window, QX11Info::appRootWindow(), NET::Properties(), NET::Properties2());
+    info.setName("changeQueue");
+    xcb_flush(QX11Info::connection());
+    QTRY_VERIFY(consumer.hasChange(window, KWindowChange::Changed));
+
+    widget->hide();
+    QTRY_VERIFY(consumer.hasChange(window, KWindowChange::Removed));
+    QCOMPARE(consumer.m_queue.droppedCount(), quint64(0));
+
+    KWindowSystem::removeChangeQueue(&consumer.m_queue);
+    consumer.m_queue.wakeUp();
+    QVERIFY(consumer.wait(5000));
+}
+
 QTEST_MAIN(KWindowSystemThreadTest)
 
 #include <kwindowsystem_threadtest.moc>
@@ -0,0 +1,406 @@
+/*
+    SPDX-FileCopyrightText: 2022 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#include "kwindowsystem.h"
+#include "nettesthelper.h"
+#include "netwm.h"
+
+#include <QAbstractEventDispatcher>
+#include <QElapsedTimer>
+#include <QScreen>
+#include <QSignalSpy>
+#include <QThread>
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+#include <private/qtx11extras_p.h>
+#else
+#include <QX11Info>
+#endif
+#include <qtest_widgets.h>
+
+#include <atomic>
+#include <vector>
+
+Q_DECLARE_METATYPE(WId)
+Q_DECLARE_METATYPE(NET::Properties)
+Q_DECLARE_METATYPE(NET::Properties2)
+
+static const int s_windowCount = 10000;
+static const int s_eventCount = 10000;
+// docks and panels, the windows with a strut
+static const int s_strutWindowCount = 20;
+// the panels are spread over this many outputs side by side
+static const int s_outputCount = 4;
+// clients added at once, like when restoring a session
+static const int s_burstCount = 500;
+// the property changes arriving within 10 ms at 50k events/s
+static const int s_relayBatchCount = 500;
+
+class KWindowSystemX11Benchmark : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void benchmarkClientPropertyEvents();
+    void benchmarkForeignPropertyEvents();
+    void benchmarkHasWId();
+    void benchmarkWorkArea();
+    void benchmarkWorkAreaExcludes();
+    void benchmarkScreenWorkArea();
+    void benchmarkScreenWorkAreaFromWindowInfos();
+    void benchmarkClientListBurst();
+    void benchmarkRelayQueuedSignals();
+    void benchmarkRelayChangeQueue();
+
+private:
+    void sendPropertyEvents(const QList<xcb_window_t> &windows, int count = s_eventCount);
+    bool waitForRelayed(const std::atomic<int> &relayed, int count);
+    QRect output(int index) const;
+    void setClientList(const std::vector<xcb_window_t> &clientList);
+    bool waitForWId(WId window, bool present);
+
+    QList<xcb_window_t> m_windows;
+    QList<xcb_window_t> m_foreignWindows;
+    std::vector<xcb_window_t> m_oldClientList;
+    xcb_atom_t m_netWmName = XCB_ATOM_NONE;
+};
+
+void KWindowSystemX11Benchmark::initTestCase()
+{
+    if (!KWindowSystem::isPlatformX11()) {
+        QSKIP("This test requires X11");
+    }
+    // windowChanged needs the per window information
+    QSignalSpy windowChangedSpy(KWindowSystem::self(), qOverload<WId, NET::Properties, NET::Properties2>(&KWindowSystem::windowChanged));
+
+    xcb_connection_t *c = QX11Info::connection();
+    const xcb_window_t root = QX11Info::appRootWindow();
+    KXUtils::Atom netClientList(c, QByteArrayLiteral("_NET_CLIENT_LIST"));
+    KXUtils::Atom netWmName(c, QByteArrayLiteral("_NET_WM_NAME"));
+    KXUtils::Atom netWmStrut(c, QByteArrayLiteral("_NET_WM_STRUT"));
+    KXUtils::Atom netWmStrutPartial(c, QByteArrayLiteral("_NET_WM_STRUT_PARTIAL"));
+    KXUtils::Atom netWmDesktop(c, QByteArrayLiteral("_NET_WM_DESKTOP"));
+    m_netWmName = netWmName;
+
+    const auto cookie = xcb_get_property(c, false, root, netClientList, XCB_ATOM_WINDOW, 0, 0x7fffffff);
+    QScopedPointer<xcb_get_property_reply_t, QScopedPointerPodDeleter> reply(xcb_get_property_reply(c, cookie, nullptr));
+    if (!reply.isNull() && reply->format == 32 && reply->type == XCB_ATOM_WINDOW) {
+        const xcb_window_t *data = reinterpret_cast<xcb_window_t *>(xcb_get_property_value(reply.data()));
+        m_oldClientList.assign(data, data + reply->value_len);
+    }
+
+    // the windows are never mapped, only the root property makes them clients
+    for (int i = 0; i < s_windowCount; ++i) {
+        const xcb_window_t w = xcb_generate_id(c);
+        xcb_create_window(c, XCB_COPY_FROM_PARENT, w, root, 0, 0, 10, 10, 0, XCB_COPY_FROM_PARENT, XCB_COPY_FROM_PARENT, 0, nullptr);
+        m_windows << w;
+        if (i < s_strutWindowCount) {
+            // left, right, top, bottom
+            const uint32_t strut[] = {0, 0, uint32_t(i + 1), 0};
+            xcb_change_property(c, XCB_PROP_MODE_REPLACE, w, netWmStrut, XCB_ATOM_CARDINAL, 32, 4, strut);
+            // the same strut only along the top of one output
+            const QRect o = output(i % s_outputCount);
+            const uint32_t strutPartial[] = {0, 0, uint32_t(i + 1), 0, 0, 0, 0, 0, uint32_t(o.left()), uint32_t(o.right()), 0, 0};
+            xcb_change_property(c, XCB_PROP_MODE_REPLACE, w, netWmStrutPartial, XCB_ATOM_CARDINAL, 32, 12, strutPartial);
+            const uint32_t onAllDesktops = NETWinInfo::OnAllDesktops;
+            xcb_change_property(c, XCB_PROP_MODE_REPLACE, w, netWmDesktop, XCB_ATOM_CARDINAL, 32, 1, &onAllDesktops);
+        }
+        // never added to the client list, events for them get filtered out
+        m_foreignWindows << xcb_generate_id(c);
+    }
+    std::vector<xcb_window_t> clientList = m_oldClientList;
+    clientList.insert(clientList.end(), m_windows.constBegin(), m_windows.constEnd());
+    xcb_change_property(c, XCB_PROP_MODE_REPLACE, root, netClientList, XCB_ATOM_WINDOW, 32, clientList.size(), clientList.data());
+    xcb_flush(c);
+
+    QTRY_VERIFY_WITH_TIMEOUT(KWindowSystem::hasWId(m_windows.last()), 30000);
+    QCOMPARE(KWindowSystem::windows().count(), int(clientList.size()));
+}
+
+void KWindowSystemX11Benchmark::cleanupTestCase()
+{
+    xcb_connection_t *c = QX11Info::connection();
+    if (!c) {
+        return;
+    }
+    KXUtils::Atom netClientList(c, QByteArrayLiteral("_NET_CLIENT_LIST"));
+    xcb_change_property(c,
+                        XCB_PROP_MODE_REPLACE,
+                        QX11Info::appRootWindow(),
+                        netClientList,
+                        XCB_ATOM_WINDOW,
+                        32,
+                        m_oldClientList.size(),
+                        m_oldClientList.data());
+    for (xcb_window_t w : std::as_const(m_windows)) {
+        xcb_destroy_window(c, w);
+    }
+    xcb_flush(c);
+}
+
+// the display split into outputs, as on a multi-monitor setup
+QRect KWindowSystemX11Benchmark::output(int index) const
+{
+    const QRect display = QGuiApplication::primaryScreen()->virtualGeometry();
+    const int width = display.width() / s_outputCount;
+    return QRect(display.left() + index * width, display.top(), width, display.height());
+}
+
+void KWindowSystemX11Benchmark::sendPropertyEvents(const QList<xcb_window_t> &windows, int count)
+{
+    QAbstractEventDispatcher *dispatcher = QAbstractEventDispatcher::instance();
+    const QByteArray eventType = QByteArrayLiteral("xcb_generic_event_t");
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    qintptr result = 0;
+#else
+    long result = 0;
+#endif
+    xcb_property_notify_event_t event = {};
+    event.response_type = XCB_PROPERTY_NOTIFY;
+    event.atom = m_netWmName;
+    event.state = XCB_PROPERTY_NEW_VALUE;
+    // walk the windows back to front, the most recently added clients are the most expensive to find in a list
+    for (int i = 0; i < count; ++i) {
+        event.window = windows.at(windows.count() - 1 - (i % windows.count()));
+        dispatcher->filterNativeEvent(eventType, &event, &result);
+    }
+}
+
+void KWindowSystemX11Benchmark::benchmarkClientPropertyEvents()
+{
+    QSignalSpy windowChangedSpy(KWindowSystem::self(), qOverload<WId, NET::Properties, NET::Properties2>(&KWindowSystem::windowChanged));
+    QBENCHMARK {
+        sendPropertyEvents(m_windows);
+    }
+    QVERIFY(windowChangedSpy.count() >= s_eventCount);
+    QCOMPARE(windowChangedSpy.first().at(0).value<WId>(), WId(m_windows.last()));
+    QCOMPARE(windowChangedSpy.first().at(1).value<NET::Properties>(), NET::Properties(NET::WMName));
+}
+
+void KWindowSystemX11Benchmark::benchmarkForeignPropertyEvents()
+{
+    QSignalSpy windowChangedSpy(KWindowSystem::self(), qOverload<WId, NET::Properties, NET::Properties2>(&KWindowSystem::windowChanged));
+    QBENCHMARK {
+        sendPropertyEvents(m_foreignWindows);
+    }
+    QCOMPARE(windowChangedSpy.count(), 0);
+}
+
+void KWindowSystemX11Benchmark::benchmarkHasWId()
+{
+    QBENCHMARK {
+        for (xcb_window_t w : std::as_const(m_windows)) {
+            QVERIFY(KWindowSystem::hasWId(w));
+        }
+    }
+    QVERIFY(!KWindowSystem::hasWId(m_foreignWindows.first()));
+}
+
+void KWindowSystemX11Benchmark::benchmarkWorkArea()
+{
+    // the struts are only fetched on the first call
+    QCOMPARE(KWindowSystem::workArea(QList<WId>()).top(), s_strutWindowCount);
+    QBENCHMARK {
+        QCOMPARE(KWindowSystem::workArea(QList<WId>()).top(), s_strutWindowCount);
+    }
+}
+
+void KWindowSystemX11Benchmark::benchmarkWorkAreaExcludes()
+{
+    // a panel asking for the work area without itself, as done for every panel
+    QList<QList<WId>> excludes;
+    for (int i = 0; i < s_strutWindowCount; ++i) {
+        excludes << QList<WId>{m_windows.at(s_strutWindowCount - 1 - i)};
+    }
+    QBENCHMARK {
+        for (int i = 0; i < s_strutWindowCount; ++i) {
+            const int expected = i == 0 ? s_strutWindowCount - 1 : s_strutWindowCount;
+            QCOMPARE(KWindowSystem::workArea(excludes.at(i)).top(), expected);
+        }
+    }
+}
+
+void KWindowSystemX11Benchmark::benchmarkScreenWorkArea()
+{
+    const QList<QScreen *> screens = QGuiApplication::screens();
+    for (QScreen *screen : screens) {
+        // computed once from the remembered struts, then only looked up
+        QVERIFY(KWindowSystem::screenWorkArea(screen).top() >= s_strutWindowCount - s_outputCount + 1);
+    }
+    QBENCHMARK {
+        for (QScreen *screen : screens) {
+            QVERIFY(KWindowSystem::screenWorkArea(screen).top() >= s_strutWindowCount - s_outputCount + 1);
+        }
+    }
+}
+
+void KWindowSystemX11Benchmark::benchmarkScreenWorkAreaFromWindowInfos()
+{
+    // for comparison, what a panel had to do to know the work area of each output
+    QBENCHMARK {
+        const QList<KWindowInfo> infos = KWindowSystem::windowInfos(KWindowSystem::windows(), NET::WMDesktop, NET::WM2ExtendedStrut);
+        for (int i = 0; i < s_outputCount; ++i) {
+            const QRect o = output(i);
+            QRect area = o;
+            for (const KWindowInfo &info : infos) {
+                const NETExtendedStrut strut = info.extendedStrut();
+                if (strut.top_width > 0 && info.isOnCurrentDesktop() && strut.top_start <= o.right() && strut.top_end >= o.left()) {
+                    area.setTop(qMax(area.top(), o.top() + strut.top_width));
+                }
+            }
+            QCOMPARE(area.top(), s_strutWindowCount - s_outputCount + 1 + i);
+        }
+    }
+}
+
+void KWindowSystemX11Benchmark::setClientList(const std::vector<xcb_window_t> &clientList)
+{
+    xcb_connection_t *c = QX11Info::connection();
+    KXUtils::Atom netClientList(c, QByteArrayLiteral("_NET_CLIENT_LIST"));
+    xcb_change_property(c, XCB_PROP_MODE_REPLACE, QX11Info::appRootWindow(), netClientList, XCB_ATOM_WINDOW, 32, clientList.size(), clientList.data());
+    xcb_flush(c);
+}
+
+// unlike QTRY_VERIFY, doesn't sleep between the checks
+bool KWindowSystemX11Benchmark::waitForWId(WId window, bool present)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (KWindowSystem::hasWId(window) != present) {
+        if (timer.hasExpired(30000)) {
+            return false;
+        }
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents, 100);
+    }
+    return true;
+}
+
+void KWindowSystemX11Benchmark::benchmarkClientListBurst()
+{
+    // with strutChanged() connected the struts of every new client are read as well
+    QSignalSpy strutChangedSpy(KWindowSystem::self(), &KWindowSystem::strutChanged);
+
+    xcb_connection_t *c = QX11Info::connection();
+    const xcb_window_t root = QX11Info::appRootWindow();
+    std::vector<xcb_window_t> clientList = m_oldClientList;
+    clientList.insert(clientList.end(), m_windows.constBegin(), m_windows.constEnd());
+    std::vector<xcb_window_t> burstClientList = clientList;
+    for (int i = 0; i < s_burstCount; ++i) {
+        const xcb_window_t w = xcb_generate_id(c);
+        xcb_create_window(c, XCB_COPY_FROM_PARENT, w, root, 0, 0, 10, 10, 0, XCB_COPY_FROM_PARENT, XCB_COPY_FROM_PARENT, 0, nullptr);
+        burstClientList.push_back(w);
+    }
+    const xcb_window_t last = burstClientList.back();
+
+    QBENCHMARK {
+        setClientList(burstClientList);
+        QVERIFY(waitForWId(last, true));
+        setClientList(clientList);
+        QVERIFY(waitForWId(last, false));
+    }
+
+    for (auto it = burstClientList.cbegin() + clientList.size(); it != burstClientList.cend(); ++it) {
+        xcb_destroy_window(c, *it);
+    }
+    xcb_flush(c);
+}
+
+// a consumer of the window changes in a worker thread, as relayed by queued connections
+class QueuedWindowChangedReceiver : public QObject
+{
+    Q_OBJECT
+public:
+    std::atomic<int> relayed{0};
+
+public Q_SLOTS:
+    void windowChanged(WId window, NET::Properties properties, NET::Properties2 properties2)
+    {
+        Q_UNUSED(window)
+        Q_UNUSED(properties)
+        Q_UNUSED(properties2)
+        relayed.fetch_add(1, std::memory_order_release);
+    }
+};
+
+// the same consumer, taking the changes from a KWindowChangeQueue
+class ChangeQueueReceiver : public QThread
+{
+public:
+    KWindowChangeQueue queue;
+    std::atomic<int> relayed{0};
+
+    void run() override
+    {
+        KWindowChange change;
+        while (queue.wait()) {
+            while (queue.tryTake(change)) {
+                relayed.fetch_add(1, std::memory_order_release);
+            }
+        }
+    }
+};
+
+bool KWindowSystemX11Benchmark::waitForRelayed(const std::atomic<int> &relayed, int count)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (relayed.load(std::memory_order_acquire) < count) {
+        if (timer.elapsed() > 5000) {
+            return false;
+        }
+        QThread::yieldCurrentThread();
+    }
+    return true;
+}
+
+void KWindowSystemX11Benchmark::benchmarkRelayQueuedSignals()
+{
+    QThread thread;
+    QueuedWindowChangedReceiver receiver;
+    receiver.moveToThread(&thread);
+    connect(KWindowSystem::self(),
+            qOverload<WId, NET::Properties, NET::Properties2>(&KWindowSystem::windowChanged),
+            &receiver,
+            &QueuedWindowChangedReceiver::windowChanged,
+            Qt::QueuedConnection);
+    thread.start();
+
+    // the time until the worker got the changes must stay well below the 10 ms they arrive in
+    int expected = 0;
+    QBENCHMARK {
+        sendPropertyEvents(m_windows, s_relayBatchCount);
+        expected += s_relayBatchCount;
+        QVERIFY(waitForRelayed(receiver.relayed, expected));
+    }
+
+    disconnect(KWindowSystem::self(), nullptr, &receiver, nullptr);
+    thread.quit();
+    QVERIFY(thread.wait(5000));
+}
+
+void KWindowSystemX11Benchmark::benchmarkRelayChangeQueue()
+{
+    ChangeQueueReceiver receiver;
+    KWindowSystem::addChangeQueue(&receiver.queue);
+    receiver.start();
+
+    int expected = 0;
+    QBENCHMARK {
+        sendPropertyEvents(m_windows, s_relayBatchCount);
+        expected += s_relayBatchCount;
+        QVERIFY(waitForRelayed(receiver.relayed, expected));
+    }
+    QCOMPARE(receiver.queue.droppedCount(), quint64(0));
+
+    KWindowSystem::removeChangeQueue(&receiver.queue);
+    receiver.queue.wakeUp();
+    QVERIFY(receiver.wait(5000));
+}
+
+QTEST_MAIN(KWindowSystemX11Benchmark)
+
+#include "kwindowsystemx11benchmark.moc"
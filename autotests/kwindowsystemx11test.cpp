@@ -8,6 +8,10 @@
 #include "nettesthelper.h"
 #include "netwm.h"
 
+#include <QIcon>
+#include <QPixmap>
+#include <QScopeGuard>
+#include <QScreen>
 #include <QSignalSpy>
 #include <QWidget>
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
@@ -17,6 +21,8 @@
 #endif
 
 #include <qtest_widgets.h>
+
+#include <algorithm>
 Q_DECLARE_METATYPE(WId)
 Q_DECLARE_METATYPE(NET::Properties)
 Q_DECLARE_METATYPE(NET::Properties2)
@@ -31,14 +37,21 @@ private Q_SLOTS:
     void testActiveWindowChanged();
     void testWindowAdded();
     void testWindowRemoved();
+    void testStackingOrderDelta();
     void testDesktopChanged();
     void testNumberOfDesktopsChanged();
     void testDesktopNamesChanged();
     void testShowingDesktopChanged();
     void testSetShowingDesktop();
     void testWorkAreaChanged();
+    void testWorkAreaStrut();
+    void testScreenWorkArea();
     void testWindowTitleChanged();
     void testMinimizeWindow();
+    void testWindowInfoCache();
+    void testIconCache();
+    void testCoalescedWindowChanges();
+    void testChangesSince();
     void testPlatformX11();
 };
 
@@ -101,6 +114,50 @@ void KWindowSystemX11Test::testWindowRemoved()
     QVERIFY(!KWindowSystem::hasWId(widget->winId()));
 }
 
+void KWindowSystemX11Test::testStackingOrderDelta()
+{
+    QSignalSpy deltaSpy(KWindowSystem::self(), &KWindowSystem::stackingOrderDelta);
+    // the windows of the signal at position @p column in all the deltas so far
+    auto deltaWindows = [&deltaSpy](int column) {
+        QList<WId> windows;
+        for (const QList<QVariant> &arguments : std::as_const(deltaSpy)) {
+            windows << arguments.at(column).value<QList<WId>>();
+        }
+        return windows;
+    };
+
+    const quint64 generation = KWindowSystem::stackingOrderGeneration();
+    QWidget widget1;
+    widget1.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&widget1));
+    QWidget widget2;
+    widget2.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&widget2));
+    const WId w1 = widget1.winId();
+    const WId w2 = widget2.winId();
+    QTRY_VERIFY(KWindowSystem::stackingOrder().contains(w1) && KWindowSystem::stackingOrder().contains(w2));
+    QTRY_VERIFY(deltaWindows(0).contains(w1) && deltaWindows(0).contains(w2));
+    QVERIFY(KWindowSystem::stackingOrderGeneration() > generation);
+
+    // only the raised window moves
+    if (KWindowSystem::stackingOrder().indexOf(w1) > KWindowSystem::stackingOrder().indexOf(w2)) {
+        KWindowSystem::raiseWindow(w2);
+        QTRY_VERIFY(KWindowSystem::stackingOrder().indexOf(w1) < KWindowSystem::stackingOrder().indexOf(w2));
+    }
+    deltaSpy.clear();
+    const quint64 beforeRaise = KWindowSystem::stackingOrderGeneration();
+    KWindowSystem::raiseWindow(w1);
+    QTRY_VERIFY(KWindowSystem::stackingOrder().indexOf(w1) > KWindowSystem::stackingOrder().indexOf(w2));
+    QVERIFY(KWindowSystem::stackingOrderGeneration() > beforeRaise);
+    QVERIFY(deltaWindows(2).contains(w1));
+    QVERIFY(!deltaWindows(2).contains(w2));
+
+    deltaSpy.clear();
+    widget1.hide();
+    QTRY_VERIFY(deltaWindows(1).contains(w1));
+    QVERIFY(!KWindowSystem::stackingOrder().contains(w1));
+}
+
 void KWindowSystemX11Test::testDesktopChanged()
 {
     // This test requires a running NETWM-compliant window manager
@@ -256,6 +313,64 @@ void KWindowSystemX11Test::testWorkAreaChanged()
     QVERIFY(!strutSpy.isEmpty());
 }
 
+void KWindowSystemX11Test::testWorkAreaStrut()
+{
+    QWidget widget;
+    widget.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&widget));
+    QTRY_VERIFY(KWindowSystem::hasWId(widget.winId()));
+    KWindowSystem::setOnAllDesktops(widget.winId(), true);
+
+    const QList<WId> excludes{widget.winId()};
+    const QRect withoutStrut = KWindowSystem::workArea(excludes);
+
+    KWindowSystem::setStrut(widget.winId(), 10, 0, 0, 0);
+    QTRY_COMPARE(KWindowSystem::workArea(QList<WId>()).left(), qMax(withoutStrut.left(), 10));
+    QCOMPARE(KWindowSystem::workArea(excludes), withoutStrut);
+
+    // the remembered work areas have to follow strut changes
+    KWindowSystem::setStrut(widget.winId(), 20, 0, 0, 0);
+    QTRY_COMPARE(KWindowSystem::workArea(QList<WId>()).left(), qMax(withoutStrut.left(), 20));
+    QCOMPARE(KWindowSystem::workArea(excludes), withoutStrut);
+
+    widget.hide();
+    QTRY_VERIFY(!KWindowSystem::hasWId(widget.winId()));
+    QCOMPARE(KWindowSystem::workArea(QList<WId>()), withoutStrut);
+}
+
+void KWindowSystemX11Test::testScreenWorkArea()
+{
+    QScreen *screen = QGuiApplication::primaryScreen();
+    const QRect geometry = screen->geometry();
+
+    QWidget widget;
+    widget.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&widget));
+    QTRY_VERIFY(KWindowSystem::hasWId(widget.winId()));
+    KWindowSystem::setOnAllDesktops(widget.winId(), true);
+
+    const QRect withoutStrut = KWindowSystem::screenWorkArea(screen);
+    QVERIFY(geometry.contains(withoutStrut));
+    QCOMPARE(KWindowSystem::workArea(nullptr), withoutStrut);
+
+    // a panel along the top of the screen
+    KWindowSystem::setExtendedStrut(widget.winId(), 0, 0, 0, 0, 0, 0, 10, geometry.left(), geometry.left() + 99, 0, 0, 0);
+    QTRY_COMPARE(KWindowSystem::screenWorkArea(screen).top(), qMax(withoutStrut.top(), geometry.top() + 10));
+    QCOMPARE(KWindowSystem::screenWorkArea(screen).left(), withoutStrut.left());
+
+    // a panel on the top edge of an output right of this one doesn't matter
+    KWindowSystem::setExtendedStrut(widget.winId(), 0, 0, 0, 0, 0, 0, 10, geometry.right() + 1, geometry.right() + 100, 0, 0, 0);
+    QTRY_COMPARE(KWindowSystem::screenWorkArea(screen), withoutStrut);
+
+    // a panel along the left of the screen
+    KWindowSystem::setExtendedStrut(widget.winId(), 20, geometry.top(), geometry.bottom(), 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    QTRY_COMPARE(KWindowSystem::screenWorkArea(screen).left(), qMax(withoutStrut.left(), geometry.left() + 20));
+
+    widget.hide();
+    QTRY_VERIFY(!KWindowSystem::hasWId(widget.winId()));
+    QCOMPARE(KWindowSystem::screenWorkArea(screen), withoutStrut);
+}
+
 void KWindowSystemX11Test::testWindowTitleChanged()
 {
     qRegisterMetaType<WId>("WId");
@@ -387,6 +502,188 @@ void KWindowSystemX11Test::testMinimizeWindow()
     QVERIFY(!info3.isMinimized());
 }
 
+void KWindowSystemX11Test::testWindowInfoCache()
+{
+    KWindowSystem::setWindowInfoCacheEnabled(true);
+    auto cleanup = qScopeGuard([] {
+        KWindowSystem::setWindowInfoCacheEnabled(false);
+    });
+
+    QWidget widget;
+    widget.setWindowTitle(QStringLiteral("foo"));
+    widget.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&widget));
+    QTRY_VERIFY(KWindowSystem::hasWId(widget.winId()));
+
+    const NET::Properties properties = NET::WMName | NET::WMDesktop | NET::WMState | NET::XAWMState | NET::WMGeometry;
+    const NET::Properties2 properties2 = NET::WM2WindowClass;
+    const KWindowInfo cached(widget.winId(), properties, properties2);
+    QVERIFY(cached.valid());
+    QCOMPARE(cached.name(), QStringLiteral("foo"));
+
+    widget.setWindowTitle(QStringLiteral("bar"));
+    QTRY_COMPARE(KWindowInfo(widget.winId(), properties, properties2).name(), QStringLiteral("bar"));
+    // existing instances don't change
+    QCOMPARE(cached.name(), QStringLiteral("foo"));
+
+    const KWindowInfo cachedAgain(widget.winId(), properties, properties2);
+    KWindowSystem::setWindowInfoCacheEnabled(false);
+    const KWindowInfo uncached(widget.winId(), properties, properties2);
+    QCOMPARE(cachedAgain.name(), uncached.name());
+    QCOMPARE(cachedAgain.desktop(), uncached.desktop());
+    QCOMPARE(cachedAgain.state(), uncached.state());
+    QCOMPARE(cachedAgain.mappingState(), uncached.mappingState());
+    QCOMPARE(cachedAgain.geometry(), uncached.geometry());
+    QCOMPARE(cachedAgain.windowClassName(), uncached.windowClassName());
+    QCOMPARE(cachedAgain.windowClassClass(), uncached.windowClassClass());
+}
+
+void KWindowSystemX11Test::testIconCache()
+{
+    // icons are cached for the windows whose changes are tracked
+    QSignalSpy windowChangedSpy(KWindowSystem::self(), qOverload<WId, NET::Properties, NET::Properties2>(&KWindowSystem::windowChanged));
+
+    QPixmap red(32, 32);
+    red.fill(Qt::red);
+    QWidget widget;
+    widget.setWindowIcon(QIcon(red));
+    widget.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&widget));
+    QTRY_VERIFY(KWindowSystem::hasWId(widget.winId()));
+
+    QTRY_COMPARE(KWindowSystem::icon(widget.winId(), 32, 32, true, KWindowSystem::NETWM).toImage().pixel(16, 16), QColor(Qt::red).rgb());
+    // served from the cache
+    QCOMPARE(KWindowSystem::icon(widget.winId(), 32, 32, true, KWindowSystem::NETWM).toImage().pixel(16, 16), QColor(Qt::red).rgb());
+
+    // a changed icon invalidates the cache
+    QPixmap blue(32, 32);
+    blue.fill(Qt::blue);
+    widget.setWindowIcon(QIcon(blue));
+    QTRY_COMPARE(KWindowSystem::icon(widget.winId(), 32, 32, true, KWindowSystem::NETWM).toImage().pixel(16, 16), QColor(Qt::blue).rgb());
+}
+
+void KWindowSystemX11Test::testCoalescedWindowChanges()
+{
+    QWidget widget;
+    widget.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&widget));
+    QTRY_VERIFY(KWindowSystem::hasWId(widget.winId()));
+    const WId window = widget.winId();
+    xcb_connection_t *c = QX11Info::connection();
+    NETWinInfo info(c, window, QX11Info::appRootWindow(), NET::Properties(), NET::Properties2());
+
+    // an application updating its window, several properties at a time
+    const int rounds = 20;
+    auto churn = [&] {
+        for (int i = 0; i < rounds; ++i) {
+            const QByteArray round = QByteArray::number(i);
+            info.setName(round.constData());
+            info.setIconName(round.constData());
+            info.setDesktopFileName(round.constData());
+            xcb_flush(c);
+        }
+        // only changed at the end, all changes are reported once it is
+        info.setUserTime(rounds);
+        xcb_flush(c);
+    };
+
+    int invocations = 0;
+    NET::Properties properties;
+    NET::Properties2 properties2;
+    auto connection = connect(KWindowSystem::self(),
+                              qOverload<WId, NET::Properties, NET::Properties2>(&KWindowSystem::windowChanged),
+                              this,
+                              [&](WId changedWindow, NET::Properties changed, NET::Properties2 changed2) {
+                                  if (changedWindow == window) {
+                                      ++invocations;
+                                      properties |= changed;
+                                      properties2 |= changed2;
+                                  }
+                              });
+    auto cleanup = qScopeGuard([connection] {
+        KWindowSystem::setWindowChangesCoalesced(false);
+        QObject::disconnect(connection);
+    });
+
+    churn();
+    QTRY_VERIFY(properties2 & NET::WM2UserTime);
+    QVERIFY(invocations >= rounds * 3 + 1);
+    const int uncoalescedInvocations = invocations;
+
+    KWindowSystem::setWindowChangesCoalesced(true);
+    invocations = 0;
+    properties = NET::Properties();
+    properties2 = NET::Properties2();
+    churn();
+    QTRY_VERIFY(properties2 & NET::WM2UserTime);
+    // at most one per batch of events, each round was flushed on its own
+    QVERIFY(invocations <= rounds + 1);
+    QVERIFY(invocations < uncoalescedInvocations);
+    QVERIFY((properties & NET::WMName) && (properties & NET::WMIconName));
+    QVERIFY(properties2 & NET::WM2DesktopFileName);
+}
+
+void KWindowSystemX11Test::testChangesSince()
+{
+    // starts tracking the changes
+    KWindowChanges changes = KWindowSystem::changesSince(0);
+    QVERIFY(changes.resyncNeeded);
+    const quint64 start = changes.generation;
+    QVERIFY(!KWindowSystem::changesSince(start).resyncNeeded);
+
+    auto changeOf = [](const KWindowChanges &changes, WId window) {
+        for (const KWindowChange &change : changes.changes) {
+            if (change.window == window) {
+                return change;
+            }
+        }
+        return KWindowChange();
+    };
+
+    QScopedPointer<QWidget> widget(new QWidget);
+    widget->show();
+    QVERIFY(QTest::qWaitForWindowExposed(widget.data()));
+    const WId window = widget->winId();
+    QTRY_VERIFY(changeOf(KWindowSystem::changesSince(start), window).kinds & KWindowChange::Added);
+    const quint64 added = KWindowSystem::changesSince(start).generation;
+
+    NETWinInfo info(QX11Info::connection(), window, QX11Info::appRootWindow(), NET::Properties(), NET::Properties2());
+    info.setName("changesSince");
+    xcb_flush(QX11Info::connection());
+    QTRY_VERIFY(changeOf(KWindowSystem::changesSince(added), window).properties & NET::WMName);
+    changes = KWindowSystem::changesSince(added);
+    QVERIFY(!changes.resyncNeeded);
+    QVERIFY(changes.generation > added);
+    QVERIFY(!(changeOf(changes, window).kinds & KWindowChange::Added));
+    QVERIFY(changeOf(changes, window).kinds & KWindowChange::Changed);
+    // compacted to one change per window
+    QCOMPARE(int(std::count_if(changes.changes.cbegin(),
+                               changes.changes.cend(),
+                               [window](const KWindowChange &change) {
+                                   return change.window == window;
+                               })),
+             1);
+    QVERIFY(changeOf(KWindowSystem::changesSince(start), window).kinds & KWindowChange::Added);
+
+    widget->hide();
+    QTRY_VERIFY(changeOf(KWindowSystem::changesSince(added), window).kinds & KWindowChange::Removed);
+    // the window came and went after the start
+    QCOMPARE(changeOf(KWindowSystem::changesSince(start), window).window, WId(0));
+
+    // only a limited number of changes is kept
+    widget.reset(new QWidget);
+    widget->show();
+    QVERIFY(QTest::qWaitForWindowExposed(widget.data()));
+    const quint64 beforeChurn = KWindowSystem::changesSince(start).generation;
+    NETWinInfo churnInfo(QX11Info::connection(), widget->winId(), QX11Info::appRootWindow(), NET::Properties(), NET::Properties2());
+    for (int i = 0; i < 5000; ++i) {
+        churnInfo.setName(QByteArray::number(i).constData());
+    }
+    xcb_flush(QX11Info::connection());
+    QTRY_VERIFY(KWindowSystem::changesSince(beforeChurn).resyncNeeded);
+    QVERIFY(!KWindowSystem::changesSince(KWindowSystem::changesSince(beforeChurn).generation).resyncNeeded);
+}
+
 void KWindowSystemX11Test::testPlatformX11()
 {
     QCOMPARE(KWindowSystem::platform(), KWindowSystem::Platform::X11);
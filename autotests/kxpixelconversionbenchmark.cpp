@@ -0,0 +1,122 @@
+/*
+    SPDX-FileCopyrightText: 2022 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#include "kxpixelconversiontesthelper.h"
+
+#include <QImage>
+#include <QRandomGenerator>
+#include <QTest>
+
+#include <vector>
+
+using namespace KXUtils::PixelConversion;
+
+// the largest icon size applications commonly provide
+static const int s_size = 256;
+static const int s_pixelCount = s_size * s_size;
+
+class KXPixelConversionBenchmark : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+
+    void benchmarkConvertRgb30_data();
+    void benchmarkConvertRgb30();
+    void benchmarkPremultiply_data();
+    void benchmarkPremultiply();
+    void benchmarkApplyMask_data();
+    void benchmarkApplyMask();
+    void benchmarkQtPremultiply();
+
+private:
+    std::vector<uint32_t> m_pixels;
+    std::vector<uchar> m_mask;
+};
+
+void KXPixelConversionBenchmark::initTestCase()
+{
+    QRandomGenerator random(42);
+    m_pixels.resize(s_pixelCount);
+    random.fillRange(m_pixels.data(), m_pixels.size());
+    // a round icon, mostly opaque rows
+    m_mask.assign(s_size / 8 * s_size, 0);
+    for (int y = 0; y < s_size; ++y) {
+        for (int x = 0; x < s_size; ++x) {
+            const int dx = x - s_size / 2;
+            const int dy = y - s_size / 2;
+            if (dx * dx + dy * dy < s_size * s_size / 4) {
+                m_mask[(y * s_size + x) / 8] |= 1 << (x % 8);
+            }
+        }
+    }
+}
+
+void KXPixelConversionBenchmark::benchmarkConvertRgb30_data()
+{
+    addKernelRows();
+}
+
+void KXPixelConversionBenchmark::benchmarkConvertRgb30()
+{
+    QFETCH(Kernel, kernel);
+    if (!isSupported(kernel)) {
+        QSKIP("Not supported on this CPU");
+    }
+    std::vector<uint32_t> pixels = m_pixels;
+    QBENCHMARK {
+        // converting in place, what the input is doesn't matter for the speed
+        RUN_KERNEL(kernel, convertRgb30, pixels.data(), s_pixelCount)
+    }
+}
+
+void KXPixelConversionBenchmark::benchmarkPremultiply_data()
+{
+    addKernelRows();
+}
+
+void KXPixelConversionBenchmark::benchmarkPremultiply()
+{
+    QFETCH(Kernel, kernel);
+    if (!isSupported(kernel)) {
+        QSKIP("Not supported on this CPU");
+    }
+    std::vector<uint32_t> pixels(s_pixelCount);
+    QBENCHMARK {
+        RUN_KERNEL(kernel, premultiply, m_pixels.data(), pixels.data(), s_pixelCount)
+    }
+}
+
+void KXPixelConversionBenchmark::benchmarkApplyMask_data()
+{
+    addKernelRows();
+}
+
+void KXPixelConversionBenchmark::benchmarkApplyMask()
+{
+    QFETCH(Kernel, kernel);
+    if (!isSupported(kernel)) {
+        QSKIP("Not supported on this CPU");
+    }
+    std::vector<uint32_t> pixels = m_pixels;
+    QBENCHMARK {
+        RUN_KERNEL(kernel, applyMask, pixels.data(), m_mask.data(), s_pixelCount)
+    }
+}
+
+void KXPixelConversionBenchmark::benchmarkQtPremultiply()
+{
+    // for comparison, what the icon import used before
+    const QImage image(reinterpret_cast<const uchar *>(m_pixels.data()), s_size, s_size, QImage::Format_ARGB32);
+    QBENCHMARK {
+        const QImage result = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+        QVERIFY(!result.isNull());
+    }
+}
+
+QTEST_MAIN(KXPixelConversionBenchmark)
+
+#include "kxpixelconversionbenchmark.moc"
@@ -0,0 +1,112 @@
+/*
+    SPDX-FileCopyrightText: 2022 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#include "kxpixelconversiontesthelper.h"
+
+#include <QColor>
+#include <QRandomGenerator>
+#include <QTest>
+
+#include <algorithm>
+#include <vector>
+
+using namespace KXUtils::PixelConversion;
+
+class KXPixelConversionTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+
+    void testKernels_data();
+    void testKernels();
+    void testPremultiply();
+    void testApplyMask();
+
+private:
+    std::vector<uint32_t> m_pixels;
+    std::vector<uchar> m_mask;
+};
+
+void KXPixelConversionTest::initTestCase()
+{
+    QRandomGenerator random(42);
+    m_pixels.resize(1024);
+    random.fillRange(m_pixels.data(), m_pixels.size());
+    // partially opaque rows
+    m_mask.resize(m_pixels.size() / 8);
+    for (uchar &bits : m_mask) {
+        bits = random.bounded(256);
+    }
+}
+
+void KXPixelConversionTest::testKernels_data()
+{
+    addKernelRows();
+}
+
+void KXPixelConversionTest::testKernels()
+{
+    QFETCH(Kernel, kernel);
+    if (!isSupported(kernel)) {
+        QSKIP("Not supported on this CPU");
+    }
+
+    // odd counts exercise the scalar tails
+    for (int count : {0, 1, 7, 8, 9, 31, 257}) {
+        std::vector<uint32_t> expected(m_pixels.begin(), m_pixels.begin() + count);
+        std::vector<uint32_t> pixels = expected;
+        Scalar::convertRgb30(expected.data(), count);
+        RUN_KERNEL(kernel, convertRgb30, pixels.data(), count)
+        QVERIFY(pixels == expected);
+
+        expected.assign(m_pixels.begin(), m_pixels.begin() + count);
+        pixels = expected;
+        Scalar::setOpaque(expected.data(), count);
+        RUN_KERNEL(kernel, setOpaque, pixels.data(), count)
+        QVERIFY(pixels == expected);
+
+        expected.assign(m_pixels.begin(), m_pixels.begin() + count);
+        pixels.assign(count, 0);
+        Scalar::premultiply(m_pixels.data(), expected.data(), count);
+        RUN_KERNEL(kernel, premultiply, m_pixels.data(), pixels.data(), count)
+        QVERIFY(pixels == expected);
+
+        expected.assign(m_pixels.begin(), m_pixels.begin() + count);
+        pixels = expected;
+        const uchar *mask = m_mask.data() + m_mask.size() / 2;
+        Scalar::applyMask(expected.data(), mask, count);
+        RUN_KERNEL(kernel, applyMask, pixels.data(), mask, count)
+        QVERIFY(pixels == expected);
+    }
+}
+
+void KXPixelConversionTest::testPremultiply()
+{
+    for (uint32_t pixel : {0x00000000u, 0x00ffffffu, 0x80ff8000u, 0xff123456u, 0x01ffffffu, 0xfe010203u}) {
+        uint32_t result = 0;
+        premultiply(&pixel, &result, 1);
+        QCOMPARE(result, qPremultiply(pixel));
+    }
+}
+
+void KXPixelConversionTest::testApplyMask()
+{
+    uint32_t pixels[10];
+    std::fill(pixels, pixels + 10, 0xffffffff);
+    const uchar mask[] = {0x81, 0x02};
+    applyMask(pixels, mask, 10);
+    QCOMPARE(pixels[0], 0xffffffffu);
+    QCOMPARE(pixels[1], 0u);
+    QCOMPARE(pixels[6], 0u);
+    QCOMPARE(pixels[7], 0xffffffffu);
+    QCOMPARE(pixels[8], 0u);
+    QCOMPARE(pixels[9], 0xffffffffu);
+}
+
+QTEST_MAIN(KXPixelConversionTest)
+
+#include "kxpixelconversiontest.moc"
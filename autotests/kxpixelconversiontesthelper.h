@@ -0,0 +1,82 @@
+/*
+    SPDX-FileCopyrightText: 2022 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+#ifndef KXPIXELCONVERSIONTESTHELPER_H
+#define KXPIXELCONVERSIONTESTHELPER_H
+
+#include <kxpixelconversion_p.h>
+
+#include <QTest>
+
+// the implementations of the conversions, to run each of them on its own
+enum class Kernel {
+    Scalar,
+    Sse2,
+    Avx2,
+    Dispatched,
+};
+Q_DECLARE_METATYPE(Kernel)
+
+inline bool isSupported(Kernel kernel)
+{
+    switch (kernel) {
+    case Kernel::Scalar:
+    case Kernel::Dispatched:
+        return true;
+    case Kernel::Sse2:
+#if defined(__SSE2__)
+        return true;
+#else
+        return false;
+#endif
+    case Kernel::Avx2:
+#if defined(KXUTILS_HAVE_AVX2)
+        return KXUtils::PixelConversion::Avx2::isSupported();
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+// runs the @p function of the namespace of the @p kernel, KXUtils::PixelConversion has to be used
+#if defined(__SSE2__)
+#define SSE2_KERNEL(function, ...) Sse2::function(__VA_ARGS__)
+#else
+#define SSE2_KERNEL(function, ...) Q_UNREACHABLE()
+#endif
+#if defined(KXUTILS_HAVE_AVX2)
+#define AVX2_KERNEL(function, ...) Avx2::function(__VA_ARGS__)
+#else
+#define AVX2_KERNEL(function, ...) Q_UNREACHABLE()
+#endif
+
+#define RUN_KERNEL(kernel, function, ...)                                                                                                                      \
+    switch (kernel) {                                                                                                                                          \
+    case Kernel::Scalar:                                                                                                                                       \
+        Scalar::function(__VA_ARGS__);                                                                                                                         \
+        break;                                                                                                                                                 \
+    case Kernel::Sse2:                                                                                                                                         \
+        SSE2_KERNEL(function, __VA_ARGS__);                                                                                                                    \
+        break;                                                                                                                                                 \
+    case Kernel::Avx2:                                                                                                                                         \
+        AVX2_KERNEL(function, __VA_ARGS__);                                                                                                                    \
+        break;                                                                                                                                                 \
+    case Kernel::Dispatched:                                                                                                                                   \
+        function(__VA_ARGS__);                                                                                                                                 \
+        break;                                                                                                                                                 \
+    }
+
+inline void addKernelRows()
+{
+    QTest::addColumn<Kernel>("kernel");
+
+    QTest::newRow("scalar") << Kernel::Scalar;
+    QTest::newRow("sse2") << Kernel::Sse2;
+    QTest::newRow("avx2") << Kernel::Avx2;
+    QTest::newRow("dispatched") << Kernel::Dispatched;
+}
+
+#endif
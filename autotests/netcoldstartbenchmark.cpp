@@ -0,0 +1,98 @@
+/*
+    SPDX-FileCopyrightText: 2022 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#include "kwindowsystem.h"
+#include <netwm.h>
+
+#include <qtest_widgets.h>
+
+// Each connection gets its own atoms, so a fresh connection measures what a short
+// lived client pays until it knows the active window.
+// The connections have to stay alive during the measurement, the atoms are cached
+// per connection pointer, which could otherwise be reused for the next connection.
+static const int s_connectionCount = 50;
+
+class NetColdStartBenchmark : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void cleanup();
+
+    void benchmarkConnect();
+    void benchmarkActiveWindow();
+    void benchmarkWindowInfo();
+
+private:
+    xcb_connection_t *connect();
+    QList<xcb_connection_t *> m_connections;
+};
+
+void NetColdStartBenchmark::initTestCase()
+{
+    if (!KWindowSystem::isPlatformX11()) {
+        QSKIP("This test requires X11");
+    }
+}
+
+void NetColdStartBenchmark::cleanup()
+{
+    while (!m_connections.isEmpty()) {
+        xcb_disconnect(m_connections.takeFirst());
+    }
+}
+
+xcb_connection_t *NetColdStartBenchmark::connect()
+{
+    xcb_connection_t *c = xcb_connect(nullptr, nullptr);
+    m_connections << c;
+    return c;
+}
+
+void NetColdStartBenchmark::benchmarkConnect()
+{
+    // the baseline, what the other benchmarks spend without any atom
+    QBENCHMARK_ONCE {
+        for (int i = 0; i < s_connectionCount; ++i) {
+            xcb_connection_t *c = connect();
+            QVERIFY(!xcb_connection_has_error(c));
+            // one round trip, like reading the active window does
+            free(xcb_get_input_focus_reply(c, xcb_get_input_focus(c), nullptr));
+        }
+    }
+}
+
+void NetColdStartBenchmark::benchmarkActiveWindow()
+{
+    QBENCHMARK_ONCE {
+        for (int i = 0; i < s_connectionCount; ++i) {
+            xcb_connection_t *c = connect();
+            QVERIFY(!xcb_connection_has_error(c));
+            NETRootInfo info(c, NET::ActiveWindow);
+            Q_UNUSED(info.activeWindow())
+        }
+    }
+}
+
+void NetColdStartBenchmark::benchmarkWindowInfo()
+{
+    QBENCHMARK_ONCE {
+        for (int i = 0; i < s_connectionCount; ++i) {
+            xcb_connection_t *c = connect();
+            QVERIFY(!xcb_connection_has_error(c));
+            xcb_window_t root = xcb_setup_roots_iterator(xcb_get_setup(c)).data->root;
+            NETRootInfo rootInfo(c, NET::ActiveWindow);
+            if (rootInfo.activeWindow() != XCB_WINDOW_NONE) {
+                NETWinInfo info(c, rootInfo.activeWindow(), root, NET::WMName | NET::WMState, NET::Properties2());
+                Q_UNUSED(info.name())
+            }
+        }
+    }
+}
+
+QTEST_MAIN(NetColdStartBenchmark)
+
+#include "netcoldstartbenchmark.moc"
@@ -0,0 +1,239 @@
+/*
+    SPDX-FileCopyrightText: 2022 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#include "kwindowsystem.h"
+#include "nettesthelper.h"
+#include <netwm.h>
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+#include <private/qtx11extras_p.h>
+#else
+#include <QX11Info>
+#endif
+#include <qtest_widgets.h>
+
+Q_DECLARE_METATYPE(NET::Properties)
+Q_DECLARE_METATYPE(NET::Properties2)
+
+static const int s_eventCount = 10000;
+
+// Measures how fast NETWinInfo and NETRootInfo map events to dirty properties.
+// The infos are not interested in any property, so no request reaches the X server.
+class NetEventBenchmark : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void benchmarkWinInfoPropertyNotify_data();
+    void benchmarkWinInfoPropertyNotify();
+    void benchmarkRootInfoPropertyNotify_data();
+    void benchmarkRootInfoPropertyNotify();
+    void benchmarkWinInfoStateMessage();
+    void benchmarkTemporaryWinInfo_data();
+    void benchmarkTemporaryWinInfo();
+    void benchmarkDirtyProperties_data();
+    void benchmarkDirtyProperties();
+
+private:
+    xcb_connection_t *m_connection = nullptr;
+    xcb_window_t m_window = XCB_WINDOW_NONE;
+};
+
+void NetEventBenchmark::initTestCase()
+{
+    if (!KWindowSystem::isPlatformX11()) {
+        QSKIP("This test requires X11");
+    }
+    m_connection = QX11Info::connection();
+    m_window = xcb_generate_id(m_connection);
+    xcb_create_window(m_connection,
+                      XCB_COPY_FROM_PARENT,
+                      m_window,
+                      QX11Info::appRootWindow(),
+                      0,
+                      0,
+                      10,
+                      10,
+                      0,
+                      XCB_COPY_FROM_PARENT,
+                      XCB_COPY_FROM_PARENT,
+                      0,
+                      nullptr);
+    xcb_flush(m_connection);
+}
+
+void NetEventBenchmark::cleanupTestCase()
+{
+    if (m_window != XCB_WINDOW_NONE) {
+        xcb_destroy_window(m_connection, m_window);
+        xcb_flush(m_connection);
+    }
+}
+
+void NetEventBenchmark::benchmarkWinInfoPropertyNotify_data()
+{
+    QTest::addColumn<QByteArray>("atomName");
+    QTest::addColumn<NET::Properties>("properties");
+    QTest::addColumn<NET::Properties2>("properties2");
+
+    QTest::newRow("name") << QByteArrayLiteral("_NET_WM_NAME") << NET::Properties(NET::WMName) << NET::Properties2();
+    QTest::newRow("hints") << QByteArrayLiteral("WM_HINTS") << NET::Properties()
+                           << (NET::WM2GroupLeader | NET::WM2Urgency | NET::WM2Input | NET::WM2InitialMappingState | NET::WM2IconPixmap);
+    QTest::newRow("appmenu") << QByteArrayLiteral("_KDE_NET_WM_APPMENU_OBJECT_PATH") << NET::Properties() << NET::Properties2(NET::WM2AppMenuObjectPath);
+    QTest::newRow("unknown") << QByteArrayLiteral("_KWINDOWSYSTEM_BENCHMARK") << NET::Properties() << NET::Properties2();
+}
+
+void NetEventBenchmark::benchmarkWinInfoPropertyNotify()
+{
+    QFETCH(QByteArray, atomName);
+    KXUtils::Atom atom(m_connection, atomName);
+
+    NETWinInfo info(m_connection, m_window, QX11Info::appRootWindow(), NET::Properties(), NET::Properties2());
+    xcb_property_notify_event_t event = {};
+    event.response_type = XCB_PROPERTY_NOTIFY;
+    event.window = m_window;
+    event.atom = atom;
+    event.state = XCB_PROPERTY_NEW_VALUE;
+
+    NET::Properties dirty;
+    NET::Properties2 dirty2;
+    QBENCHMARK {
+        for (int i = 0; i < s_eventCount; ++i) {
+            info.event(reinterpret_cast<xcb_generic_event_t *>(&event), &dirty, &dirty2);
+        }
+    }
+    QTEST(dirty, "properties");
+    QTEST(dirty2, "properties2");
+}
+
+void NetEventBenchmark::benchmarkRootInfoPropertyNotify_data()
+{
+    QTest::addColumn<QByteArray>("atomName");
+    QTest::addColumn<NET::Properties>("properties");
+    QTest::addColumn<NET::Properties2>("properties2");
+
+    QTest::newRow("clientList") << QByteArrayLiteral("_NET_CLIENT_LIST") << NET::Properties(NET::ClientList) << NET::Properties2();
+    QTest::newRow("desktopLayout") << QByteArrayLiteral("_NET_DESKTOP_LAYOUT") << NET::Properties() << NET::Properties2(NET::WM2DesktopLayout);
+    QTest::newRow("unknown") << QByteArrayLiteral("_KWINDOWSYSTEM_BENCHMARK") << NET::Properties() << NET::Properties2();
+}
+
+void NetEventBenchmark::benchmarkRootInfoPropertyNotify()
+{
+    QFETCH(QByteArray, atomName);
+    KXUtils::Atom atom(m_connection, atomName);
+
+    NETRootInfo info(m_connection, NET::Properties(), NET::Properties2());
+    xcb_property_notify_event_t event = {};
+    event.response_type = XCB_PROPERTY_NOTIFY;
+    event.window = QX11Info::appRootWindow();
+    event.atom = atom;
+    event.state = XCB_PROPERTY_NEW_VALUE;
+
+    NET::Properties dirty;
+    NET::Properties2 dirty2;
+    QBENCHMARK {
+        for (int i = 0; i < s_eventCount; ++i) {
+            info.event(reinterpret_cast<xcb_generic_event_t *>(&event), &dirty, &dirty2);
+        }
+    }
+    QTEST(dirty, "properties");
+    QTEST(dirty2, "properties2");
+}
+
+void NetEventBenchmark::benchmarkWinInfoStateMessage()
+{
+    KXUtils::Atom netWmState(m_connection, QByteArrayLiteral("_NET_WM_STATE"));
+    KXUtils::Atom focused(m_connection, QByteArrayLiteral("_NET_WM_STATE_FOCUSED"));
+    KXUtils::Atom staysOnTop(m_connection, QByteArrayLiteral("_NET_WM_STATE_STAYS_ON_TOP"));
+
+    // the window manager role handles the client messages, the base class ignores the change requests
+    NETWinInfo info(m_connection, m_window, QX11Info::appRootWindow(), NET::Properties(), NET::Properties2(), NET::WindowManager);
+    xcb_client_message_event_t event = {};
+    event.response_type = XCB_CLIENT_MESSAGE;
+    event.format = 32;
+    event.window = m_window;
+    event.type = netWmState;
+    event.data.data32[0] = 1; // set
+    event.data.data32[1] = focused;
+    event.data.data32[2] = staysOnTop;
+
+    NET::Properties dirty;
+    QBENCHMARK {
+        for (int i = 0; i < s_eventCount; ++i) {
+            info.event(reinterpret_cast<xcb_generic_event_t *>(&event), &dirty);
+        }
+    }
+    QCOMPARE(dirty, NET::Properties(NET::WMState));
+}
+
+void NetEventBenchmark::benchmarkTemporaryWinInfo_data()
+{
+    benchmarkWinInfoPropertyNotify_data();
+}
+
+void NetEventBenchmark::benchmarkTemporaryWinInfo()
+{
+    QFETCH(QByteArray, atomName);
+    KXUtils::Atom atom(m_connection, atomName);
+
+    xcb_property_notify_event_t event = {};
+    event.response_type = XCB_PROPERTY_NOTIFY;
+    event.window = m_window;
+    event.atom = atom;
+    event.state = XCB_PROPERTY_NEW_VALUE;
+
+    // what one has to do to classify an event without a long living NETWinInfo
+    NET::Properties dirty;
+    NET::Properties2 dirty2;
+    QBENCHMARK {
+        for (int i = 0; i < s_eventCount; ++i) {
+            NETWinInfo info(m_connection, m_window, QX11Info::appRootWindow(), NET::Properties(), NET::Properties2());
+            info.event(reinterpret_cast<xcb_generic_event_t *>(&event), &dirty, &dirty2);
+        }
+    }
+    QTEST(dirty, "properties");
+    QTEST(dirty2, "properties2");
+}
+
+void NetEventBenchmark::benchmarkDirtyProperties_data()
+{
+    benchmarkWinInfoPropertyNotify_data();
+}
+
+void NetEventBenchmark::benchmarkDirtyProperties()
+{
+    QFETCH(QByteArray, atomName);
+    KXUtils::Atom atom(m_connection, atomName);
+
+    xcb_property_notify_event_t event = {};
+    event.response_type = XCB_PROPERTY_NOTIFY;
+    event.window = m_window;
+    event.atom = atom;
+    event.state = XCB_PROPERTY_NEW_VALUE;
+
+    NET::Properties dirty;
+    NET::Properties2 dirty2;
+    QBENCHMARK {
+        for (int i = 0; i < s_eventCount; ++i) {
+            NETWinInfo::dirtyProperties(m_connection, reinterpret_cast<xcb_generic_event_t *>(&event), &dirty, &dirty2);
+        }
+    }
+    QTEST(dirty, "properties");
+    QTEST(dirty2, "properties2");
+
+    xcb_configure_notify_event_t configure = {};
+    configure.response_type = XCB_CONFIGURE_NOTIFY;
+    configure.window = m_window;
+    NETWinInfo::dirtyProperties(m_connection, reinterpret_cast<xcb_generic_event_t *>(&configure), &dirty, &dirty2);
+    QCOMPARE(dirty, NET::Properties(NET::WMGeometry));
+    QCOMPARE(dirty2, NET::Properties2());
+}
+
+QTEST_MAIN(NetEventBenchmark)
+
+#include "neteventbenchmark.moc"
@@ -0,0 +1,156 @@
+/*
+    SPDX-FileCopyrightText: 2022 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#include "kwindowsystem.h"
+#include <netwm.h>
+
+#include <QImage>
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+#include <private/qtx11extras_p.h>
+#else
+#include <QX11Info>
+#endif
+#include <qtest_widgets.h>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#if __GLIBC_PREREQ(2, 33)
+#define HAVE_MALLINFO2 1
+#endif
+#endif
+
+#include <vector>
+
+// what applications typically ship, about 350 KiB of icon data
+static const int s_iconSizes[] = {16, 22, 24, 32, 48, 64, 128, 256};
+
+class NetWinIconBenchmark : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void testHeapUsage();
+    void benchmarkReadIcons();
+    void benchmarkFetchIcon_data();
+    void benchmarkFetchIcon();
+    void benchmarkIconImage();
+
+private:
+    xcb_connection_t *m_connection = nullptr;
+    xcb_window_t m_window = XCB_WINDOW_NONE;
+    size_t m_iconBytes = 0;
+};
+
+static uint32_t pixel(int size, int x, int y)
+{
+    return 0xff000000 | (size << 16) | (x << 8) | y;
+}
+
+void NetWinIconBenchmark::initTestCase()
+{
+    if (!KWindowSystem::isPlatformX11()) {
+        QSKIP("This test requires X11");
+    }
+    m_connection = QX11Info::connection();
+    m_window = xcb_generate_id(m_connection);
+    xcb_create_window(m_connection,
+                      XCB_COPY_FROM_PARENT,
+                      m_window,
+                      QX11Info::appRootWindow(),
+                      0,
+                      0,
+                      10,
+                      10,
+                      0,
+                      XCB_COPY_FROM_PARENT,
+                      XCB_COPY_FROM_PARENT,
+                      0,
+                      nullptr);
+
+    std::vector<uint32_t> property;
+    for (int size : s_iconSizes) {
+        property.push_back(size);
+        property.push_back(size);
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+                property.push_back(pixel(size, x, y));
+            }
+        }
+        m_iconBytes += size * size * sizeof(uint32_t);
+    }
+    KXUtils::Atom netWmIcon(m_connection, QByteArrayLiteral("_NET_WM_ICON"));
+    xcb_change_property(m_connection, XCB_PROP_MODE_REPLACE, m_window, netWmIcon, XCB_ATOM_CARDINAL, 32, property.size(), property.data());
+    xcb_flush(m_connection);
+}
+
+void NetWinIconBenchmark::cleanupTestCase()
+{
+    if (m_window != XCB_WINDOW_NONE) {
+        xcb_destroy_window(m_connection, m_window);
+        xcb_flush(m_connection);
+    }
+}
+
+void NetWinIconBenchmark::testHeapUsage()
+{
+#ifdef HAVE_MALLINFO2
+    const size_t before = mallinfo2().uordblks;
+    NETWinInfo info(m_connection, m_window, QX11Info::appRootWindow(), NET::WMIcon, NET::Properties2());
+    const size_t after = mallinfo2().uordblks;
+    QVERIFY(info.icon().data);
+
+    const size_t used = after > before ? after - before : 0;
+    qDebug() << "icon data:" << m_iconBytes << "bytes, heap used by the info:" << used << "bytes";
+    // one reply, no second copy of the icons
+    QVERIFY(used < m_iconBytes * 3 / 2);
+#else
+    QSKIP("Needs glibc to measure the heap usage");
+#endif
+}
+
+void NetWinIconBenchmark::benchmarkReadIcons()
+{
+    QBENCHMARK {
+        NETWinInfo info(m_connection, m_window, QX11Info::appRootWindow(), NET::WMIcon, NET::Properties2());
+        QVERIFY(info.icon().data);
+    }
+}
+
+void NetWinIconBenchmark::benchmarkFetchIcon_data()
+{
+    QTest::addColumn<int>("size");
+
+    QTest::newRow("16") << 16;
+    QTest::newRow("48") << 48;
+    QTest::newRow("256") << 256;
+}
+
+void NetWinIconBenchmark::benchmarkFetchIcon()
+{
+    QFETCH(int, size);
+    QBENCHMARK {
+        NETWinInfo info(m_connection, m_window, QX11Info::appRootWindow(), NET::Properties(), NET::Properties2());
+        info.fetchIcon(size, size);
+        QVERIFY(info.icon().data);
+    }
+}
+
+void NetWinIconBenchmark::benchmarkIconImage()
+{
+    NETWinInfo info(m_connection, m_window, QX11Info::appRootWindow(), NET::WMIcon, NET::Properties2());
+    QBENCHMARK {
+        for (int size : s_iconSizes) {
+            const QImage image = info.iconImage(size, size);
+            QVERIFY(!image.isNull());
+        }
+    }
+}
+
+QTEST_MAIN(NetWinIconBenchmark)
+
+#include "netwiniconbenchmark.moc"
@@ -0,0 +1,169 @@
+/*
+    SPDX-FileCopyrightText: 2022 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#include "kwindowsystem.h"
+#include <netwm.h>
+
+#include <QImage>
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+#include <private/qtx11extras_p.h>
+#else
+#include <QX11Info>
+#endif
+#include <qtest_widgets.h>
+
+#include <cstring>
+#include <vector>
+
+// what applications typically ship
+static const int s_iconSizes[] = {16, 22, 24, 32, 48, 64, 128, 256};
+
+class NetWinIconTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void testIcons();
+    void testIconImageLifetime();
+    void testFetchIcon_data();
+    void testFetchIcon();
+
+private:
+    xcb_connection_t *m_connection = nullptr;
+    xcb_window_t m_window = XCB_WINDOW_NONE;
+};
+
+static uint32_t pixel(int size, int x, int y)
+{
+    return 0xff000000 | (size << 16) | (x << 8) | y;
+}
+
+void NetWinIconTest::initTestCase()
+{
+    if (!KWindowSystem::isPlatformX11()) {
+        QSKIP("This test requires X11");
+    }
+    m_connection = QX11Info::connection();
+    m_window = xcb_generate_id(m_connection);
+    xcb_create_window(m_connection,
+                      XCB_COPY_FROM_PARENT,
+                      m_window,
+                      QX11Info::appRootWindow(),
+                      0,
+                      0,
+                      10,
+                      10,
+                      0,
+                      XCB_COPY_FROM_PARENT,
+                      XCB_COPY_FROM_PARENT,
+                      0,
+                      nullptr);
+
+    std::vector<uint32_t> property;
+    for (int size : s_iconSizes) {
+        property.push_back(size);
+        property.push_back(size);
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+                property.push_back(pixel(size, x, y));
+            }
+        }
+    }
+    KXUtils::Atom netWmIcon(m_connection, QByteArrayLiteral("_NET_WM_ICON"));
+    xcb_change_property(m_connection, XCB_PROP_MODE_REPLACE, m_window, netWmIcon, XCB_ATOM_CARDINAL, 32, property.size(), property.data());
+    xcb_flush(m_connection);
+}
+
+void NetWinIconTest::cleanupTestCase()
+{
+    if (m_window != XCB_WINDOW_NONE) {
+        xcb_destroy_window(m_connection, m_window);
+        xcb_flush(m_connection);
+    }
+}
+
+void NetWinIconTest::testIcons()
+{
+    NETWinInfo info(m_connection, m_window, QX11Info::appRootWindow(), NET::WMIcon, NET::Properties2());
+    const int *sizes = info.iconSizes();
+    for (int size : s_iconSizes) {
+        QCOMPARE(sizes[0], size);
+        QCOMPARE(sizes[1], size);
+        sizes += 2;
+
+        const NETIcon icon = info.icon(size, size);
+        QCOMPARE(icon.size.width, size);
+        const uint32_t *data = reinterpret_cast<const uint32_t *>(icon.data);
+        QCOMPARE(data[0], pixel(size, 0, 0));
+        QCOMPARE(data[size * size - 1], pixel(size, size - 1, size - 1));
+
+        const QImage image = info.iconImage(size, size);
+        QCOMPARE(image.size(), QSize(size, size));
+        QCOMPARE(image.format(), QImage::Format_ARGB32);
+        // no copy
+        QVERIFY(image.constBits() == icon.data);
+        QCOMPARE(image.pixel(size - 1, 1), pixel(size, size - 1, 1));
+    }
+    QCOMPARE(*sizes, 0);
+
+    // the largest one without size
+    QCOMPARE(info.iconImage().size(), QSize(256, 256));
+}
+
+void NetWinIconTest::testIconImageLifetime()
+{
+    QImage image;
+    {
+        NETWinInfo info(m_connection, m_window, QX11Info::appRootWindow(), NET::WMIcon, NET::Properties2());
+        image = info.iconImage(48, 48);
+        QCOMPARE(image.size(), QSize(48, 48));
+    }
+    // the info is gone, the image keeps the data alive
+    QCOMPARE(image.pixel(47, 47), pixel(48, 47, 47));
+}
+
+void NetWinIconTest::testFetchIcon_data()
+{
+    QTest::addColumn<int>("size");
+    QTest::addColumn<int>("expectedSize");
+
+    QTest::newRow("16") << 16 << 16;
+    QTest::newRow("20") << 20 << 22;
+    QTest::newRow("48") << 48 << 48;
+    QTest::newRow("256") << 256 << 256;
+    QTest::newRow("512") << 512 << 256;
+    QTest::newRow("largest") << -1 << 256;
+}
+
+void NetWinIconTest::testFetchIcon()
+{
+    QFETCH(int, size);
+    QFETCH(int, expectedSize);
+
+    NETWinInfo all(m_connection, m_window, QX11Info::appRootWindow(), NET::WMIcon, NET::Properties2());
+    QCOMPARE(all.icon(size, size).size.width, expectedSize);
+
+    NETWinInfo info(m_connection, m_window, QX11Info::appRootWindow(), NET::Properties(), NET::Properties2());
+    QVERIFY(!info.icon().data);
+    info.fetchIcon(size, size);
+    const NETIcon icon = info.icon(size, size);
+    QCOMPARE(icon.size.width, expectedSize);
+    QCOMPARE(icon.size.height, expectedSize);
+    QVERIFY(icon.data);
+    QCOMPARE(memcmp(icon.data, all.icon(size, size).data, expectedSize * expectedSize * sizeof(uint32_t)), 0);
+
+    // only the fetched one is known
+    const int *sizes = info.iconSizes();
+    QCOMPARE(sizes[0], expectedSize);
+    QCOMPARE(sizes[2], 0);
+    QCOMPARE(info.iconImage().size(), QSize(expectedSize, expectedSize));
+}
+
+QTEST_MAIN(NetWinIconTest)
+
+#include "netwinicontest.moc"
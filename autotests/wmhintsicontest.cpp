@@ -0,0 +1,137 @@
+/*
+    SPDX-FileCopyrightText: 2022 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#include "kwindowsystem.h"
+
+#include <QImage>
+#include <QPixmap>
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+#include <private/qtx11extras_p.h>
+#else
+#include <QX11Info>
+#endif
+#include <qtest_widgets.h>
+
+#include <xcb/xcb_icccm.h>
+
+// Legacy applications set their icon as pixmap in WM_HINTS, KWindowSystem::icon transfers
+// it and its mask from the X server through MIT-SHM or the socket.
+class WMHintsIconTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void cleanup();
+
+    void testIcon_data();
+    void testIcon();
+
+private:
+    xcb_window_t createWindow(int size);
+    QList<xcb_window_t> m_windows;
+    QList<xcb_pixmap_t> m_pixmaps;
+};
+
+static const uint32_t s_color = 0x336699;
+
+void WMHintsIconTest::initTestCase()
+{
+    if (!KWindowSystem::isPlatformX11()) {
+        QSKIP("This test requires X11");
+    }
+}
+
+void WMHintsIconTest::cleanup()
+{
+    qunsetenv("QT_X11_NO_MITSHM");
+    xcb_connection_t *c = QX11Info::connection();
+    if (!c) {
+        return;
+    }
+    for (xcb_window_t w : std::as_const(m_windows)) {
+        xcb_destroy_window(c, w);
+    }
+    for (xcb_pixmap_t p : std::as_const(m_pixmaps)) {
+        xcb_free_pixmap(c, p);
+    }
+    xcb_flush(c);
+    m_windows.clear();
+    m_pixmaps.clear();
+}
+
+// a window with a size x size icon in its color, the right half masked out
+xcb_window_t WMHintsIconTest::createWindow(int size)
+{
+    xcb_connection_t *c = QX11Info::connection();
+    const xcb_window_t root = QX11Info::appRootWindow();
+    const uint8_t depth = xcb_setup_roots_iterator(xcb_get_setup(c)).data->root_depth;
+
+    const xcb_pixmap_t pixmap = xcb_generate_id(c);
+    xcb_create_pixmap(c, depth, pixmap, root, size, size);
+    const xcb_pixmap_t mask = xcb_generate_id(c);
+    xcb_create_pixmap(c, 1, mask, root, size, size);
+    m_pixmaps << pixmap << mask;
+
+    const xcb_rectangle_t all = {0, 0, uint16_t(size), uint16_t(size)};
+    const xcb_rectangle_t left = {0, 0, uint16_t(size / 2), uint16_t(size)};
+
+    xcb_gcontext_t gc = xcb_generate_id(c);
+    xcb_create_gc(c, gc, pixmap, XCB_GC_FOREGROUND, &s_color);
+    xcb_poly_fill_rectangle(c, pixmap, gc, 1, &all);
+    xcb_free_gc(c, gc);
+
+    uint32_t value = 0;
+    gc = xcb_generate_id(c);
+    xcb_create_gc(c, gc, mask, XCB_GC_FOREGROUND, &value);
+    xcb_poly_fill_rectangle(c, mask, gc, 1, &all);
+    value = 1;
+    xcb_change_gc(c, gc, XCB_GC_FOREGROUND, &value);
+    xcb_poly_fill_rectangle(c, mask, gc, 1, &left);
+    xcb_free_gc(c, gc);
+
+    const xcb_window_t w = xcb_generate_id(c);
+    xcb_create_window(c, XCB_COPY_FROM_PARENT, w, root, 0, 0, 10, 10, 0, XCB_COPY_FROM_PARENT, XCB_COPY_FROM_PARENT, 0, nullptr);
+    m_windows << w;
+
+    xcb_icccm_wm_hints_t hints = {};
+    xcb_icccm_wm_hints_set_icon_pixmap(&hints, pixmap);
+    xcb_icccm_wm_hints_set_icon_mask(&hints, mask);
+    xcb_icccm_set_wm_hints(c, w, &hints);
+    xcb_flush(c);
+    return w;
+}
+
+void WMHintsIconTest::testIcon_data()
+{
+    QTest::addColumn<int>("size");
+    QTest::addColumn<bool>("shm");
+
+    for (int size : {16, 64, 256, 1024}) {
+        QTest::addRow("%d shm", size) << size << true;
+        QTest::addRow("%d socket", size) << size << false;
+    }
+}
+
+void WMHintsIconTest::testIcon()
+{
+    QFETCH(int, size);
+    QFETCH(bool, shm);
+    if (!shm) {
+        qputenv("QT_X11_NO_MITSHM", "1");
+    }
+
+    const xcb_window_t w = createWindow(size);
+    const QImage icon = KWindowSystem::icon(w, size, size, false, KWindowSystem::WMHints).toImage();
+    QCOMPARE(icon.size(), QSize(size, size));
+    QCOMPARE(icon.pixel(0, 0), 0xff000000 | s_color);
+    QCOMPARE(icon.pixel(size / 2 - 1, size - 1), 0xff000000 | s_color);
+    QCOMPARE(qAlpha(icon.pixel(size / 2, 0)), 0);
+    QCOMPARE(qAlpha(icon.pixel(size - 1, size - 1)), 0);
+}
+
+QTEST_MAIN(WMHintsIconTest)
+
+#include "wmhintsicontest.moc"
@@ -6,5 +6,8 @@
 /* Define to 1 if you have the Xfixes library */
 #cmakedefine01 KWINDOWSYSTEM_HAVE_XFIXES
 
+/* Define to 1 if you have the xcb MIT-SHM library */
+#cmakedefine01 KWINDOWSYSTEM_HAVE_XCB_SHM
+
 /* Path to xcb plugin */
 #define XCB_PLUGIN_PATH "${KDE_INSTALL_FULL_PLUGINDIR}/kf${QT_MAJOR_VERSION}/kwindowsystem/KF5WindowSystemX11Plugin.so"
@@ -0,0 +1,72 @@
+/*
+    SPDX-FileCopyrightText: 2022 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-or-later
+*/
+
+#include "kwindowchangequeue.h"
+#include "kwindowchangequeue_p.h"
+#include "kwindowsystem.h"
+
+#include <QDeadlineTimer>
+
+bool KWindowChangeQueuePrivate::wait(int msecs)
+{
+    if (!isEmpty()) {
+        return true;
+    }
+    const QDeadlineTimer deadline = msecs < 0 ? QDeadlineTimer(QDeadlineTimer::Forever) : QDeadlineTimer(msecs);
+    QMutexLocker locker(&m_mutex);
+    m_waiting.store(true, std::memory_order_relaxed);
+    // pairs with the fence in push()
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    while (isEmpty() && !m_wokenUp) {
+        if (!m_condition.wait(&m_mutex, deadline)) {
+            break;
+        }
+    }
+    m_waiting.store(false, std::memory_order_relaxed);
+    return !isEmpty();
+}
+
+void KWindowChangeQueuePrivate::wakeUp()
+{
+    QMutexLocker locker(&m_mutex);
+    m_wokenUp = true;
+    m_condition.wakeAll();
+}
+
+KWindowChangeQueue::KWindowChangeQueue(int capacity)
+    : d(new KWindowChangeQueuePrivate(capacity))
+{
+}
+
+KWindowChangeQueue::~KWindowChangeQueue()
+{
+    KWindowSystem::removeChangeQueue(this);
+}
+
+int KWindowChangeQueue::capacity() const
+{
+    return d->capacity();
+}
+
+bool KWindowChangeQueue::tryTake(KWindowChange &change)
+{
+    return d->take(change);
+}
+
+bool KWindowChangeQueue::wait(int msecs)
+{
+    return d->wait(msecs);
+}
+
+void KWindowChangeQueue::wakeUp()
+{
+    d->wakeUp();
+}
+
+quint64 KWindowChangeQueue::droppedCount() const
+{
+    return d->droppedCount();
+}
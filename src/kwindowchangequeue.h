@@ -0,0 +1,100 @@
+/*
+    SPDX-FileCopyrightText: 2022 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-or-later
+*/
+
+#ifndef KWINDOWCHANGEQUEUE_H
+#define KWINDOWCHANGEQUEUE_H
+
+#include <kwindowchanges.h>
+#include <kwindowsystem_export.h>
+
+#include <QScopedPointer>
+
+class KWindowChangeQueuePrivate;
+
+/**
+ * A queue of window changes for a consumer in another thread.
+ *
+ * Once added with KWindowSystem::addChangeQueue(), the main thread puts a
+ * KWindowChange into the queue for each window added, removed or changed,
+ * like the windowAdded(), windowRemoved() and windowChanged() signals report
+ * them. Relaying these signals to another thread with queued connections
+ * allocates an event for each of them; the queue instead is a fixed size ring
+ * buffer, neither side allocates for a change. tryTake() doesn't lock, the main
+ * thread locks the list of the added queues for each change, which is only
+ * contended while a queue is added or removed, and a queue only to wake up
+ * its waiting consumer.
+ *
+ * A single thread may take the changes:
+ * @code
+ * KWindowChangeQueue queue;
+ * KWindowSystem::addChangeQueue(&queue);
+ * // in the consumer thread
+ * KWindowChange change;
+ * while (queue.wait()) {
+ *     while (queue.tryTake(change)) {
+ *         ...
+ *     }
+ * }
+ * @endcode
+ *
+ * If the consumer doesn't keep up and the queue is full, the changes are
+ * dropped and counted, see droppedCount().
+ *
+ * Currently changes are only provided on X11.
+ *
+ * @since 5.96
+ */
+class KWINDOWSYSTEM_EXPORT KWindowChangeQueue
+{
+public:
+    /**
+     * Creates a queue with room for at least @p capacity changes.
+     */
+    explicit KWindowChangeQueue(int capacity = 4096);
+    /**
+     * Removes the queue with KWindowSystem::removeChangeQueue() if that wasn't done yet.
+     */
+    ~KWindowChangeQueue();
+
+    /**
+     * The number of changes the queue can hold.
+     */
+    int capacity() const;
+
+    /**
+     * Takes the oldest change into @p change. Returns false if there is none.
+     * Must only be called from the consumer thread.
+     */
+    bool tryTake(KWindowChange &change);
+
+    /**
+     * Blocks the consumer thread until there are changes to take, for at most
+     * @p msecs milliseconds, or without a limit for -1. Returns whether there
+     * are changes, which is false after a timeout, or after wakeUp() once all
+     * changes were taken.
+     */
+    bool wait(int msecs = -1);
+
+    /**
+     * Makes the current and all later wait() calls return immediately, e.g. to
+     * stop the consumer thread. Can be called from any thread.
+     */
+    void wakeUp();
+
+    /**
+     * The number of changes dropped so far, as the queue was full. The consumer
+     * has to read the state again when it increased, e.g. with
+     * KWindowSystem::windows() and KWindowInfo. Can be called from any thread.
+     */
+    quint64 droppedCount() const;
+
+private:
+    Q_DISABLE_COPY(KWindowChangeQueue)
+    friend class KWindowSystem;
+    const QScopedPointer<KWindowChangeQueuePrivate> d;
+};
+
+#endif
@@ -0,0 +1,112 @@
+/*
+    SPDX-FileCopyrightText: 2022 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-or-later
+*/
+
+#ifndef KWINDOWCHANGEQUEUE_P_H
+#define KWINDOWCHANGEQUEUE_P_H
+
+#include "kwindowchanges.h"
+
+#include <QMutex>
+#include <QWaitCondition>
+
+#include <atomic>
+#include <vector>
+
+/**
+ * The ring buffer of a KWindowChangeQueue. push() is called by the platform in
+ * the main thread, the only producer; take() and wait() by the only consumer.
+ */
+class KWindowChangeQueuePrivate
+{
+public:
+    explicit KWindowChangeQueuePrivate(int capacity)
+    {
+        // a power of two, the positions are masked instead of wrapped around
+        size_t size = 1;
+        while (size < size_t(qMax(capacity, 1))) {
+            size *= 2;
+        }
+        m_changes.resize(size);
+        m_mask = size - 1;
+    }
+
+    int capacity() const
+    {
+        return int(m_changes.size());
+    }
+
+    // returns false when the change was dropped as the queue is full
+    bool push(const KWindowChange &change)
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == m_changes.size()) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        m_changes[tail & m_mask] = change;
+        m_tail.store(tail + 1, std::memory_order_release);
+        // pairs with the fence in wait(): either the consumer sees the new tail,
+        // or it announced it is waiting before we look
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_waiting.load(std::memory_order_relaxed)) {
+            QMutexLocker locker(&m_mutex);
+            m_condition.wakeAll();
+        }
+        return true;
+    }
+
+    bool take(KWindowChange &change)
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        change = m_changes[head & m_mask];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool isEmpty() const
+    {
+        return m_head.load(std::memory_order_relaxed) == m_tail.load(std::memory_order_acquire);
+    }
+
+    bool wait(int msecs);
+    void wakeUp();
+
+    quint64 droppedCount() const
+    {
+        return m_dropped.load(std::memory_order_relaxed);
+    }
+
+    // whether KWindowSystem::addChangeQueue() added the queue to the platform
+    bool isAdded() const
+    {
+        return m_added.load(std::memory_order_acquire);
+    }
+
+    void setAdded(bool added)
+    {
+        m_added.store(added, std::memory_order_release);
+    }
+
+private:
+    std::vector<KWindowChange> m_changes;
+    size_t m_mask = 0;
+    // written by the consumer only
+    std::atomic<size_t> m_head{0};
+    // written by the producer only
+    std::atomic<size_t> m_tail{0};
+    std::atomic<quint64> m_dropped{0};
+    // only used when the consumer has to sleep
+    std::atomic<bool> m_waiting{false};
+    std::atomic<bool> m_added{false};
+    bool m_wokenUp = false;
+    QMutex m_mutex;
+    QWaitCondition m_condition;
+};
+
+#endif
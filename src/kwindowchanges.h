@@ -0,0 +1,78 @@
+/*
+    SPDX-FileCopyrightText: 2022 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-or-later
+*/
+
+#ifndef KWINDOWCHANGES_H
+#define KWINDOWCHANGES_H
+
+#include <QList>
+#include <QWidgetList> //For WId
+
+#include <netwm_def.h>
+
+/**
+ * What happened to a window, as returned in KWindowChanges.
+ *
+ * @since 5.96
+ */
+struct KWindowChange {
+    enum Kind {
+        /**
+         * The window was added.
+         */
+        Added = 0x1,
+        /**
+         * The window was removed. A window added and removed again is not reported at all.
+         */
+        Removed = 0x2,
+        /**
+         * Properties of the window changed.
+         */
+        Changed = 0x4,
+    };
+    Q_DECLARE_FLAGS(Kinds, Kind)
+
+    /**
+     * The window.
+     */
+    WId window = 0;
+    /**
+     * Everything that happened to the window.
+     */
+    Kinds kinds;
+    /**
+     * All properties which changed, when the kinds include Changed.
+     */
+    NET::Properties properties;
+    /**
+     * All properties2 which changed, when the kinds include Changed.
+     */
+    NET::Properties2 properties2;
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(KWindowChange::Kinds)
+
+/**
+ * The window changes since an earlier point in time, see KWindowSystem::changesSince().
+ *
+ * @since 5.96
+ */
+struct KWindowChanges {
+    /**
+     * The generation of the latest change, to pass to the next KWindowSystem::changesSince() call.
+     */
+    quint64 generation = 0;
+    /**
+     * Whether not all changes since the passed generation are known anymore. The
+     * state has to be read again then, e.g. with KWindowSystem::windows() and KWindowInfo.
+     */
+    bool resyncNeeded = false;
+    /**
+     * One entry per changed window, in the order of their first change.
+     */
+    QList<KWindowChange> changes;
+};
+
+#endif
@@ -13,6 +13,7 @@
 
 #include "kwindowinfo_dummy_p.h"
 
+#include <QFutureInterface>
 #include <QRect>
 
 // private
@@ -270,6 +271,22 @@ KWindowInfo::KWindowInfo(WId window, NET::Properties properties, NET::Properties
 {
 }
 
+QFuture<KWindowInfo> KWindowInfo::fetchAsync(WId window, NET::Properties properties, NET::Properties2 properties2)
+{
+    QFutureInterface<KWindowInfo> futureInterface;
+    futureInterface.reportStarted();
+    KWindowSystemPluginWrapper::self().createWindowInfoAsync(window, properties, properties2, [futureInterface](KWindowInfoPrivate *p) mutable {
+        futureInterface.reportResult(KWindowInfo(p));
+        futureInterface.reportFinished();
+    });
+    return futureInterface.future();
+}
+
+KWindowInfo::KWindowInfo(KWindowInfoPrivate *info)
+    : d(info)
+{
+}
+
 KWindowInfo::KWindowInfo(const KWindowInfo &other)
     : d(other.d)
 {
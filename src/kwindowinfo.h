@@ -13,6 +13,7 @@
 #define KWINDOWINFO_H
 
 #include <QExplicitlySharedDataPointer>
+#include <QFuture>
 #include <QStringList>
 #include <QWidgetList> //For WId
 #include <kwindowsystem_export.h>
@@ -75,6 +76,32 @@ public:
      */
     KWindowInfo(WId window, NET::Properties properties, NET::Properties2 properties2 = NET::Properties2());
     ~KWindowInfo();
+    /**
+     * Reads the info about the given window without blocking the calling thread.
+     *
+     * The requests are sent to the windowing system right away and the function returns
+     * immediately. It can be called from any thread, outside of the main thread the
+     * requests are sent once the main thread processes its events. The returned future
+     * gets finished in the main thread once the information is available, its result is
+     * the KWindowInfo as if it had been created with the same arguments. Use a
+     * QFutureWatcher to get notified:
+     *
+     * @code
+     * auto watcher = new QFutureWatcher<KWindowInfo>(this);
+     * connect(watcher, &QFutureWatcher<KWindowInfo>::finished, this, [watcher] {
+     *     const KWindowInfo info = watcher->result();
+     *     qDebug() << info.name();
+     *     watcher->deleteLater();
+     * });
+     * watcher->setFuture(KWindowInfo::fetchAsync(window, NET::WMName));
+     * @endcode
+     *
+     * @param window The platform specific window identifier
+     * @param properties Bitmask of NET::Property
+     * @param properties2 Bitmask of NET::Property2
+     * @since 5.96
+     */
+    static QFuture<KWindowInfo> fetchAsync(WId window, NET::Properties properties, NET::Properties2 properties2 = NET::Properties2());
     /**
      * Returns false if this window info is not valid.
      *
@@ -652,6 +679,9 @@ public:
     KWindowInfo &operator=(const KWindowInfo &);
 
 private:
+    friend class KWindowSystem;
+    explicit KWindowInfo(KWindowInfoPrivate *info);
+
     QExplicitlySharedDataPointer<KWindowInfoPrivate> d;
 };
 
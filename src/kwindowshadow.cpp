@@ -72,13 +72,6 @@ KWindowShadowTile::Ptr KWindowShadow::leftTile() const
 
 void KWindowShadow::setLeftTile(KWindowShadowTile::Ptr tile)
 {
-    if (d->isCreated) {
-        qCWarning(LOG_KWINDOWSYSTEM,
-                  "Cannot attach a left tile to a shadow that already has "
-                  "native platform resources allocated. To do so, destroy() the shadow and then "
-                  "setLeftTile() and create()");
-        return;
-    }
     d->leftTile = tile;
 }
 
@@ -89,13 +82,6 @@ KWindowShadowTile::Ptr KWindowShadow::topLeftTile() const
 
 void KWindowShadow::setTopLeftTile(KWindowShadowTile::Ptr tile)
 {
-    if (d->isCreated) {
-        qCWarning(LOG_KWINDOWSYSTEM,
-                  "Cannot attach a top-left tile to a shadow that already has "
-                  "native platform resources allocated. To do so, destroy() the shadow and then "
-                  "setTopLeftTile() and create()");
-        return;
-    }
     d->topLeftTile = tile;
 }
 
@@ -106,13 +92,6 @@ KWindowShadowTile::Ptr KWindowShadow::topTile() const
 
 void KWindowShadow::setTopTile(KWindowShadowTile::Ptr tile)
 {
-    if (d->isCreated) {
-        qCWarning(LOG_KWINDOWSYSTEM,
-                  "Cannot attach a top tile to a shadow that already has "
-                  "native platform resources allocated. To do so, destroy() the shadow and then "
-                  "setTopTile() and create()");
-        return;
-    }
     d->topTile = tile;
 }
 
@@ -123,13 +102,6 @@ KWindowShadowTile::Ptr KWindowShadow::topRightTile() const
 
 void KWindowShadow::setTopRightTile(KWindowShadowTile::Ptr tile)
 {
-    if (d->isCreated) {
-        qCWarning(LOG_KWINDOWSYSTEM,
-                  "Cannot attach a top-right tile to a shadow that already "
-                  "has native platform resources allocated. To do so, destroy() the shadow and "
-                  "then setTopRightTile() and create()");
-        return;
-    }
     d->topRightTile = tile;
 }
 
@@ -140,13 +112,6 @@ KWindowShadowTile::Ptr KWindowShadow::rightTile() const
 
 void KWindowShadow::setRightTile(KWindowShadowTile::Ptr tile)
 {
-    if (d->isCreated) {
-        qCWarning(LOG_KWINDOWSYSTEM,
-                  "Cannot attach a right tile to a shadow that already has "
-                  "native platform resources allocated. To do so, destroy() the shadow and then "
-                  "setRightTile() and create()");
-        return;
-    }
     d->rightTile = tile;
 }
 
@@ -157,13 +122,6 @@ KWindowShadowTile::Ptr KWindowShadow::bottomRightTile() const
 
 void KWindowShadow::setBottomRightTile(KWindowShadowTile::Ptr tile)
 {
-    if (d->isCreated) {
-        qCWarning(LOG_KWINDOWSYSTEM,
-                  "Cannot attach a bottom-right tile to a shadow that already "
-                  "has native platform resources allocated. To do so, destroy() the shadow and "
-                  "then setBottomRightTile() and create()");
-        return;
-    }
     d->bottomRightTile = tile;
 }
 
@@ -174,13 +132,6 @@ KWindowShadowTile::Ptr KWindowShadow::bottomTile() const
 
 void KWindowShadow::setBottomTile(KWindowShadowTile::Ptr tile)
 {
-    if (d->isCreated) {
-        qCWarning(LOG_KWINDOWSYSTEM,
-                  "Cannot attach a bottom tile to a shadow that already has "
-                  "native platform resources allocated. To do so, destroy() the shadow and then "
-                  "setBottomTile() and create()");
-        return;
-    }
     d->bottomTile = tile;
 }
 
@@ -191,13 +142,6 @@ KWindowShadowTile::Ptr KWindowShadow::bottomLeftTile() const
 
 void KWindowShadow::setBottomLeftTile(KWindowShadowTile::Ptr tile)
 {
-    if (d->isCreated) {
-        qCWarning(LOG_KWINDOWSYSTEM,
-                  "Cannot attach a bottom-left tile to a shadow that already "
-                  "has native platform resources allocated. To do so, destroy() the shadow and "
-                  "then setBottomLeftTile() and create()");
-        return;
-    }
     d->bottomLeftTile = tile;
 }
 
@@ -208,13 +152,6 @@ QMargins KWindowShadow::padding() const
 
 void KWindowShadow::setPadding(const QMargins &padding)
 {
-    if (d->isCreated) {
-        qCWarning(LOG_KWINDOWSYSTEM,
-                  "Cannot set the padding on a shadow that already has "
-                  "native platform resources allocated. To do so, destroy() the shadow and "
-                  "then setPadding() and create()");
-        return;
-    }
     d->padding = padding;
 }
 
@@ -258,6 +195,21 @@ bool KWindowShadow::create()
     return d->isCreated;
 }
 
+bool KWindowShadow::update()
+{
+    if (!d->isCreated) {
+        return create();
+    }
+    if (!d->prepareTiles()) {
+        return false;
+    }
+    if (auto dv2 = dynamic_cast<KWindowShadowPrivateV2 *>(d.data())) {
+        return dv2->update();
+    }
+    destroy();
+    return create();
+}
+
 void KWindowShadow::destroy()
 {
     if (!d->isCreated) {
@@ -289,6 +241,14 @@ void KWindowShadowPrivate::destroy()
 {
 }
 
+KWindowShadowPrivateV2::KWindowShadowPrivateV2()
+{
+}
+
+KWindowShadowPrivateV2::~KWindowShadowPrivateV2()
+{
+}
+
 bool KWindowShadowPrivate::prepareTiles()
 {
     const std::array<KWindowShadowTile *, 8> tiles{
@@ -72,9 +72,10 @@ private:
  * along the shadow tiles. The padding values indicate how much the KWindowShadow sticks outside the
  * decorated window.
  *
- * Once the KWindowShadow is created, you're not allowed to attach or detach any shadow tiles, change
- * padding(), or change window(). In order to do so, you have to destroy() the shadow first, update
- * relevant properties, and create() the shadow again.
+ * Once the KWindowShadow is created, you're not allowed to change window(). In order to do so, you
+ * have to destroy() the shadow first, update relevant properties, and create() the shadow again.
+ * Shadow tiles and padding() can be changed on a created shadow, the changes take effect with the
+ * next update(). Until then the shadow keeps using the replaced tiles.
  */
 class KWINDOWSYSTEM_EXPORT KWindowShadow : public QObject
 {
@@ -203,14 +204,26 @@ public:
     /**
      * Allocates the platform resources associated with the KWindowShadow.
      *
-     * Once the native platform resources have been allocated, you're not allowed to attach or
-     * detach shadow tiles, change the padding or the target window. If you want to do so, you
-     * must destroy() the shadow, change relevant attributes and call create() again.
+     * Once the native platform resources have been allocated, you're not allowed to change the
+     * target window. If you want to do so, you must destroy() the shadow, change relevant attributes
+     * and call create() again. Changed tiles and padding are applied with update().
      *
      * Returns @c true if the creation succeeded, otherwise returns @c false.
      */
     bool create();
 
+    /**
+     * Applies the tiles and the padding changed since the shadow was created or last updated.
+     *
+     * Unlike destroying and creating the shadow again, this keeps the platform resources of the
+     * unchanged tiles and does nothing if nothing changed. If the shadow is not created yet, this
+     * is the same as create().
+     *
+     * Returns @c true if the update succeeded, otherwise returns @c false.
+     * @since 5.96
+     */
+    bool update();
+
     /**
      * Releases the platform resources associated with the KWindowShadow.
      *
@@ -59,4 +59,22 @@ public:
     bool isCreated = false;
 };
 
+/**
+ * Shadows which can apply changed tiles and padding without being destroyed first.
+ * Independent of KWindowShadowPrivate, so existing plugins keep working.
+ * @since 5.96
+ */
+class KWINDOWSYSTEM_EXPORT KWindowShadowPrivateV2 : public KWindowShadowPrivate
+{
+public:
+    /**
+     * Applies the current tiles and padding to the created shadow, the tiles are created already.
+     */
+    virtual bool update() = 0;
+
+protected:
+    KWindowShadowPrivateV2();
+    ~KWindowShadowPrivateV2() override;
+};
+
 #endif // KWINDOWSHADOW_P_H
@@ -5,6 +5,7 @@
 */
 #include "kwindowsystem.h"
 #include "kstartupinfo.h"
+#include "kwindowchangequeue_p.h"
 #include "kwindowsystem_dummy_p.h"
 #include "kwindowsystemplugininterface_p.h"
 #include "pluginwrapper_p.h"
@@ -15,6 +16,7 @@
 #include <QMetaMethod>
 #include <QPixmap>
 #include <QPluginLoader>
+#include <QScreen>
 #include <QTimer>
 #if KWINDOWSYSTEM_BUILD_DEPRECATED_SINCE(5, 62)
 #include <QWidget>
@@ -377,6 +379,15 @@ void KWindowSystem::connectNotify(const QMetaMethod &signal)
     QObject::connectNotify(signal);
 }
 
+void KWindowSystem::disconnectNotify(const QMetaMethod &signal)
+{
+    Q_D(KWindowSystem);
+    if (auto dv3 = dynamic_cast<KWindowSystemPrivateV3 *>(d)) {
+        dv3->disconnectNotify(signal, isSignalConnected(signal));
+    }
+    QObject::disconnectNotify(signal);
+}
+
 QList<WId> KWindowSystem::windows()
 {
     Q_D(KWindowSystem);
@@ -390,8 +401,39 @@ KWindowInfo KWindowSystem::windowInfo(WId win, NET::Properties properties, NET::
 }
 #endif
 
+QList<KWindowInfo> KWindowSystem::windowInfos(const QList<WId> &windows, NET::Properties properties, NET::Properties2 properties2)
+{
+    const QList<KWindowInfoPrivate *> privates = KWindowSystemPluginWrapper::self().createWindowInfos(windows, properties, properties2);
+    QList<KWindowInfo> infos;
+    infos.reserve(privates.count());
+    for (KWindowInfoPrivate *p : privates) {
+        infos << KWindowInfo(p);
+    }
+    return infos;
+}
+
+void KWindowSystem::setWindowInfoCacheEnabled(bool enabled)
+{
+    Q_D(KWindowSystem);
+    if (auto dv3 = dynamic_cast<KWindowSystemPrivateV3 *>(d)) {
+        dv3->setWindowInfoCacheEnabled(enabled);
+    }
+}
+
+void KWindowSystem::setWindowChangesCoalesced(bool coalesced)
+{
+    Q_D(KWindowSystem);
+    if (auto dv3 = dynamic_cast<KWindowSystemPrivateV3 *>(d)) {
+        dv3->setWindowChangesCoalesced(coalesced);
+    }
+}
+
 bool KWindowSystem::hasWId(WId w)
 {
+    Q_D(KWindowSystem);
+    if (auto dv3 = dynamic_cast<KWindowSystemPrivateV3 *>(d)) {
+        return dv3->hasWId(w);
+    }
     return windows().contains(w);
 }
 
@@ -401,6 +443,56 @@ QList<WId> KWindowSystem::stackingOrder()
     return d->stackingOrder();
 }
 
+quint64 KWindowSystem::stackingOrderGeneration()
+{
+    Q_D(KWindowSystem);
+    if (auto dv3 = dynamic_cast<KWindowSystemPrivateV3 *>(d)) {
+        return dv3->stackingOrderGeneration();
+    }
+    return 0;
+}
+
+KWindowChanges KWindowSystem::changesSince(quint64 generation)
+{
+    Q_D(KWindowSystem);
+    if (auto dv3 = dynamic_cast<KWindowSystemPrivateV3 *>(d)) {
+        return dv3->changesSince(generation);
+    }
+    KWindowChanges changes;
+    changes.resyncNeeded = true;
+    return changes;
+}
+
+void KWindowSystem::addChangeQueue(KWindowChangeQueue *queue)
+{
+    Q_D(KWindowSystem);
+    if (auto dv3 = dynamic_cast<KWindowSystemPrivateV3 *>(d)) {
+        dv3->addChangeQueue(queue->d.data());
+        queue->d->setAdded(true);
+    }
+}
+
+void KWindowSystem::removeChangeQueue(KWindowChangeQueue *queue)
+{
+    if (!queue->d->isAdded() || g_kwmInstanceContainer.isDestroyed()) {
+        return;
+    }
+    Q_D(KWindowSystem);
+    if (auto dv3 = dynamic_cast<KWindowSystemPrivateV3 *>(d)) {
+        dv3->removeChangeQueue(queue->d.data());
+    }
+    queue->d->setAdded(false);
+}
+
+KWindowSystemSnapshot KWindowSystem::snapshot()
+{
+    Q_D(KWindowSystem);
+    if (auto dv3 = dynamic_cast<KWindowSystemPrivateV3 *>(d)) {
+        return KWindowSystemSnapshot(dv3->snapshot());
+    }
+    return KWindowSystemSnapshot();
+}
+
 int KWindowSystem::currentDesktop()
 {
     Q_D(KWindowSystem);
@@ -623,6 +715,21 @@ QRect KWindowSystem::workArea(const QList<WId> &exclude, int desktop)
     return d->workArea(exclude, desktop) / qApp->devicePixelRatio();
 }
 
+QRect KWindowSystem::screenWorkArea(QScreen *screen, int desktop)
+{
+    Q_D(KWindowSystem);
+    if (!screen) {
+        screen = QGuiApplication::primaryScreen();
+        if (!screen) {
+            return QRect();
+        }
+    }
+    if (auto dv3 = dynamic_cast<KWindowSystemPrivateV3 *>(d)) {
+        return dv3->screenWorkArea(screen, desktop) / qApp->devicePixelRatio();
+    }
+    return workArea(desktop).intersected(screen->geometry());
+}
+
 QString KWindowSystem::desktopName(int desktop)
 {
     Q_D(KWindowSystem);
@@ -14,12 +14,16 @@
 
 #include <QObject>
 #include <QWidgetList> //For WId
+#include <kwindowchangequeue.h>
+#include <kwindowchanges.h>
 #include <kwindowinfo.h>
 #include <kwindowsystem_export.h>
+#include <kwindowsystemsnapshot.h>
 #include <netwm_def.h>
 
 class KWindowSystemPrivate;
 class NETWinInfo;
+class QScreen;
 
 /**
  *
@@ -95,14 +99,137 @@ public:
     static KWindowInfo windowInfo(WId win, NET::Properties properties, NET::Properties2 properties2 = NET::Properties2());
 #endif
 
+    /**
+     * Returns information about all @p windows, in the same order.
+     *
+     * This is equivalent to creating a KWindowInfo for each of the windows, but the
+     * requests for all windows are sent to the windowing system before waiting for
+     * any reply. On X11 this costs about one roundtrip for the whole list instead of
+     * several roundtrips per window, so prefer it when inspecting many windows, e.g.
+     * @code
+     * const QList<KWindowInfo> infos = KWindowSystem::windowInfos(KWindowSystem::windows(), NET::WMName | NET::WMDesktop);
+     * @endcode
+     *
+     * @param windows the ids of the windows
+     * @param properties all properties that should be retrieved, see KWindowInfo
+     * @param properties2 additional properties, see KWindowInfo
+     * @since 5.96
+     */
+    static QList<KWindowInfo> windowInfos(const QList<WId> &windows, NET::Properties properties, NET::Properties2 properties2 = NET::Properties2());
+
+    /**
+     * Enables or disables the window info cache.
+     *
+     * When enabled, KWindowSystem keeps a local copy of the commonly used properties
+     * of all managed windows (names, state, desktop, window type, geometry, window class,
+     * pid and struts) and keeps it up to date from the change notifications of the
+     * windowing system. A KWindowInfo asking only for those properties is then created
+     * from the cache, only the properties which changed since the window was looked up
+     * the last time are fetched from the windowing system.
+     *
+     * The changes are noted when the change notifications are processed by the event loop,
+     * so the cache is meant for applications which react on windowChanged() and look up many
+     * windows, like panels and pagers. The cache is only used for KWindowInfo instances
+     * created in the main thread. Disabled by default.
+     *
+     * Currently only supported on X11.
+     * @since 5.96
+     */
+    static void setWindowInfoCacheEnabled(bool enabled);
+
+    /**
+     * Enables or disables coalescing of the window change notifications.
+     *
+     * When enabled, windowChanged() is emitted at most once per window for all
+     * the change notifications of the windowing system processed together, with
+     * all the properties changed by them. An application changing e.g. the title,
+     * the state and the user time of its window then causes a single emission
+     * instead of one per property. The emission happens once the event loop is
+     * done with those notifications, so it may come after other signals about
+     * the window. strutChanged() is emitted along with it.
+     *
+     * This affects all receivers in the application. Disabled by default.
+     *
+     * Currently only supported on X11.
+     * @since 5.96
+     */
+    static void setWindowChangesCoalesced(bool coalesced);
+
     /**
      * Returns the list of all toplevel windows currently managed by the
      * window manager in the current stacking order (from lower to
      * higher). May be useful for pagers.
+     *
+     * The list is implicitly shared, copying it or asking for it again while
+     * the stacking order didn't change is cheap.
      * @return the list of all toplevel windows in stacking order
+     * @see stackingOrderGeneration()
      */
     static QList<WId> stackingOrder();
 
+    /**
+     * Returns a number which is increased whenever the stacking order changes.
+     *
+     * Comparing it to the number of an earlier stackingOrder() call tells whether
+     * the order changed since then, without comparing the lists.
+     *
+     * Currently only supported on X11, always 0 otherwise.
+     * @since 5.96
+     */
+    static quint64 stackingOrderGeneration();
+
+    /**
+     * Returns the current state of the window management as an immutable snapshot,
+     * to be read from any thread.
+     *
+     * The main thread publishes a new snapshot once it processed the change
+     * notifications of the windowing system. Getting it only locks to copy a pointer
+     * and doesn't wait for the main thread, except for the first call, which starts
+     * tracking the windows like the other functions of KWindowSystem do.
+     *
+     * Currently only supported on X11, the snapshot is invalid otherwise.
+     * @since 5.96
+     */
+    static KWindowSystemSnapshot snapshot();
+
+    /**
+     * Returns the changes of the windows after the change with the given @p generation.
+     *
+     * This allows following the windows without connecting to the signals, e.g. from
+     * other threads or from code which isn't a QObject. Start with generation 0 and pass
+     * the KWindowChanges::generation of each result to the next call. The changes are
+     * compacted to one entry per window.
+     *
+     * Only a limited number of changes is kept. If changes after @p generation were
+     * dropped, KWindowChanges::resyncNeeded is set and the state has to be read again.
+     * The first call starts tracking the changes, so it always asks for a resync
+     * unless something else already started it.
+     *
+     * Can be called from any thread. Currently only supported on X11, always asking
+     * for a resync otherwise.
+     * @since 5.96
+     */
+    static KWindowChanges changesSince(quint64 generation);
+
+    /**
+     * Starts putting the changes of the windows into @p queue, to be taken
+     * by another thread. See KWindowChangeQueue.
+     *
+     * Can be called from any thread. Currently only supported on X11, the queue
+     * stays empty otherwise.
+     * @since 5.96
+     */
+    static void addChangeQueue(KWindowChangeQueue *queue);
+
+    /**
+     * Stops putting changes into @p queue. Once this returns, the main thread
+     * doesn't access the queue anymore and it can be deleted.
+     *
+     * Can be called from any thread.
+     * @since 5.96
+     */
+    static void removeChangeQueue(KWindowChangeQueue *queue);
+
     /**
      * Returns the currently active window, or 0 if no window is active.
      * @return the window id of the active window, or 0 if no window is
@@ -490,6 +617,22 @@ public:
      **/
     static QRect workArea(const QList<WId> &excludes, int desktop = -1);
 
+    /**
+     * Returns the workarea of the output @p screen for the specified desktop,
+     * or the current desktop if no desktop has been specified.
+     *
+     * Unlike workArea(), this honors where along the screen edges the struts of
+     * panels and docks are, so a panel only reduces the work area of the output
+     * it is on.
+     *
+     * @param screen the output, the primary screen if null
+     * @param desktop the number of the desktop to check, -1 for the
+     *        current desktop
+     * @return the size and position of the work area on @p screen
+     * @since 5.96
+     **/
+    static QRect screenWorkArea(QScreen *screen, int desktop = -1);
+
     /**
      * Returns the name of the specified desktop.
      * @param desktop the number of the desktop
@@ -786,6 +929,24 @@ Q_SIGNALS:
      */
     void stackingOrderChanged();
 
+    /**
+     * Emitted along with stackingOrderChanged() when the stacking order actually
+     * changed, with the difference to the previous order. Allows updating a model
+     * sorted by the stacking order without sorting it again.
+     *
+     * A window raised or lowered is reported as moved, while the relative order
+     * of the other windows stays the same. All windows are in the order of the
+     * new stacking order, the removed ones in the order of the previous one.
+     *
+     * Currently only supported on X11.
+     *
+     * @param inserted the windows which were not in the previous order
+     * @param removed the windows which are not in the new order anymore
+     * @param moved the windows whose position changed relative to the others
+     * @since 5.96
+     */
+    void stackingOrderDelta(const QList<WId> &inserted, const QList<WId> &removed, const QList<WId> &moved);
+
     /**
      * The window changed.
      *
@@ -871,6 +1032,7 @@ Q_SIGNALS:
 
 protected:
     void connectNotify(const QMetaMethod &signal) override;
+    void disconnectNotify(const QMetaMethod &signal) override;
 
 private:
     friend class KWindowSystemStaticContainer;
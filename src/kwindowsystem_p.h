@@ -6,12 +6,17 @@
 #ifndef KWINDOWSYSTEM_P_H
 #define KWINDOWSYSTEM_P_H
 
+#include "kwindowchanges.h"
 #include "netwm_def.h"
+#include <QExplicitlySharedDataPointer>
 #include <QStringList>
 #include <QWidgetList> //For WId
 #include <kwindowsystem_export.h>
 
+class KWindowChangeQueuePrivate;
+class KWindowSystemSnapshotPrivate;
 class NETWinInfo;
+class QScreen;
 
 class KWINDOWSYSTEM_EXPORT KWindowSystemPrivate : public NET
 {
@@ -87,4 +92,28 @@ public:
     virtual quint32 lastInputSerial(QWindow *window) = 0;
 };
 
+/**
+ * Optional interface for the window tracking features of platforms which
+ * mirror the window state locally. Independent of KWindowSystemPrivateV2,
+ * which is about activation tokens.
+ */
+class KWINDOWSYSTEM_EXPORT KWindowSystemPrivateV3 : public KWindowSystemPrivate
+{
+public:
+    virtual void setWindowInfoCacheEnabled(bool enabled) = 0;
+    virtual void setWindowChangesCoalesced(bool coalesced) = 0;
+    virtual bool hasWId(WId window) = 0;
+    virtual QRect screenWorkArea(QScreen *screen, int desktop) = 0;
+    virtual quint64 stackingOrderGeneration() = 0;
+    // thread-safe, returns the last published snapshot
+    virtual QExplicitlySharedDataPointer<const KWindowSystemSnapshotPrivate> snapshot() = 0;
+    // thread-safe
+    virtual KWindowChanges changesSince(quint64 generation) = 0;
+    // thread-safe, the queue isn't accessed anymore once removed
+    virtual void addChangeQueue(KWindowChangeQueuePrivate *queue) = 0;
+    virtual void removeChangeQueue(KWindowChangeQueuePrivate *queue) = 0;
+    // @p connected tells whether the signal still has receivers
+    virtual void disconnectNotify(const QMetaMethod &signal, bool connected) = 0;
+};
+
 #endif
@@ -42,3 +42,10 @@ KWindowShadowTilePrivate *KWindowSystemPluginInterface::createWindowShadowTile()
 {
     return nullptr;
 }
+
+KWindowSystemPluginInterfaceV2::KWindowSystemPluginInterfaceV2(QObject *parent)
+    : KWindowSystemPluginInterface(parent)
+{
+}
+
+KWindowSystemPluginInterfaceV2::~KWindowSystemPluginInterfaceV2() = default;
@@ -11,6 +11,8 @@
 #include <QObject>
 #include <QWidgetList> //For WId
 
+#include <functional>
+
 class KWindowEffectsPrivate;
 class KWindowInfoPrivate;
 class KWindowShadowPrivate;
@@ -33,6 +35,32 @@ public:
     virtual KWindowShadowTilePrivate *createWindowShadowTile();
 };
 
+/**
+ * Optional extension of KWindowSystemPluginInterface, looked up with dynamic_cast so
+ * that the vtable and the IID of the base interface stay unchanged for existing plugins.
+ */
+class KWINDOWSYSTEM_EXPORT KWindowSystemPluginInterfaceV2 : public KWindowSystemPluginInterface
+{
+public:
+    explicit KWindowSystemPluginInterfaceV2(QObject *parent = nullptr);
+    ~KWindowSystemPluginInterfaceV2() override;
+
+    /**
+     * Creates the KWindowInfoPrivate for all @p windows at once. An empty list means
+     * that createWindowInfo is used instead.
+     */
+    virtual QList<KWindowInfoPrivate *> createWindowInfos(const QList<WId> &windows, NET::Properties properties, NET::Properties2 properties2) = 0;
+    /**
+     * Starts creating the KWindowInfoPrivate for @p window without blocking. The @p callback
+     * has to be invoked from the main thread once the information is available.
+     * Returns @c false if createWindowInfo is to be used instead.
+     */
+    virtual bool createWindowInfoAsync(WId window,
+                                       NET::Properties properties,
+                                       NET::Properties2 properties2,
+                                       const std::function<void(KWindowInfoPrivate *)> &callback) = 0;
+};
+
 Q_DECLARE_INTERFACE(KWindowSystemPluginInterface, KWindowSystemPluginInterface_iid)
 
 #endif
@@ -0,0 +1,70 @@
+/*
+    SPDX-FileCopyrightText: 2022 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-or-later
+*/
+
+#include "kwindowsystemsnapshot.h"
+#include "kwindowsystemsnapshot_p.h"
+
+KWindowSystemSnapshot::KWindowSystemSnapshot() = default;
+
+KWindowSystemSnapshot::KWindowSystemSnapshot(const QExplicitlySharedDataPointer<const KWindowSystemSnapshotPrivate> &d)
+    : d(d)
+{
+}
+
+KWindowSystemSnapshot::KWindowSystemSnapshot(const KWindowSystemSnapshot &other) = default;
+
+KWindowSystemSnapshot::~KWindowSystemSnapshot() = default;
+
+KWindowSystemSnapshot &KWindowSystemSnapshot::operator=(const KWindowSystemSnapshot &other) = default;
+
+bool KWindowSystemSnapshot::isValid() const
+{
+    return bool(d);
+}
+
+quint64 KWindowSystemSnapshot::serial() const
+{
+    return d ? d->serial : 0;
+}
+
+QList<WId> KWindowSystemSnapshot::windows() const
+{
+    return d ? d->windows : QList<WId>();
+}
+
+QList<WId> KWindowSystemSnapshot::stackingOrder() const
+{
+    return d ? d->stackingOrder : QList<WId>();
+}
+
+WId KWindowSystemSnapshot::activeWindow() const
+{
+    return d ? d->activeWindow : 0;
+}
+
+int KWindowSystemSnapshot::currentDesktop() const
+{
+    return d ? d->currentDesktop : 0;
+}
+
+int KWindowSystemSnapshot::numberOfDesktops() const
+{
+    return d ? d->numberOfDesktops : 0;
+}
+
+QRect KWindowSystemSnapshot::workArea(int desktop) const
+{
+    if (!d) {
+        return QRect();
+    }
+    if (desktop == -1) {
+        desktop = d->currentDesktop;
+    }
+    if (desktop < 1 || desktop > d->workAreas.count()) {
+        return QRect();
+    }
+    return d->workAreas.at(desktop - 1);
+}
@@ -0,0 +1,91 @@
+/*
+    SPDX-FileCopyrightText: 2022 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-or-later
+*/
+
+#ifndef KWINDOWSYSTEMSNAPSHOT_H
+#define KWINDOWSYSTEMSNAPSHOT_H
+
+#include <QExplicitlySharedDataPointer>
+#include <QList>
+#include <QRect>
+#include <QWidgetList> //For WId
+#include <kwindowsystem_export.h>
+
+class KWindowSystemSnapshotPrivate;
+
+/**
+ * An immutable copy of the window management state, as returned by
+ * KWindowSystem::snapshot().
+ *
+ * Unlike the functions of KWindowSystem, a snapshot can be obtained and read from
+ * any thread without synchronizing with the main thread. All values of a snapshot
+ * belong together, they were taken at the same time in the main thread, after it
+ * processed the change notifications of the windowing system.
+ *
+ * Copying a snapshot is cheap, the data is shared.
+ *
+ * @since 5.96
+ */
+class KWINDOWSYSTEM_EXPORT KWindowSystemSnapshot
+{
+public:
+    /**
+     * Creates an invalid snapshot.
+     */
+    KWindowSystemSnapshot();
+    KWindowSystemSnapshot(const KWindowSystemSnapshot &other);
+    ~KWindowSystemSnapshot();
+    KWindowSystemSnapshot &operator=(const KWindowSystemSnapshot &other);
+
+    /**
+     * Returns false for a default constructed snapshot, or when the platform
+     * doesn't provide snapshots. Currently they are only provided on X11.
+     */
+    bool isValid() const;
+
+    /**
+     * Returns a number which is increased for each new snapshot. Snapshots with
+     * the same serial have the same content.
+     */
+    quint64 serial() const;
+
+    /**
+     * The windows managed by the window manager, see KWindowSystem::windows().
+     */
+    QList<WId> windows() const;
+
+    /**
+     * The windows in stacking order, see KWindowSystem::stackingOrder().
+     */
+    QList<WId> stackingOrder() const;
+
+    /**
+     * The active window, or 0 if no window is active.
+     */
+    WId activeWindow() const;
+
+    /**
+     * The current desktop, see KWindowSystem::currentDesktop().
+     */
+    int currentDesktop() const;
+
+    /**
+     * The number of desktops, see KWindowSystem::numberOfDesktops().
+     */
+    int numberOfDesktops() const;
+
+    /**
+     * The work area of the desktop @p desktop, or of the current desktop for -1,
+     * see KWindowSystem::workArea(int). An invalid QRect for desktops that don't exist.
+     */
+    QRect workArea(int desktop = -1) const;
+
+private:
+    friend class KWindowSystem;
+    explicit KWindowSystemSnapshot(const QExplicitlySharedDataPointer<const KWindowSystemSnapshotPrivate> &d);
+    QExplicitlySharedDataPointer<const KWindowSystemSnapshotPrivate> d;
+};
+
+#endif
@@ -0,0 +1,33 @@
+/*
+    SPDX-FileCopyrightText: 2022 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-or-later
+*/
+
+#ifndef KWINDOWSYSTEMSNAPSHOT_P_H
+#define KWINDOWSYSTEMSNAPSHOT_P_H
+
+#include <QList>
+#include <QRect>
+#include <QSharedData>
+#include <QVector>
+#include <QWidgetList> //For WId
+
+/**
+ * The data of a KWindowSystemSnapshot. Filled by the platform in the main thread,
+ * never changed once published.
+ */
+class KWindowSystemSnapshotPrivate : public QSharedData
+{
+public:
+    quint64 serial = 0;
+    QList<WId> windows;
+    QList<WId> stackingOrder;
+    WId activeWindow = 0;
+    int currentDesktop = 0;
+    int numberOfDesktops = 0;
+    // of the desktops 1 to numberOfDesktops
+    QVector<QRect> workAreas;
+};
+
+#endif
@@ -9,20 +9,32 @@
 
 #include "kwindowinfo_p_x11.h"
 #include "kwindowsystem.h"
+#include "kwindowsystem_p_x11.h"
 
+#include <QAbstractEventDispatcher>
+#include <QCoreApplication>
 #include <QDebug>
+#include <QPointer>
+#include <QThread>
+#include <QTimer>
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
 #include <private/qtx11extras_p.h>
 #else
 #include <QX11Info>
 #endif
 
-#include <X11/Xatom.h>
-#include <kxerrorhandler_p.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
 #include <netwm.h>
 
+#include "netwm_p.h"
+
+#include "kxcberrorscope_p.h"
+
 #include <xcb/res.h>
 
+#include <deque>
+
 static bool haveXRes()
 {
     static bool s_checked = false;
@@ -36,19 +48,62 @@ static bool haveXRes()
     return s_haveXRes;
 }
 
-// KWindowSystem::info() should be updated too if something has to be changed here
-KWindowInfoPrivateX11::KWindowInfoPrivateX11(WId _win, NET::Properties properties, NET::Properties2 properties2)
-    : KWindowInfoPrivate(_win, properties, properties2)
-    , KWindowInfoPrivateDesktopFileNameExtension()
-    , KWindowInfoPrivatePidExtension()
-    , KWindowInfoPrivateAppMenuExtension()
+// returns the cookie and clears it, so that its reply is discarded only once
+template<typename Cookie>
+static Cookie takeCookie(Cookie &cookie)
 {
-    installDesktopFileNameExtension(this);
-    installPidExtension(this);
-    installAppMenuExtension(this);
-    installGtkApplicationIdExtension(this);
+    const Cookie taken = cookie;
+    cookie.sequence = 0;
+    return taken;
+}
+
+// WM_NAME and WM_ICON_NAME are fetched along with the _NET_WM_ variants even when those
+// are set, so only their first KiB, in 32 bit units. The rest is fetched if it is used.
+static const uint32_t maxLegacyNameLength = 1024 / sizeof(uint32_t);
 
-    KXErrorHandler handler;
+// fetches all of a WM_NAME or WM_ICON_NAME property, of which @p reply has the first KiB only
+static xcb_get_property_reply_t *fetchLegacyName(xcb_window_t window, xcb_atom_t property, const xcb_get_property_reply_t *reply)
+{
+    xcb_connection_t *c = QX11Info::connection();
+    const uint32_t length = (xcb_get_property_value_length(reply) + reply->bytes_after + 3) / sizeof(uint32_t);
+    return xcb_get_property_reply(c, xcb_get_property(c, false, window, property, XCB_GET_PROPERTY_TYPE_ANY, 0, length), nullptr);
+}
+
+// the value of a WM_NAME or WM_ICON_NAME property
+static QString nameFromReply(xcb_get_property_reply_t *reply, xcb_atom_t utf8String)
+{
+    if (!reply || reply->format != 8 || reply->value_len == 0) {
+        return QString();
+    }
+    const char *data = static_cast<const char *>(xcb_get_property_value(reply));
+    const int length = qstrnlen(data, xcb_get_property_value_length(reply));
+    if (reply->type == utf8String) {
+        return QString::fromUtf8(data, length);
+    }
+    if (reply->type == XCB_ATOM_STRING) {
+        return QString::fromLatin1(data, length);
+    }
+    // COMPOUND_TEXT, Xlib converts it locally
+    QByteArray value(data, length);
+    XTextProperty tp;
+    tp.value = reinterpret_cast<unsigned char *>(value.data());
+    tp.encoding = reply->type;
+    tp.format = 8;
+    tp.nitems = length;
+    char **text = nullptr;
+    int count = 0;
+    QString result;
+    if (XmbTextPropertyToTextList(QX11Info::display(), &tp, &text, &count) == Success && text != nullptr && count > 0) {
+        result = QString::fromLocal8Bit(text[0]);
+    }
+    if (text != nullptr) {
+        XFreeStringList(text);
+    }
+    return result;
+}
+
+void KWindowInfoPrivateX11::addFallbackProperties(NET::Properties &properties, NET::Properties2 &properties2)
+{
     if (properties & NET::WMVisibleIconName) {
         properties |= NET::WMIconName | NET::WMVisibleName; // force, in case it will be used as a fallback
     }
@@ -64,39 +119,190 @@ KWindowInfoPrivateX11::KWindowInfoPrivateX11(WId _win, NET::Properties propertie
     if ((properties & NET::WMDesktop) && KWindowSystem::mapViewport()) {
         properties |= NET::WMGeometry; // for viewports, the desktop (workspace) is determined from the geometry
     }
-    properties |= NET::XAWMState; // force to get error detection for valid()
-    m_info.reset(new NETWinInfo(QX11Info::connection(), _win, QX11Info::appRootWindow(), properties, properties2));
+    properties |= NET::XAWMState; // force, for valid() of withdrawn windows
+}
+
+// KWindowSystem::info() should be updated too if something has to be changed here
+KWindowInfoPrivateX11::KWindowInfoPrivateX11(WId _win, NET::Properties properties, NET::Properties2 properties2, Fetch fetch)
+    : KWindowInfoPrivate(_win, properties, properties2)
+    , KWindowInfoPrivateDesktopFileNameExtension()
+    , KWindowInfoPrivatePidExtension()
+    , KWindowInfoPrivateAppMenuExtension()
+    , m_valid(true)
+{
+    installDesktopFileNameExtension(this);
+    installPidExtension(this);
+    installAppMenuExtension(this);
+    installGtkApplicationIdExtension(this);
+
+    addFallbackProperties(properties, properties2);
+    m_fetchProperties = properties;
+
+    xcb_connection_t *c = QX11Info::connection();
+    // only send the requests here, so that several instances can share the roundtrip
+    m_info.reset(new NETWinInfo(c, _win, QX11Info::appRootWindow(), NET::Properties(), NET::Properties2()));
+    NETWinInfoPrivateAccess::requestProperties(m_info.data(), properties, properties2);
+    // checked, a BadWindow error is kept with the cookie, see readReplies()
+    m_attributesCookie = xcb_get_window_attributes(c, _win);
+    requestNames();
+    if (properties & (NET::WMGeometry | NET::WMFrameExtents)) {
+        requestGeometry();
+    }
+    if (haveXRes()) {
+        xcb_res_client_id_spec_t specs;
+        specs.client = win();
+        specs.mask = XCB_RES_CLIENT_ID_MASK_LOCAL_CLIENT_PID;
+        m_pidCookie = xcb_res_query_client_ids(c, 1, &specs);
+    }
+    m_pendingReplies = true;
+
+    if (fetch == Fetch::Blocking) {
+        readReplies();
+    }
+}
+
+KWindowInfoPrivateX11::KWindowInfoPrivateX11(const KWindowInfoPrivateX11 &previous, NET::Properties dirtyProperties, NET::Properties2 dirtyProperties2)
+    : KWindowInfoPrivate(previous.win(), previous.m_info->passedProperties(), previous.m_info->passedProperties2())
+    , KWindowInfoPrivateDesktopFileNameExtension()
+    , KWindowInfoPrivatePidExtension()
+    , KWindowInfoPrivateAppMenuExtension()
+{
+    Q_ASSERT(!previous.m_pendingReplies);
+    installDesktopFileNameExtension(this);
+    installPidExtension(this);
+    installAppMenuExtension(this);
+    installGtkApplicationIdExtension(this);
+
+    m_name = previous.m_name;
+    m_iconic_name = previous.m_iconic_name;
+    m_geometry = previous.m_geometry;
+    m_frame_geometry = previous.m_frame_geometry;
+    m_pid = previous.m_pid;
+    m_valid = previous.m_valid;
+    m_info.reset(new NETWinInfo(*previous.m_info));
+    NETWinInfoPrivateAccess::detach(m_info.data());
+
+    requestUpdate(dirtyProperties, dirtyProperties2);
+}
+
+void KWindowInfoPrivateX11::requestUpdate(NET::Properties dirtyProperties, NET::Properties2 dirtyProperties2)
+{
+    const NET::Properties dirty = dirtyProperties & m_info->passedProperties();
+    // merges with the requests still pending, if any
+    NETWinInfoPrivateAccess::sendUpdateRequests(m_info.data(), dirtyProperties, dirtyProperties2);
+
+    xcb_connection_t *c = QX11Info::connection();
+    if (!m_pendingReplies) {
+        m_fetchProperties = NET::Properties();
+    }
+    if ((dirty & NET::WMName) && m_wmNameCookie.sequence) {
+        xcb_discard_reply(c, takeCookie(m_wmNameCookie).sequence);
+    }
+    if ((dirty & NET::WMIconName) && m_wmIconNameCookie.sequence) {
+        xcb_discard_reply(c, takeCookie(m_wmIconNameCookie).sequence);
+    }
+    if ((dirty & NET::WMGeometry) && m_geometryCookie.sequence) {
+        xcb_discard_reply(c, takeCookie(m_geometryCookie).sequence);
+        xcb_discard_reply(c, takeCookie(m_translateCookie).sequence);
+    }
+    m_fetchProperties |= dirty;
+    requestNames();
+    if ((m_fetchProperties & NET::WMGeometry) && !m_geometryCookie.sequence) {
+        requestGeometry();
+    }
+    m_pendingReplies = true;
+}
+
+void KWindowInfoPrivateX11::requestGeometry()
+{
+    xcb_connection_t *c = QX11Info::connection();
+    m_geometryCookie = xcb_get_geometry(c, win());
+    m_translateCookie = xcb_translate_coordinates(c, win(), QX11Info::appRootWindow(), 0, 0);
+}
+
+void KWindowInfoPrivateX11::requestNames()
+{
+    // requested along with the _NET_WM_ variants, using them costs no roundtrip when those aren't set
+    xcb_connection_t *c = QX11Info::connection();
+    if ((m_fetchProperties & NET::WMName) && !m_wmNameCookie.sequence) {
+        m_wmNameCookie = xcb_get_property(c, false, win(), XCB_ATOM_WM_NAME, XCB_GET_PROPERTY_TYPE_ANY, 0, maxLegacyNameLength);
+    }
+    if ((m_fetchProperties & NET::WMIconName) && !m_wmIconNameCookie.sequence) {
+        m_wmIconNameCookie = xcb_get_property(c, false, win(), XCB_ATOM_WM_ICON_NAME, XCB_GET_PROPERTY_TYPE_ANY, 0, maxLegacyNameLength);
+    }
+}
+
+void KWindowInfoPrivateX11::readReplies()
+{
+    if (!m_pendingReplies) {
+        return;
+    }
+    m_pendingReplies = false;
+
+    xcb_connection_t *c = QX11Info::connection();
+    const NET::Properties properties = m_fetchProperties;
+
+    // only sees the errors of the requests of this instance, even when the replies of
+    // other instances are pending too, as with createMany() and createAsync()
+    KXcbErrorScope errors;
+    NETWinInfoPrivateAccess::readUpdateReplies(m_info.data());
+    if (m_attributesCookie.sequence) {
+        free(errors.reply(c, xcb_get_window_attributes_reply, m_attributesCookie));
+        m_attributesCookie.sequence = 0;
+    }
     if (properties & NET::WMName) {
+        QScopedPointer<xcb_get_property_reply_t, QScopedPointerPodDeleter> wmName(errors.reply(c, xcb_get_property_reply, m_wmNameCookie));
+        m_wmNameCookie.sequence = 0;
         if (m_info->name() && m_info->name()[0] != '\0') {
             m_name = QString::fromUtf8(m_info->name());
         } else {
-            m_name = KWindowSystem::readNameProperty(_win, XA_WM_NAME);
+            if (wmName && wmName->bytes_after > 0) {
+                wmName.reset(fetchLegacyName(win(), XCB_ATOM_WM_NAME, wmName.data()));
+            }
+            m_name = nameFromReply(wmName.data(), NETWinInfoPrivateAccess::d(m_info.data())->atom(UTF8_STRING));
         }
     }
     if (properties & NET::WMIconName) {
+        QScopedPointer<xcb_get_property_reply_t, QScopedPointerPodDeleter> wmIconName(errors.reply(c, xcb_get_property_reply, m_wmIconNameCookie));
+        m_wmIconNameCookie.sequence = 0;
         if (m_info->iconName() && m_info->iconName()[0] != '\0') {
             m_iconic_name = QString::fromUtf8(m_info->iconName());
         } else {
-            m_iconic_name = KWindowSystem::readNameProperty(_win, XA_WM_ICON_NAME);
+            if (wmIconName && wmIconName->bytes_after > 0) {
+                wmIconName.reset(fetchLegacyName(win(), XCB_ATOM_WM_ICON_NAME, wmIconName.data()));
+            }
+            m_iconic_name = nameFromReply(wmIconName.data(), NETWinInfoPrivateAccess::d(m_info.data())->atom(UTF8_STRING));
         }
     }
     if (properties & (NET::WMGeometry | NET::WMFrameExtents)) {
-        NETRect frame;
-        NETRect geom;
-        m_info->kdeGeometry(frame, geom);
-        m_geometry.setRect(geom.pos.x, geom.pos.y, geom.size.width, geom.size.height);
-        m_frame_geometry.setRect(frame.pos.x, frame.pos.y, frame.size.width, frame.size.height);
+        NETWinInfoPrivate *info = NETWinInfoPrivateAccess::d(m_info.data());
+        if (m_geometryCookie.sequence) {
+            QScopedPointer<xcb_get_geometry_reply_t, QScopedPointerPodDeleter> geometry(errors.reply(c, xcb_get_geometry_reply, m_geometryCookie));
+            QScopedPointer<xcb_translate_coordinates_reply_t, QScopedPointerPodDeleter> translated(
+                errors.reply(c, xcb_translate_coordinates_reply, m_translateCookie));
+            m_geometryCookie.sequence = 0;
+            m_translateCookie.sequence = 0;
+            if (geometry && translated) {
+                info->win_geom.pos.x = translated->dst_x;
+                info->win_geom.pos.y = translated->dst_y;
+                info->win_geom.size.width = geometry->width;
+                info->win_geom.size.height = geometry->height;
+            }
+        }
+        // kdeGeometry() fetches the geometry itself when it is unknown, which failed above already
+        if (info->win_geom.size.width > 0 && info->win_geom.size.height > 0) {
+            NETRect frame;
+            NETRect geom;
+            m_info->kdeGeometry(frame, geom);
+            m_geometry.setRect(geom.pos.x, geom.pos.y, geom.size.width, geom.size.height);
+            m_frame_geometry.setRect(frame.pos.x, frame.pos.y, frame.size.width, frame.size.height);
+        }
     }
-    m_valid = !handler.error(false); // no sync - NETWinInfo did roundtrips
+    m_valid = m_valid && !errors.hasBadWindow();
 
-    if (haveXRes()) {
-        xcb_res_client_id_spec_t specs;
-        specs.client = win();
-        specs.mask = XCB_RES_CLIENT_ID_MASK_LOCAL_CLIENT_PID;
-        auto cookie = xcb_res_query_client_ids(QX11Info::connection(), 1, &specs);
-
-        QScopedPointer<xcb_res_query_client_ids_reply_t, QScopedPointerPodDeleter> reply(
-            xcb_res_query_client_ids_reply(QX11Info::connection(), cookie, nullptr));
+    if (m_pidCookie.sequence) {
+        QScopedPointer<xcb_res_query_client_ids_reply_t, QScopedPointerPodDeleter> reply(xcb_res_query_client_ids_reply(c, m_pidCookie, nullptr));
+        m_pidCookie.sequence = 0;
         if (reply && xcb_res_query_client_ids_ids_length(reply.data()) > 0) {
             uint32_t pid = *xcb_res_client_id_value_value((xcb_res_query_client_ids_ids_iterator(reply.data()).data));
             m_pid = pid;
@@ -104,8 +310,179 @@ KWindowInfoPrivateX11::KWindowInfoPrivateX11(WId _win, NET::Properties propertie
     }
 }
 
+bool KWindowInfoPrivateX11::covers(NET::Properties properties, NET::Properties2 properties2) const
+{
+    addFallbackProperties(properties, properties2);
+    return (properties & m_info->passedProperties()) == properties && (properties2 & m_info->passedProperties2()) == properties2;
+}
+
+namespace
+{
+/**
+ * Completes the fetches started by KWindowInfoPrivateX11::createAsync() in the main thread.
+ *
+ * The X server replies in request order: once the reply to a marker request sent after
+ * the requests of a fetch arrived, all replies of the fetch are there and reading them
+ * doesn't block. The marker is polled for whenever the event dispatcher wakes up, and
+ * with a coarse timer as replies don't wake it up by themselves.
+ */
+class AsyncWindowInfoFetches : public QObject
+{
+public:
+    explicit AsyncWindowInfoFetches(QObject *parent)
+        : QObject(parent)
+    {
+        // about once per frame, the wake-ups of the dispatcher mostly come earlier
+        m_timer.setTimerType(Qt::CoarseTimer);
+        m_timer.setInterval(16);
+        connect(&m_timer, &QTimer::timeout, this, &AsyncWindowInfoFetches::poll);
+        if (QAbstractEventDispatcher *dispatcher = QAbstractEventDispatcher::instance(thread())) {
+            connect(dispatcher, &QAbstractEventDispatcher::awake, this, &AsyncWindowInfoFetches::poll);
+        }
+    }
+
+    ~AsyncWindowInfoFetches() override
+    {
+        // deleted with the application, while the X connection is still there
+        xcb_connection_t *c = QX11Info::connection();
+        while (!m_fetches.empty()) {
+            const Fetch fetch = m_fetches.front();
+            m_fetches.pop_front();
+            xcb_discard_reply(c, fetch.marker);
+            complete(fetch);
+        }
+    }
+
+    static AsyncWindowInfoFetches *self()
+    {
+        // only used from the main thread, see createAsync()
+        Q_ASSERT(QThread::currentThread() == QCoreApplication::instance()->thread());
+        static QPointer<AsyncWindowInfoFetches> s_self;
+        if (s_self.isNull()) {
+            s_self = new AsyncWindowInfoFetches(QCoreApplication::instance());
+        }
+        return s_self.data();
+    }
+
+    void add(KWindowInfoPrivateX11 *info, const std::function<void(KWindowInfoPrivate *)> &callback)
+    {
+        xcb_connection_t *c = QX11Info::connection();
+        m_fetches.push_back({xcb_get_input_focus(c).sequence, info, callback});
+        xcb_flush(c);
+        if (!m_timer.isActive()) {
+            m_timer.start();
+        }
+    }
+
+private:
+    struct Fetch {
+        unsigned int marker;
+        KWindowInfoPrivateX11 *info;
+        std::function<void(KWindowInfoPrivate *)> callback;
+    };
+
+    void poll()
+    {
+        xcb_connection_t *c = QX11Info::connection();
+        while (!m_fetches.empty()) {
+            void *reply = nullptr;
+            xcb_generic_error_t *error = nullptr;
+            // no reply will ever come for a broken connection, the fetches fail at once then
+            if (!xcb_poll_for_reply(c, m_fetches.front().marker, &reply, &error) && !xcb_connection_has_error(c)) {
+                break;
+            }
+            free(reply);
+            free(error);
+            // the callback might start another fetch
+            const Fetch fetch = m_fetches.front();
+            m_fetches.pop_front();
+            complete(fetch);
+        }
+        if (m_fetches.empty()) {
+            m_timer.stop();
+        }
+    }
+
+    static void complete(const Fetch &fetch)
+    {
+        fetch.info->readReplies();
+        fetch.callback(fetch.info);
+    }
+
+    std::deque<Fetch> m_fetches;
+    QTimer m_timer;
+};
+}
+
+QList<KWindowInfoPrivate *> KWindowInfoPrivateX11::createMany(const QList<WId> &windows, NET::Properties properties, NET::Properties2 properties2)
+{
+    QList<KWindowInfoPrivate *> infos;
+    QList<KWindowInfoPrivateX11 *> pending;
+    infos.reserve(windows.count());
+    for (WId window : windows) {
+        if (KWindowInfoPrivate *info = NETEventFilter::mirroredWindowInfo(window, properties, properties2)) {
+            infos << info;
+            continue;
+        }
+        KWindowInfoPrivateX11 *info = new KWindowInfoPrivateX11(window, properties, properties2, Fetch::Deferred);
+        infos << info;
+        pending << info;
+    }
+    if (!pending.isEmpty()) {
+        xcb_flush(QX11Info::connection());
+        for (KWindowInfoPrivateX11 *info : std::as_const(pending)) {
+            info->readReplies();
+        }
+    }
+    return infos;
+}
+
+void KWindowInfoPrivateX11::createAsync(WId window,
+                                        NET::Properties properties,
+                                        NET::Properties2 properties2,
+                                        const std::function<void(KWindowInfoPrivate *)> &callback)
+{
+    QCoreApplication *app = QCoreApplication::instance();
+    if (QThread::currentThread() != app->thread()) {
+        // the fetches are completed in the main thread, so they are started there as well
+        QMetaObject::invokeMethod(app, [window, properties, properties2, callback] {
+            createAsync(window, properties, properties2, callback);
+        });
+        return;
+    }
+
+    if (KWindowInfoPrivate *mirrored = NETEventFilter::mirroredWindowInfo(window, properties, properties2)) {
+        // hold a reference, the mirror might replace the instance before the callback is invoked
+        QExplicitlySharedDataPointer<KWindowInfoPrivate> info(mirrored);
+        QTimer::singleShot(0, [info, callback] {
+            callback(info.data());
+        });
+        return;
+    }
+
+    KWindowInfoPrivateX11 *info = new KWindowInfoPrivateX11(window, properties, properties2, Fetch::Deferred);
+    AsyncWindowInfoFetches::self()->add(info, callback);
+}
+
 KWindowInfoPrivateX11::~KWindowInfoPrivateX11()
 {
+    xcb_connection_t *c = QX11Info::connection();
+    if (m_geometryCookie.sequence) {
+        xcb_discard_reply(c, m_geometryCookie.sequence);
+        xcb_discard_reply(c, m_translateCookie.sequence);
+    }
+    if (m_pidCookie.sequence) {
+        xcb_discard_reply(c, m_pidCookie.sequence);
+    }
+    if (m_attributesCookie.sequence) {
+        xcb_discard_reply(c, m_attributesCookie.sequence);
+    }
+    if (m_wmNameCookie.sequence) {
+        xcb_discard_reply(c, m_wmNameCookie.sequence);
+    }
+    if (m_wmIconNameCookie.sequence) {
+        xcb_discard_reply(c, m_wmIconNameCookie.sequence);
+    }
 }
 
 bool KWindowInfoPrivateX11::valid(bool withdrawn_is_valid) const
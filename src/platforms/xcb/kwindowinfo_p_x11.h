@@ -9,6 +9,11 @@
 #include "kwindowinfo_p.h"
 #include <QScopedPointer>
 
+#include <xcb/res.h>
+#include <xcb/xcb.h>
+
+#include <functional>
+
 class NETWinInfo;
 
 class KWindowInfoPrivateX11 : public KWindowInfoPrivate,
@@ -18,9 +23,50 @@ class KWindowInfoPrivateX11 : public KWindowInfoPrivate,
                               public KWindowInfoPrivateGtkApplicationIdExtension
 {
 public:
-    KWindowInfoPrivateX11(WId window, NET::Properties properties, NET::Properties2 properties2);
+    enum class Fetch {
+        Blocking, // the constructor waits for all replies
+        Deferred, // the constructor only sends the requests, readReplies() has to be called
+    };
+
+    KWindowInfoPrivateX11(WId window, NET::Properties properties, NET::Properties2 properties2, Fetch fetch = Fetch::Blocking);
+    /**
+     * Creates a copy of @p previous which only refetches the @p dirtyProperties and
+     * @p dirtyProperties2, behaves like Fetch::Deferred. The replies of @p previous
+     * have to be read already.
+     */
+    KWindowInfoPrivateX11(const KWindowInfoPrivateX11 &previous, NET::Properties dirtyProperties, NET::Properties2 dirtyProperties2);
     ~KWindowInfoPrivateX11() override;
 
+    /**
+     * Reads the replies for the requests sent by a constructor called with Fetch::Deferred.
+     */
+    void readReplies();
+
+    /**
+     * Refetches the @p dirtyProperties and @p dirtyProperties2 in place, like Fetch::Deferred
+     * the replies are read by readReplies(). Only for instances no KWindowInfo uses yet.
+     */
+    void requestUpdate(NET::Properties dirtyProperties, NET::Properties2 dirtyProperties2);
+
+    /**
+     * Whether this instance has the information a KWindowInfo created
+     * with @p properties and @p properties2 would have.
+     */
+    bool covers(NET::Properties properties, NET::Properties2 properties2) const;
+
+    /**
+     * Creates KWindowInfoPrivateX11 for all @p windows, sending all requests before
+     * waiting for any reply.
+     */
+    static QList<KWindowInfoPrivate *> createMany(const QList<WId> &windows, NET::Properties properties, NET::Properties2 properties2);
+
+    /**
+     * Sends the requests for @p window and returns immediately, from another thread they are
+     * sent by the main thread. @p callback is invoked in the main thread once all replies
+     * are available, without blocking it.
+     */
+    static void createAsync(WId window, NET::Properties properties, NET::Properties2 properties2, const std::function<void(KWindowInfoPrivate *)> &callback);
+
     bool valid(bool withdrawn_is_valid) const override;
     NET::States state() const override;
     bool isMinimized() const override;
@@ -55,7 +101,21 @@ public:
     int pid() const override;
 
 private:
+    static void addFallbackProperties(NET::Properties &properties, NET::Properties2 &properties2);
+    void requestGeometry();
+    void requestNames();
+
     QScopedPointer<NETWinInfo> m_info;
+    NET::Properties m_fetchProperties;
+    xcb_get_geometry_cookie_t m_geometryCookie = {0};
+    xcb_translate_coordinates_cookie_t m_translateCookie = {0};
+    xcb_res_query_client_ids_cookie_t m_pidCookie = {0};
+    // tells whether the window exists, without another roundtrip
+    xcb_get_window_attributes_cookie_t m_attributesCookie = {0};
+    // the fallbacks for windows without _NET_WM_NAME and _NET_WM_ICON_NAME
+    xcb_get_property_cookie_t m_wmNameCookie = {0};
+    xcb_get_property_cookie_t m_wmIconNameCookie = {0};
+    bool m_pendingReplies = false;
     QString m_name;
     QString m_iconic_name;
     QRect m_geometry;
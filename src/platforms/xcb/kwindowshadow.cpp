@@ -5,6 +5,9 @@
 */
 
 #include "kwindowshadow_p_x11.h"
+#include "kxutils_p.h"
+
+#include <QHash>
 
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
 #include <private/qtx11extras_p.h>
@@ -14,8 +17,62 @@
 
 static const QByteArray s_atomName = QByteArrayLiteral("_KDE_NET_WM_SHADOW");
 
-bool KWindowShadowTilePrivateX11::create()
+namespace
+{
+// The image of a tile together with the hash of its pixels
+struct TileKey {
+    QImage image;
+    size_t hash;
+};
+
+inline bool operator==(const TileKey &a, const TileKey &b)
+{
+    return a.hash == b.hash && a.image == b.image;
+}
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+inline size_t qHash(const TileKey &key, size_t seed = 0)
+#else
+inline uint qHash(const TileKey &key, uint seed = 0)
+#endif
+{
+    return key.hash ^ seed;
+}
+
+/**
+ * Server side pixmaps of the shadow tiles, shared by all tiles with the same pixels.
+ *
+ * Menus, tooltips and popups mostly use the same shadow, so most tiles are uploaded
+ * only once. A pixmap is freed when the last tile using it is destroyed.
+ */
+class ShadowTilePool
+{
+public:
+    xcb_pixmap_t acquire(const QImage &image);
+    void release(xcb_pixmap_t pixmap);
+
+private:
+    struct Tile {
+        xcb_pixmap_t pixmap;
+        int refCount;
+    };
+    QHash<TileKey, Tile> m_tiles;
+    QHash<xcb_pixmap_t, TileKey> m_keys;
+};
+}
+
+Q_GLOBAL_STATIC(ShadowTilePool, s_tilePool)
+
+xcb_pixmap_t ShadowTilePool::acquire(const QImage &image)
 {
+    const size_t hash = qHashBits(image.constBits(), image.sizeInBytes()) ^ qHash((image.width() << 16) ^ image.height()) ^ qHash(int(image.format()));
+    const TileKey key = {image, hash};
+    auto it = m_tiles.find(key);
+    if (it != m_tiles.end()) {
+        ++it->refCount;
+        return it->pixmap;
+    }
+
     xcb_connection_t *connection = QX11Info::connection();
     xcb_window_t rootWindow = QX11Info::appRootWindow();
 
@@ -23,37 +80,59 @@ bool KWindowShadowTilePrivateX11::create()
     const uint16_t height = uint16_t(image.height());
     const uint8_t depth = uint8_t(image.depth());
 
-    pixmap = xcb_generate_id(connection);
-    gc = xcb_generate_id(connection);
+    const xcb_pixmap_t pixmap = xcb_generate_id(connection);
+    const xcb_gcontext_t gc = xcb_generate_id(connection);
 
     xcb_create_pixmap(connection, depth, pixmap, rootWindow, width, height);
     xcb_create_gc(connection, gc, pixmap, 0, nullptr);
 
-    xcb_put_image(connection, //
-                  XCB_IMAGE_FORMAT_Z_PIXMAP,
-                  pixmap,
-                  gc,
-                  width,
-                  height,
-                  0,
-                  0,
-                  0,
-                  depth,
-                  image.sizeInBytes(),
-                  image.constBits());
+    // large tiles, like the ones of scaled shadows on high resolution screens, exceed the
+    // maximum request length
+    const bool uploaded = KXUtils::putImage(connection, pixmap, gc, image, depth);
+    // the pixmap doesn't change afterwards, the gc is not needed anymore
+    xcb_free_gc(connection, gc);
+    if (!uploaded) {
+        xcb_free_pixmap(connection, pixmap);
+        return XCB_PIXMAP_NONE;
+    }
 
-    return true;
+    m_tiles.insert(key, Tile{pixmap, 1});
+    m_keys.insert(pixmap, key);
+    return pixmap;
 }
 
-void KWindowShadowTilePrivateX11::destroy()
+void ShadowTilePool::release(xcb_pixmap_t pixmap)
 {
+    auto key = m_keys.find(pixmap);
+    if (key == m_keys.end()) {
+        return;
+    }
+    auto tile = m_tiles.find(key.value());
+    if (--tile->refCount > 0) {
+        return;
+    }
     xcb_connection_t *connection = QX11Info::connection();
     if (connection) {
         xcb_free_pixmap(connection, pixmap);
-        xcb_free_gc(connection, gc);
+    }
+    m_tiles.erase(tile);
+    m_keys.erase(key);
+}
+
+bool KWindowShadowTilePrivateX11::create()
+{
+    pixmap = s_tilePool->acquire(image);
+    return pixmap != XCB_PIXMAP_NONE;
+}
+
+void KWindowShadowTilePrivateX11::destroy()
+{
+    if (pixmap != XCB_PIXMAP_NONE) {
+        if (ShadowTilePool *pool = s_tilePool()) {
+            pool->release(pixmap);
+        }
     }
     pixmap = XCB_PIXMAP_NONE;
-    gc = XCB_NONE;
 }
 
 KWindowShadowTilePrivateX11 *KWindowShadowTilePrivateX11::get(const KWindowShadowTile *tile)
@@ -85,21 +164,24 @@ static xcb_atom_t lookupAtom(const QByteArray &atomName)
     return atom;
 }
 
+// Interned once, animated popups update their shadows every frame
+static xcb_atom_t shadowAtom()
+{
+    static xcb_atom_t atom = XCB_ATOM_NONE;
+    if (atom == XCB_ATOM_NONE) {
+        atom = lookupAtom(s_atomName);
+    }
+    return atom;
+}
+
 static xcb_pixmap_t nativeHandleForTile(const KWindowShadowTile::Ptr &tile)
 {
     const auto d = KWindowShadowTilePrivateX11::get(tile.data());
     return d->pixmap;
 }
 
-bool KWindowShadowPrivateX11::create()
+QVector<quint32> KWindowShadowPrivateX11::propertyData()
 {
-    xcb_connection_t *connection = QX11Info::connection();
-
-    const xcb_atom_t atom = lookupAtom(s_atomName);
-    if (atom == XCB_ATOM_NONE) {
-        return false;
-    }
-
     QVector<quint32> data(12);
     int i = 0;
 
@@ -107,52 +189,22 @@ bool KWindowShadowPrivateX11::create()
     // KWin expects **all** shadow tile handles to be valid. Maybe we could address this small
     // inconvenience and then remove the empty tile stuff.
 
-    if (topTile) {
-        data[i++] = nativeHandleForTile(topTile);
-    } else {
-        data[i++] = nativeHandleForTile(getOrCreateEmptyTile());
-    }
-
-    if (topRightTile) {
-        data[i++] = nativeHandleForTile(topRightTile);
-    } else {
-        data[i++] = nativeHandleForTile(getOrCreateEmptyTile());
-    }
-
-    if (rightTile) {
-        data[i++] = nativeHandleForTile(rightTile);
-    } else {
-        data[i++] = nativeHandleForTile(getOrCreateEmptyTile());
-    }
-
-    if (bottomRightTile) {
-        data[i++] = nativeHandleForTile(bottomRightTile);
-    } else {
-        data[i++] = nativeHandleForTile(getOrCreateEmptyTile());
-    }
-
-    if (bottomTile) {
-        data[i++] = nativeHandleForTile(bottomTile);
-    } else {
-        data[i++] = nativeHandleForTile(getOrCreateEmptyTile());
-    }
-
-    if (bottomLeftTile) {
-        data[i++] = nativeHandleForTile(bottomLeftTile);
-    } else {
-        data[i++] = nativeHandleForTile(getOrCreateEmptyTile());
-    }
-
-    if (leftTile) {
-        data[i++] = nativeHandleForTile(leftTile);
-    } else {
-        data[i++] = nativeHandleForTile(getOrCreateEmptyTile());
-    }
-
-    if (topLeftTile) {
-        data[i++] = nativeHandleForTile(topLeftTile);
-    } else {
-        data[i++] = nativeHandleForTile(getOrCreateEmptyTile());
+    const KWindowShadowTile::Ptr tiles[] = {
+        topTile,
+        topRightTile,
+        rightTile,
+        bottomRightTile,
+        bottomTile,
+        bottomLeftTile,
+        leftTile,
+        topLeftTile,
+    };
+    for (const KWindowShadowTile::Ptr &tile : tiles) {
+        if (tile) {
+            data[i++] = nativeHandleForTile(tile);
+        } else {
+            data[i++] = nativeHandleForTile(getOrCreateEmptyTile());
+        }
     }
 
     if (topLeftTile || topTile || topRightTile) {
@@ -179,15 +231,47 @@ bool KWindowShadowPrivateX11::create()
         data[i++] = 1;
     }
 
-    xcb_change_property(connection, XCB_PROP_MODE_REPLACE, window->winId(), atom, XCB_ATOM_CARDINAL, 32, data.size(), data.constData());
-    xcb_flush(connection);
+    return data;
+}
+
+bool KWindowShadowPrivateX11::create()
+{
+    writtenData.clear();
+    return update();
+}
+
+bool KWindowShadowPrivateX11::update()
+{
+    if (!window) {
+        return false;
+    }
+    xcb_connection_t *connection = QX11Info::connection();
+
+    const xcb_atom_t atom = shadowAtom();
+    if (atom == XCB_ATOM_NONE) {
+        return false;
+    }
+
+    const QVector<quint32> data = propertyData();
+    if (data != writtenData) {
+        // the property can only be replaced as a whole, but it's just 48 bytes
+        xcb_change_property(connection, XCB_PROP_MODE_REPLACE, window->winId(), atom, XCB_ATOM_CARDINAL, 32, data.size(), data.constData());
+        xcb_flush(connection);
+        writtenData = data;
+    }
+    // only now the tiles replaced since the last write may free their pixmaps
+    writtenTiles = {topTile, topRightTile, rightTile, bottomRightTile, bottomTile, bottomLeftTile, leftTile, topLeftTile, emptyTile};
 
     return true;
 }
 
 void KWindowShadowPrivateX11::destroy()
 {
+    // the pixmaps of the tiles are freed once the property is deleted
+    const QVector<KWindowShadowTile::Ptr> tiles = std::move(writtenTiles);
+    writtenTiles.clear();
     emptyTile = nullptr;
+    writtenData.clear();
 
     // For some reason, QWindow changes visibility of QSurface::surfaceHandle().
     const QSurface *surface = window;
@@ -199,7 +283,7 @@ void KWindowShadowPrivateX11::destroy()
 
     xcb_connection_t *connection = QX11Info::connection();
 
-    const xcb_atom_t atom = lookupAtom(s_atomName);
+    const xcb_atom_t atom = shadowAtom();
     if (atom == XCB_ATOM_NONE) {
         return;
     }
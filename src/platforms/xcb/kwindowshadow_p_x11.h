@@ -20,18 +20,24 @@ public:
     static KWindowShadowTilePrivateX11 *get(const KWindowShadowTile *tile);
 
     xcb_pixmap_t pixmap = XCB_PIXMAP_NONE;
-    xcb_gcontext_t gc = XCB_NONE;
 };
 
-class KWindowShadowPrivateX11 final : public KWindowShadowPrivate
+class KWindowShadowPrivateX11 final : public KWindowShadowPrivateV2
 {
 public:
     bool create() override;
     void destroy() override;
+    bool update() override;
 
     KWindowShadowTile::Ptr getOrCreateEmptyTile();
+    QVector<quint32> propertyData();
 
     KWindowShadowTile::Ptr emptyTile;
+    // the property as last written to the window
+    QVector<quint32> writtenData;
+    // the tiles whose pixmaps writtenData refers to, a tile replaced on the created
+    // shadow must not free its pixmap before the property is written again
+    QVector<KWindowShadowTile::Ptr> writtenTiles;
 };
 
 #endif // KWINDOWSHADOW_P_X11_H
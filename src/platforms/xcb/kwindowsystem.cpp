@@ -9,10 +9,14 @@
 
 #include "kwindowsystem.h"
 #include "kwindowsystem_p_x11.h"
+#include "kwindowchangequeue_p.h"
+#include "kwindowsystemsnapshot_p.h"
+#include "netwm_p.h"
 
 // clang-format off
 #include <kxerrorhandler_p.h>
 #include <fixx11h.h>
+#include <kxpixelconversion_p.h>
 #include <kxutils_p.h>
 // clang-format on
 
@@ -20,6 +24,7 @@
 #include <QIcon>
 #include <QMetaMethod>
 #include <QScreen>
+#include <QThread>
 #include <QWindow>
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
 #include <private/qtx11extras_p.h>
@@ -38,9 +43,87 @@
 #include <X11/extensions/Xfixes.h>
 #endif
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
 static Atom net_wm_cm;
 static void create_atoms();
 
+static inline const QRect &displayGeometry();
+
+// what is left of @p all by a strut
+static QRect strutArea(const QRect &all, const NETStrut &strut)
+{
+    QRect r = all;
+    if (strut.left > 0) {
+        r.setLeft(r.left() + (int)strut.left);
+    }
+    if (strut.top > 0) {
+        r.setTop(r.top() + (int)strut.top);
+    }
+    if (strut.right > 0) {
+        r.setRight(r.right() - (int)strut.right);
+    }
+    if (strut.bottom > 0) {
+        r.setBottom(r.bottom() - (int)strut.bottom);
+    }
+    return r;
+}
+
+// what is left of @p output by a strut, which is relative to the edges of @p all
+static QRect extendedStrutArea(const QRect &all, const QRect &output, const NETEventFilter::StrutData &data)
+{
+    NETExtendedStrut strut = data.extendedStrut;
+    if (!strut.left_width && !strut.right_width && !strut.top_width && !strut.bottom_width) {
+        // a legacy strut covers the whole edge
+        strut.left_width = data.strut.left;
+        strut.right_width = data.strut.right;
+        strut.top_width = data.strut.top;
+        strut.bottom_width = data.strut.bottom;
+        strut.left_start = strut.right_start = all.top();
+        strut.left_end = strut.right_end = all.bottom();
+        strut.top_start = strut.bottom_start = all.left();
+        strut.top_end = strut.bottom_end = all.right();
+    }
+
+    QRect r = output;
+    if (strut.left_width > 0) {
+        const QRect reserved(all.left(), strut.left_start, strut.left_width, strut.left_end - strut.left_start + 1);
+        if (reserved.intersects(output)) {
+            r.setLeft(qMax(r.left(), reserved.right() + 1));
+        }
+    }
+    if (strut.right_width > 0) {
+        const QRect reserved(all.right() - strut.right_width + 1, strut.right_start, strut.right_width, strut.right_end - strut.right_start + 1);
+        if (reserved.intersects(output)) {
+            r.setRight(qMin(r.right(), reserved.left() - 1));
+        }
+    }
+    if (strut.top_width > 0) {
+        const QRect reserved(strut.top_start, all.top(), strut.top_end - strut.top_start + 1, strut.top_width);
+        if (reserved.intersects(output)) {
+            r.setTop(qMax(r.top(), reserved.bottom() + 1));
+        }
+    }
+    if (strut.bottom_width > 0) {
+        const QRect reserved(strut.bottom_start, all.bottom() - strut.bottom_width + 1, strut.bottom_end - strut.bottom_start + 1, strut.bottom_width);
+        if (reserved.intersects(output)) {
+            r.setBottom(qMin(r.bottom(), reserved.top() - 1));
+        }
+    }
+    return r;
+}
+
+static bool hasStrut(const NETWinInfo &info)
+{
+    const NETStrut strut = info.strut();
+    const NETExtendedStrut extendedStrut = info.extendedStrut();
+    return strut.left || strut.top || strut.right || strut.bottom //
+        || extendedStrut.left_width || extendedStrut.right_width || extendedStrut.top_width || extendedStrut.bottom_width;
+}
+
 static inline const QRect &displayGeometry()
 {
     static QRect displayGeometry;
@@ -108,8 +191,117 @@ static const NET::Properties desktopProperties = NET::ClientList | NET::ClientLi
                                                  NET::ActiveWindow |
                                                  NET::WorkArea;
 static const NET::Properties2 desktopProperties2 = NET::WM2ShowingDesktop;
+
+// the properties kept in the window info cache
+static const NET::Properties mirrorProperties = NET::WMName | NET::WMVisibleName |
+                                                NET::WMIconName | NET::WMVisibleIconName |
+                                                NET::WMState | NET::XAWMState |
+                                                NET::WMDesktop |
+                                                NET::WMWindowType |
+                                                NET::WMGeometry | NET::WMFrameExtents |
+                                                NET::WMStrut |
+                                                NET::WMPid;
+static const NET::Properties2 mirrorProperties2 = NET::WM2WindowClass | NET::WM2ExtendedStrut | NET::WM2TransientFor;
 // clang-format on
 
+// the event filter which has the window info cache enabled
+static NETEventFilter *s_mirroringFilter = nullptr;
+
+// the last published snapshot, the mutex is only held to copy or replace the pointer
+static QMutex s_snapshotMutex;
+static QExplicitlySharedDataPointer<const KWindowSystemSnapshotPrivate> s_snapshot;
+static std::atomic<quint64> s_snapshotSerial(0);
+
+// the recent window changes, kept across event filters, only recorded once
+// KWindowSystem::changesSince() was called
+Q_GLOBAL_STATIC(WindowChangeJournal, s_journal)
+static std::atomic<bool> s_journalEnabled(false);
+
+namespace
+{
+// the queues of KWindowSystem::addChangeQueue(), pushed to by the main thread while
+// any thread may add and remove them
+struct ChangeQueues {
+    // held while pushing, so that a removed queue isn't accessed anymore
+    QMutex mutex;
+    QVector<KWindowChangeQueuePrivate *> queues;
+    // whether there are queues, the main thread only locks when there are
+    std::atomic<bool> active{false};
+};
+}
+Q_GLOBAL_STATIC(ChangeQueues, s_changeQueues)
+
+// the root window properties a snapshot is made of
+static const NET::Properties snapshotProperties = NET::ClientList | NET::ClientListStacking | NET::ActiveWindow | NET::CurrentDesktop
+    | NET::NumberOfDesktops | NET::DesktopGeometry | NET::DesktopViewport | NET::WorkArea;
+
+// Marks the longest increasing subsequence of @p values. Of equally long ones the
+// one completed first wins, so of two swapped neighbors the later one is kept.
+static std::vector<bool> longestIncreasingSubsequence(const std::vector<int> &values)
+{
+    std::vector<int> tails; // index of the smallest last value of a subsequence of each length
+    std::vector<int> previous(values.size(), -1);
+    int last = -1;
+    for (int i = 0; i < int(values.size()); ++i) {
+        auto it = std::lower_bound(tails.begin(), tails.end(), values[i], [&values](int index, int value) {
+            return values[index] < value;
+        });
+        if (it != tails.begin()) {
+            previous[i] = *(it - 1);
+        }
+        if (it == tails.end()) {
+            tails.push_back(i);
+            last = i;
+        } else {
+            *it = i;
+        }
+    }
+
+    std::vector<bool> result(values.size(), false);
+    for (int i = last; i != -1; i = previous[i]) {
+        result[i] = true;
+    }
+    return result;
+}
+
+// The windows which stayed in the same relative order are the longest increasing
+// subsequence of their old positions, all others moved.
+static void diffStackingOrder(const QList<WId> &oldOrder, const QList<WId> &newOrder, QList<WId> *inserted, QList<WId> *removed, QList<WId> *moved)
+{
+    QHash<WId, int> oldPositions;
+    oldPositions.reserve(oldOrder.count());
+    for (int i = 0; i < oldOrder.count(); ++i) {
+        oldPositions.insert(oldOrder.at(i), i);
+    }
+
+    std::vector<int> positions;
+    std::vector<WId> kept;
+    positions.reserve(newOrder.count());
+    kept.reserve(newOrder.count());
+    for (WId window : newOrder) {
+        auto it = oldPositions.find(window);
+        if (it == oldPositions.end()) {
+            inserted->append(window);
+        } else {
+            positions.push_back(it.value());
+            kept.push_back(window);
+            it.value() = -1; // still there
+        }
+    }
+    for (WId window : oldOrder) {
+        if (oldPositions.value(window) != -1) {
+            removed->append(window);
+        }
+    }
+
+    const std::vector<bool> inOrder = longestIncreasingSubsequence(positions);
+    for (size_t i = 0; i < kept.size(); ++i) {
+        if (!inOrder[i]) {
+            moved->append(kept[i]);
+        }
+    }
+}
+
 MainThreadInstantiator::MainThreadInstantiator(KWindowSystemPrivateX11::FilterInfo _what)
     : QObject()
     , m_what(_what)
@@ -128,13 +320,20 @@ NETEventFilter::NETEventFilter(KWindowSystemPrivateX11::FilterInfo _what)
                   QX11Info::appScreen(),
                   false)
     , QAbstractNativeEventFilter()
+    , stackingOrderGeneration(0)
+    , stackingOrderDeltaConnected(false)
     , strutSignalConnected(false)
     , compositingEnabled(false)
     , haveXfixes(false)
     , what(_what)
     , winId(XCB_WINDOW_NONE)
     , m_appRootWindow(QX11Info::appRootWindow())
+    , m_mirrorEnabled(false)
+    , m_coalesceWindowChanges(false)
+    , m_snapshotScheduled(false)
 {
+    iconCache.setMaxCost(8 * 1024); // KiB
+
     QCoreApplication::instance()->installNativeEventFilter(this);
 
 #if KWINDOWSYSTEM_HAVE_XFIXES
@@ -167,6 +366,9 @@ NETEventFilter::NETEventFilter(KWindowSystemPrivateX11::FilterInfo _what)
 
 NETEventFilter::~NETEventFilter()
 {
+    if (s_mirroringFilter == this) {
+        s_mirroringFilter = nullptr;
+    }
     if (QX11Info::connection() && winId != XCB_WINDOW_NONE) {
         xcb_destroy_window(QX11Info::connection(), winId);
         winId = XCB_WINDOW_NONE;
@@ -177,6 +379,7 @@ NETEventFilter::~NETEventFilter()
 void NETEventFilter::activate()
 {
     NETRootInfo::activate();
+    addPendingClients();
     updateStackingOrder();
 }
 
@@ -246,6 +449,7 @@ bool NETEventFilter::nativeEventFilter(xcb_generic_event_t *ev)
         NET::Properties props;
         NET::Properties2 props2;
         NETRootInfo::event(ev, &props, &props2);
+        addPendingClients();
 
         if ((props & CurrentDesktop) && currentDesktop() != old_current_desktop) {
             Q_EMIT s_q->currentDesktopChanged(currentDesktop());
@@ -269,17 +473,27 @@ bool NETEventFilter::nativeEventFilter(xcb_generic_event_t *ev)
             Q_EMIT s_q->workAreaChanged();
         }
         if (props & ClientListStacking) {
-            updateStackingOrder();
+            const QList<WId> oldStackingOrder = stackingOrder;
+            const bool changed = updateStackingOrder();
             Q_EMIT s_q->stackingOrderChanged();
+            if (changed && stackingOrderDeltaConnected) {
+                QList<WId> inserted;
+                QList<WId> removed;
+                QList<WId> moved;
+                diffStackingOrder(oldStackingOrder, stackingOrder, &inserted, &removed, &moved);
+                Q_EMIT s_q->stackingOrderDelta(inserted, removed, moved);
+            }
         }
         if ((props2 & WM2ShowingDesktop) && showingDesktop() != old_showing_desktop) {
             Q_EMIT s_q->showingDesktopChanged(showingDesktop());
         }
+        if (props & snapshotProperties) {
+            scheduleSnapshot();
+        }
     } else if (windows.contains(eventWindow)) {
-        NETWinInfo ni(QX11Info::connection(), eventWindow, m_appRootWindow, NET::Properties(), NET::Properties2());
         NET::Properties dirtyProperties;
         NET::Properties2 dirtyProperties2;
-        ni.event(ev, &dirtyProperties, &dirtyProperties2);
+        NETWinInfo::dirtyProperties(xcbConnection(), ev, &dirtyProperties, &dirtyProperties2);
         if (eventType == XCB_PROPERTY_NOTIFY) {
             xcb_property_notify_event_t *event = reinterpret_cast<xcb_property_notify_event_t *>(ev);
             if (event->atom == XCB_ATOM_WM_HINTS) {
@@ -296,84 +510,497 @@ bool NETEventFilter::nativeEventFilter(xcb_generic_event_t *ev)
              */
             dirtyProperties |= NET::WMDesktop;
         }
-        if ((dirtyProperties & NET::WMStrut) != 0) {
+        if ((dirtyProperties & NET::WMStrut) != 0 || (dirtyProperties2 & NET::WM2ExtendedStrut) != 0
+            || ((dirtyProperties & NET::WMDesktop) && strutWindows.contains(eventWindow))) {
+            // refetched when needed, the desktop of a strut window matters for the work areas
             removeStrutWindow(eventWindow);
-            if (!possibleStrutWindows.contains(eventWindow)) {
-                possibleStrutWindows.append(eventWindow);
+            possibleStrutWindows.insert(eventWindow);
+        }
+        if ((dirtyProperties & NET::WMIcon) || (dirtyProperties2 & NET::WM2WindowClass)) {
+            // WMIcon includes WM_HINTS, the class determines the theme icon
+            discardIcons(eventWindow);
+        }
+        if (m_mirrorEnabled && ((dirtyProperties & mirrorProperties) || (dirtyProperties2 & mirrorProperties2))) {
+            // refetched by mirroredWindowInfo(), so that receivers already get the new values
+            auto it = m_mirror.find(eventWindow);
+            if (it != m_mirror.end()) {
+                it->dirtyProperties |= dirtyProperties & mirrorProperties;
+                it->dirtyProperties2 |= dirtyProperties2 & mirrorProperties2;
             }
         }
         if (dirtyProperties || dirtyProperties2) {
+            recordChange(eventWindow, KWindowChange::Changed, dirtyProperties, dirtyProperties2);
+            if (!m_coalesceWindowChanges) {
+                emitWindowChanged(eventWindow, dirtyProperties, dirtyProperties2);
+            } else {
+                const auto it = m_pendingWindowChangeIndex.constFind(eventWindow);
+                if (it != m_pendingWindowChangeIndex.constEnd()) {
+                    WindowChange &change = m_pendingWindowChanges[it.value()];
+                    change.properties |= dirtyProperties;
+                    change.properties2 |= dirtyProperties2;
+                } else {
+                    if (m_pendingWindowChanges.isEmpty()) {
+                        // after the events processed together with this one
+                        QMetaObject::invokeMethod(
+                            &m_queuedCallsContext,
+                            [this] {
+                                emitPendingWindowChanges();
+                            },
+                            Qt::QueuedConnection);
+                    }
+                    m_pendingWindowChangeIndex.insert(eventWindow, m_pendingWindowChanges.count());
+                    m_pendingWindowChanges.append({eventWindow, dirtyProperties, dirtyProperties2});
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+void NETEventFilter::recordChange(WId window, KWindowChange::Kind kind, NET::Properties properties, NET::Properties2 properties2)
+{
+    if (s_journalEnabled.load(std::memory_order_acquire)) {
+        s_journal->record(window, kind, properties, properties2);
+    }
+    if (s_changeQueues.exists() && s_changeQueues->active.load(std::memory_order_acquire)) {
+        KWindowChange change;
+        change.window = window;
+        change.kinds = kind;
+        change.properties = properties;
+        change.properties2 = properties2;
+        QMutexLocker locker(&s_changeQueues->mutex);
+        for (KWindowChangeQueuePrivate *queue : std::as_const(s_changeQueues->queues)) {
+            queue->push(change);
+        }
+    }
+}
+
+void NETEventFilter::emitWindowChanged(WId window, NET::Properties properties, NET::Properties2 properties2)
+{
+    KWindowSystem *s_q = KWindowSystem::self();
 #if KWINDOWSYSTEM_BUILD_DEPRECATED_SINCE(5, 80)
-            Q_EMIT s_q->windowChanged(eventWindow);
+    Q_EMIT s_q->windowChanged(window);
 #endif
-            Q_EMIT s_q->windowChanged(eventWindow, dirtyProperties, dirtyProperties2);
+    Q_EMIT s_q->windowChanged(window, properties, properties2);
 
 #if KWINDOWSYSTEM_BUILD_DEPRECATED_SINCE(5, 0)
-            unsigned long dirty[2] = {dirtyProperties, dirtyProperties2};
-            Q_EMIT s_q->windowChanged(eventWindow, dirty);
-            Q_EMIT s_q->windowChanged(eventWindow, dirtyProperties);
+    unsigned long dirty[2] = {properties, properties2};
+    Q_EMIT s_q->windowChanged(window, dirty);
+    Q_EMIT s_q->windowChanged(window, properties);
 #endif
-            if ((dirtyProperties & NET::WMStrut) != 0) {
-                Q_EMIT s_q->strutChanged();
-            }
+    if ((properties & NET::WMStrut) != 0) {
+        Q_EMIT s_q->strutChanged();
+    }
+}
+
+void NETEventFilter::emitPendingWindowChanges()
+{
+    // receivers may cause new changes to be queued
+    QVector<WindowChange> changes;
+    changes.swap(m_pendingWindowChanges);
+    m_pendingWindowChangeIndex.clear();
+    for (const WindowChange &change : std::as_const(changes)) {
+        if (change.window != XCB_WINDOW_NONE) {
+            emitWindowChanged(change.window, change.properties, change.properties2);
         }
     }
+}
 
-    return false;
+void NETEventFilter::scheduleSnapshot()
+{
+    if (m_snapshotScheduled) {
+        return;
+    }
+    m_snapshotScheduled = true;
+    QMetaObject::invokeMethod(
+        &m_queuedCallsContext,
+        [this] {
+            m_snapshotScheduled = false;
+            publishSnapshot();
+        },
+        Qt::QueuedConnection);
+}
+
+void NETEventFilter::publishSnapshot()
+{
+    // what KWindowSystem returns right now, in the main thread that's all known already
+    QExplicitlySharedDataPointer<KWindowSystemSnapshotPrivate> snapshot(new KWindowSystemSnapshotPrivate);
+    snapshot->serial = ++s_snapshotSerial;
+    snapshot->windows = KWindowSystem::windows();
+    snapshot->stackingOrder = KWindowSystem::stackingOrder();
+    snapshot->activeWindow = KWindowSystem::activeWindow();
+    snapshot->currentDesktop = KWindowSystem::currentDesktop();
+    snapshot->numberOfDesktops = KWindowSystem::numberOfDesktops();
+    snapshot->workAreas.reserve(snapshot->numberOfDesktops);
+    for (int desktop = 1; desktop <= snapshot->numberOfDesktops; ++desktop) {
+        snapshot->workAreas.append(KWindowSystem::workArea(desktop));
+    }
+    QExplicitlySharedDataPointer<const KWindowSystemSnapshotPrivate> published(snapshot.data());
+    QMutexLocker locker(&s_snapshotMutex);
+    // the previous one is released after unlocking, it might be the last reference
+    s_snapshot.swap(published);
+}
+
+void NETEventFilter::setWindowChangesCoalesced(bool coalesced)
+{
+    m_coalesceWindowChanges = coalesced;
+    if (!coalesced) {
+        emitPendingWindowChanges();
+    }
+}
+
+WindowChangeJournal::WindowChangeJournal() = default;
+
+void WindowChangeJournal::enable()
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_entries.capacity() > 0) {
+        return;
+    }
+    m_entries.setCapacity(4096);
+    // nothing was recorded before, so all earlier generations need a resync
+    m_completeSince = ++m_generation;
+}
+
+void WindowChangeJournal::record(WId window, KWindowChange::Kind kind, NET::Properties properties, NET::Properties2 properties2)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_entries.isFull()) {
+        // the changes after the dropped one are still complete
+        m_completeSince = m_entries.first().generation;
+    }
+    m_entries.append({++m_generation, window, kind, properties, properties2});
+    if (!m_entries.areIndexesValid()) {
+        m_entries.normalizeIndexes();
+    }
+}
+
+void WindowChangeJournal::invalidate()
+{
+    QMutexLocker locker(&m_mutex);
+    m_entries.clear();
+    m_completeSince = m_generation;
+}
+
+KWindowChanges WindowChangeJournal::changesSince(quint64 generation) const
+{
+    QMutexLocker locker(&m_mutex);
+    KWindowChanges result;
+    result.generation = m_generation;
+    if (generation < m_completeSince || generation > m_generation) {
+        result.resyncNeeded = true;
+        return result;
+    }
+
+    // compacted to one change per window
+    QHash<WId, int> indexes;
+    QVector<bool> addedFirst;
+    QVector<bool> removedLast;
+    // the generations are consecutive
+    const int first = m_entries.lastIndex() - int(m_generation - generation) + 1;
+    for (int i = first; i <= m_entries.lastIndex(); ++i) {
+        const Entry &entry = m_entries.at(i);
+        auto it = indexes.constFind(entry.window);
+        if (it == indexes.constEnd()) {
+            it = indexes.insert(entry.window, result.changes.count());
+            KWindowChange change;
+            change.window = entry.window;
+            result.changes.append(change);
+            addedFirst.append(entry.kind == KWindowChange::Added);
+            removedLast.append(false);
+        }
+        KWindowChange &change = result.changes[it.value()];
+        change.kinds |= entry.kind;
+        change.properties |= entry.properties;
+        change.properties2 |= entry.properties2;
+        removedLast[it.value()] = entry.kind == KWindowChange::Removed;
+    }
+
+    // a window which came and went isn't of interest
+    int kept = 0;
+    for (int i = 0; i < result.changes.count(); ++i) {
+        if (!(addedFirst.at(i) && removedLast.at(i))) {
+            result.changes[kept++] = result.changes.at(i);
+        }
+    }
+    result.changes.erase(result.changes.begin() + kept, result.changes.end());
+    return result;
+}
+
+void ClientWindowList::append(WId window)
+{
+    if (m_index.contains(window)) {
+        return;
+    }
+    m_index.insert(window, m_list.count());
+    m_list.append(window);
+}
+
+void ClientWindowList::remove(WId window)
+{
+    const auto it = m_index.constFind(window);
+    if (it == m_index.constEnd()) {
+        return;
+    }
+    m_list[it.value()] = XCB_WINDOW_NONE;
+    m_index.erase(it);
+    ++m_holes;
+    if (m_holes > 64 && m_holes > m_list.count() / 2) {
+        compact();
+    }
+}
+
+const QList<WId> &ClientWindowList::list() const
+{
+    if (m_holes > 0) {
+        compact();
+    }
+    return m_list;
+}
+
+void ClientWindowList::compact() const
+{
+    m_list.removeAll(XCB_WINDOW_NONE);
+    m_holes = 0;
+    for (int i = 0; i < m_list.count(); ++i) {
+        m_index[m_list.at(i)] = i;
+    }
+}
+
+void NETEventFilter::cacheIcon(const IconCacheKey &key, const QPixmap &icon)
+{
+    // the cost is in KiB
+    iconCache.insert(key, new QPixmap(icon), qMax(1, icon.width() * icon.height() * 4 / 1024));
+    if (!iconCacheKeys.contains(key.window, key)) {
+        iconCacheKeys.insert(key.window, key);
+    }
+}
+
+void NETEventFilter::discardIcons(WId window)
+{
+    const auto keys = iconCacheKeys.values(window);
+    for (const IconCacheKey &key : keys) {
+        iconCache.remove(key);
+    }
+    iconCacheKeys.remove(window);
+}
+
+void NETEventFilter::clearIcons()
+{
+    iconCache.clear();
+    iconCacheKeys.clear();
 }
 
 bool NETEventFilter::removeStrutWindow(WId w)
 {
-    for (QList<StrutData>::Iterator it = strutWindows.begin(); it != strutWindows.end(); ++it) {
-        if ((*it).window == w) {
-            strutWindows.erase(it);
-            return true;
+    if (strutWindows.remove(w) == 0) {
+        return false;
+    }
+    invalidateWorkAreas();
+    return true;
+}
+
+void NETEventFilter::resolvePossibleStrutWindows()
+{
+    if (possibleStrutWindows.isEmpty()) {
+        return;
+    }
+    // send all requests before waiting for the first reply
+    std::vector<std::unique_ptr<NETWinInfo>> infos;
+    infos.reserve(possibleStrutWindows.count());
+    for (WId w : std::as_const(possibleStrutWindows)) {
+        infos.emplace_back(new NETWinInfo(QX11Info::connection(), w, m_appRootWindow, NET::Properties(), NET::Properties2()));
+        NETWinInfoPrivateAccess::requestProperties(infos.back().get(), NET::WMStrut | NET::WMDesktop, NET::WM2ExtendedStrut);
+    }
+    possibleStrutWindows.clear();
+    for (const auto &info : infos) {
+        NETWinInfoPrivateAccess::readUpdateReplies(info.get());
+        if (hasStrut(*info)) {
+            addStrutWindow(StrutData(info->window(), info->strut(), info->extendedStrut(), info->desktop()));
+        }
+    }
+}
+
+void NETEventFilter::addStrutWindow(const StrutData &data)
+{
+    removeStrutWindow(data.window);
+    strutWindows.insert(data.window, data);
+
+    // a new strut can only make the remembered work areas smaller
+    const QRect &all = workAreasDisplayGeometry;
+    for (auto it = workAreas.begin(); it != workAreas.end(); ++it) {
+        if (data.desktop == it.key().desktop || data.desktop == NETWinInfo::OnAllDesktops) {
+            it.value() = it.value().intersected(strutArea(all, data.strut));
+        }
+    }
+    for (auto it = screenWorkAreas.begin(); it != screenWorkAreas.end(); ++it) {
+        if (data.desktop == it.key().desktop || data.desktop == NETWinInfo::OnAllDesktops) {
+            it.value() = it.value().intersected(extendedStrutArea(all, it.key().output, data));
         }
     }
-    return false;
 }
 
-void NETEventFilter::updateStackingOrder()
+void NETEventFilter::invalidateWorkAreas()
 {
-    stackingOrder.clear();
-    for (int i = 0; i < clientListStackingCount(); i++) {
-        stackingOrder.append(clientListStacking()[i]);
+    workAreas.clear();
+    screenWorkAreas.clear();
+}
+
+void NETEventFilter::checkWorkAreasDisplayGeometry(const QRect &displayGeometry)
+{
+    if (workAreasDisplayGeometry != displayGeometry) {
+        invalidateWorkAreas();
+        workAreasDisplayGeometry = displayGeometry;
     }
 }
 
+void NETEventFilter::setMirrorEnabled(bool enabled)
+{
+    if (m_mirrorEnabled == enabled) {
+        return;
+    }
+    m_mirrorEnabled = enabled;
+    m_mirror.clear();
+    if (!enabled) {
+        if (s_mirroringFilter == this) {
+            s_mirroringFilter = nullptr;
+        }
+        return;
+    }
+    s_mirroringFilter = this;
+    // all requests are sent at once, the replies are read when the windows are looked up
+    m_mirror.reserve(windows.count());
+    for (WId window : windows.list()) {
+        addToMirror(window);
+    }
+    xcb_flush(QX11Info::connection());
+}
+
+void NETEventFilter::addToMirror(WId window)
+{
+    MirroredWindow &mirrored = m_mirror[window];
+    mirrored.info = QExplicitlySharedDataPointer<KWindowInfoPrivateX11>(
+        new KWindowInfoPrivateX11(window, mirrorProperties, mirrorProperties2, KWindowInfoPrivateX11::Fetch::Deferred));
+    mirrored.dirtyProperties = NET::Properties();
+    mirrored.dirtyProperties2 = NET::Properties2();
+}
+
+KWindowInfoPrivate *NETEventFilter::mirroredWindowInfo(WId window, NET::Properties properties, NET::Properties2 properties2)
+{
+    // the mirror is only maintained in the main thread, s_mirroringFilter included
+    if (QThread::currentThread() != QCoreApplication::instance()->thread() || !s_mirroringFilter) {
+        return nullptr;
+    }
+    const auto it = s_mirroringFilter->m_mirror.find(window);
+    if (it == s_mirroringFilter->m_mirror.end() || !it->info->covers(properties, properties2)) {
+        return nullptr;
+    }
+    if (it->dirtyProperties || it->dirtyProperties2) {
+        if (it->info->ref.loadRelaxed() == 1) {
+            it->info->requestUpdate(it->dirtyProperties, it->dirtyProperties2);
+        } else {
+            // in use by a KWindowInfo, which must not change
+            it->info->readReplies();
+            it->info = QExplicitlySharedDataPointer<KWindowInfoPrivateX11>(new KWindowInfoPrivateX11(*it->info, it->dirtyProperties, it->dirtyProperties2));
+        }
+        it->dirtyProperties = NET::Properties();
+        it->dirtyProperties2 = NET::Properties2();
+    }
+    it->info->readReplies();
+    return it->info.data();
+}
+
+bool NETEventFilter::updateStackingOrder()
+{
+    const xcb_window_t *order = clientListStacking();
+    const int count = clientListStackingCount();
+    if (count == stackingOrder.count() && std::equal(order, order + count, stackingOrder.constBegin())) {
+        return false;
+    }
+
+    // a new list, the one handed out by KWindowSystem::stackingOrder() stays as it is
+    QList<WId> newOrder;
+    newOrder.reserve(count);
+    for (int i = 0; i < count; i++) {
+        newOrder.append(order[i]);
+    }
+    stackingOrder = newOrder;
+    ++stackingOrderGeneration;
+    return true;
+}
+
 void NETEventFilter::addClient(xcb_window_t w)
 {
+    // a changed client list usually adds many clients at once, e.g. when activating
+    // or restoring a session, they are registered together once the list is read
+    m_pendingClients.append(w);
+}
+
+void NETEventFilter::addPendingClients()
+{
+    if (m_pendingClients.isEmpty()) {
+        return;
+    }
     KWindowSystem *s_q = KWindowSystem::self();
+    xcb_connection_t *c = QX11Info::connection();
+    QVector<xcb_window_t> added;
+    added.swap(m_pendingClients);
 
     if ((what >= KWindowSystemPrivateX11::INFO_WINDOWS)) {
-        xcb_connection_t *c = QX11Info::connection();
-        QScopedPointer<xcb_get_window_attributes_reply_t, QScopedPointerPodDeleter> attr(
-            xcb_get_window_attributes_reply(c, xcb_get_window_attributes_unchecked(c, w), nullptr));
+        // send all requests before waiting for the first reply
+        QVector<xcb_get_window_attributes_cookie_t> cookies;
+        cookies.reserve(added.count());
+        for (xcb_window_t w : std::as_const(added)) {
+            cookies.append(xcb_get_window_attributes_unchecked(c, w));
+        }
+        for (int i = 0; i < added.count(); ++i) {
+            QScopedPointer<xcb_get_window_attributes_reply_t, QScopedPointerPodDeleter> attr(xcb_get_window_attributes_reply(c, cookies.at(i), nullptr));
 
-        uint32_t events = XCB_EVENT_MASK_PROPERTY_CHANGE | XCB_EVENT_MASK_STRUCTURE_NOTIFY;
-        if (!attr.isNull()) {
-            events = events | attr->your_event_mask;
+            uint32_t events = XCB_EVENT_MASK_PROPERTY_CHANGE | XCB_EVENT_MASK_STRUCTURE_NOTIFY;
+            if (!attr.isNull()) {
+                events = events | attr->your_event_mask;
+            }
+            xcb_change_window_attributes(c, added.at(i), XCB_CW_EVENT_MASK, &events);
         }
-        xcb_change_window_attributes(c, w, XCB_CW_EVENT_MASK, &events);
     }
 
-    bool emit_strutChanged = false;
-
-    if (strutSignalConnected) {
-        NETWinInfo info(QX11Info::connection(), w, QX11Info::appRootWindow(), NET::WMStrut | NET::WMDesktop, NET::Properties2());
-        NETStrut strut = info.strut();
-        if (strut.left || strut.top || strut.right || strut.bottom) {
-            strutWindows.append(StrutData(w, strut, info.desktop()));
-            emit_strutChanged = true;
+    // the struts are read only after selecting the property changes, so no change is missed;
+    // a receiver of the signals below may connect to strutChanged() meanwhile
+    const bool readStruts = strutSignalConnected;
+    std::vector<std::unique_ptr<NETWinInfo>> strutInfos;
+    if (readStruts) {
+        strutInfos.reserve(added.count());
+        for (xcb_window_t w : std::as_const(added)) {
+            strutInfos.emplace_back(new NETWinInfo(c, w, m_appRootWindow, NET::Properties(), NET::Properties2()));
+            NETWinInfoPrivateAccess::requestProperties(strutInfos.back().get(), NET::WMStrut | NET::WMDesktop, NET::WM2ExtendedStrut);
         }
-    } else {
-        possibleStrutWindows.append(w);
     }
 
-    windows.append(w);
-    Q_EMIT s_q->windowAdded(w);
-    if (emit_strutChanged) {
-        Q_EMIT s_q->strutChanged();
+    for (int i = 0; i < added.count(); ++i) {
+        const xcb_window_t w = added.at(i);
+        bool emit_strutChanged = false;
+
+        if (readStruts) {
+            NETWinInfo *info = strutInfos.at(i).get();
+            NETWinInfoPrivateAccess::readUpdateReplies(info);
+            if (hasStrut(*info)) {
+                addStrutWindow(StrutData(w, info->strut(), info->extendedStrut(), info->desktop()));
+                emit_strutChanged = true;
+            }
+        } else {
+            possibleStrutWindows.insert(w);
+        }
+
+        windows.append(w);
+        if (m_mirrorEnabled) {
+            addToMirror(w);
+        }
+        recordChange(w, KWindowChange::Added);
+        Q_EMIT s_q->windowAdded(w);
+        if (emit_strutChanged) {
+            Q_EMIT s_q->strutChanged();
+        }
     }
 }
 
@@ -383,15 +1010,23 @@ void NETEventFilter::removeClient(xcb_window_t w)
 
     bool emit_strutChanged = removeStrutWindow(w);
     if (strutSignalConnected && possibleStrutWindows.contains(w)) {
-        NETWinInfo info(QX11Info::connection(), w, QX11Info::appRootWindow(), NET::WMStrut, NET::Properties2());
-        NETStrut strut = info.strut();
-        if (strut.left || strut.top || strut.right || strut.bottom) {
+        NETWinInfo info(QX11Info::connection(), w, QX11Info::appRootWindow(), NET::WMStrut, NET::WM2ExtendedStrut);
+        if (hasStrut(info)) {
             emit_strutChanged = true;
         }
     }
 
-    possibleStrutWindows.removeAll(w);
-    windows.removeAll(w);
+    possibleStrutWindows.remove(w);
+    // no change notification after the removal
+    const auto pendingChange = m_pendingWindowChangeIndex.constFind(w);
+    if (pendingChange != m_pendingWindowChangeIndex.constEnd()) {
+        m_pendingWindowChanges[pendingChange.value()].window = XCB_WINDOW_NONE;
+        m_pendingWindowChangeIndex.erase(pendingChange);
+    }
+    windows.remove(w);
+    discardIcons(w);
+    m_mirror.remove(w);
+    recordChange(w, KWindowChange::Removed);
     Q_EMIT s_q->windowRemoved(w);
     if (emit_strutChanged) {
         Q_EMIT s_q->strutChanged();
@@ -480,6 +1115,18 @@ void KWindowSystemPrivateX11::connectNotify(const QMetaMethod &signal)
     if (!s_d->strutSignalConnected && signal == QMetaMethod::fromSignal(&KWindowSystem::strutChanged)) {
         s_d->strutSignalConnected = true;
     }
+    if (signal == QMetaMethod::fromSignal(&KWindowSystem::stackingOrderDelta)) {
+        s_d->stackingOrderDeltaConnected = true;
+    }
+}
+
+void KWindowSystemPrivateX11::disconnectNotify(const QMetaMethod &signal, bool connected)
+{
+    NETEventFilter *const s_d = s_d_func();
+    if (s_d && signal == QMetaMethod::fromSignal(&KWindowSystem::stackingOrderDelta)) {
+        // the deltas are only computed while somebody receives them
+        s_d->stackingOrderDeltaConnected = connected;
+    }
 }
 
 // WARNING
@@ -496,6 +1143,8 @@ void KWindowSystemPrivateX11::init(FilterInfo what)
 
     if (!s_d || s_d->what < what) {
         const bool wasCompositing = s_d ? s_d->compositingEnabled : false;
+        const quint64 stackingOrderGeneration = s_d ? s_d->stackingOrderGeneration : 0;
+        const bool stackingOrderDeltaConnected = s_d ? s_d->stackingOrderDeltaConnected : false;
         MainThreadInstantiator instantiator(what);
         NETEventFilter *filter;
         if (instantiator.thread() == QCoreApplication::instance()->thread()) {
@@ -509,17 +1158,74 @@ void KWindowSystemPrivateX11::init(FilterInfo what)
             QMetaObject::invokeMethod(&instantiator, "createNETEventFilter", Qt::BlockingQueuedConnection, Q_RETURN_ARG(NETEventFilter *, filter));
         }
         d.reset(filter);
+        // the generation has to keep increasing with the new filter
+        d->stackingOrderGeneration = stackingOrderGeneration;
+        d->stackingOrderDeltaConnected = stackingOrderDeltaConnected;
         d->activate();
+        // reads the state the main thread maintains, like createNETEventFilter()
+        NETEventFilter *const activated = d.data();
+        if (QThread::currentThread() == QCoreApplication::instance()->thread()) {
+            activated->publishSnapshot();
+        } else {
+            QMetaObject::invokeMethod(
+                QCoreApplication::instance(),
+                [activated] {
+                    activated->publishSnapshot();
+                },
+                Qt::BlockingQueuedConnection);
+        }
+        // the changes meanwhile weren't tracked, and activating added all windows again
+        if (s_journalEnabled.load(std::memory_order_acquire)) {
+            s_journal->invalidate();
+        }
         if (wasCompositing != s_d_func()->compositingEnabled) {
             Q_EMIT KWindowSystem::self()->compositingChanged(s_d_func()->compositingEnabled);
         }
     }
 }
 
+void KWindowSystemPrivateX11::setWindowInfoCacheEnabled(bool enabled)
+{
+    if (enabled) {
+        // the cache is updated from the per-window events
+        init(INFO_WINDOWS);
+    } else if (!s_d_func()) {
+        return;
+    }
+    auto apply = [this, enabled] {
+        s_d_func()->setMirrorEnabled(enabled);
+    };
+    if (QThread::currentThread() == QCoreApplication::instance()->thread()) {
+        apply();
+    } else {
+        QMetaObject::invokeMethod(QCoreApplication::instance(), apply, Qt::BlockingQueuedConnection);
+    }
+}
+
+void KWindowSystemPrivateX11::setWindowChangesCoalesced(bool coalesced)
+{
+    // windowChanged() needs the per-window information
+    init(INFO_WINDOWS);
+    auto apply = [this, coalesced] {
+        s_d_func()->setWindowChangesCoalesced(coalesced);
+    };
+    if (QThread::currentThread() == QCoreApplication::instance()->thread()) {
+        apply();
+    } else {
+        QMetaObject::invokeMethod(QCoreApplication::instance(), apply, Qt::BlockingQueuedConnection);
+    }
+}
+
 QList<WId> KWindowSystemPrivateX11::windows()
 {
     init(INFO_BASIC);
-    return s_d_func()->windows;
+    return s_d_func()->windows.list();
+}
+
+bool KWindowSystemPrivateX11::hasWId(WId window)
+{
+    init(INFO_BASIC);
+    return s_d_func()->windows.contains(window);
 }
 
 QList<WId> KWindowSystemPrivateX11::stackingOrder()
@@ -528,6 +1234,59 @@ QList<WId> KWindowSystemPrivateX11::stackingOrder()
     return s_d_func()->stackingOrder;
 }
 
+QExplicitlySharedDataPointer<const KWindowSystemSnapshotPrivate> KWindowSystemPrivateX11::snapshot()
+{
+    {
+        QMutexLocker locker(&s_snapshotMutex);
+        if (s_snapshot) {
+            return s_snapshot;
+        }
+    }
+    // the first one is published when starting to track the windows
+    init(INFO_BASIC);
+    QMutexLocker locker(&s_snapshotMutex);
+    return s_snapshot;
+}
+
+KWindowChanges KWindowSystemPrivateX11::changesSince(quint64 generation)
+{
+    // the property changes are only tracked with the per-window information
+    init(INFO_WINDOWS);
+    if (!s_journalEnabled.load(std::memory_order_acquire)) {
+        s_journal->enable();
+        s_journalEnabled.store(true, std::memory_order_release);
+    }
+    return s_journal->changesSince(generation);
+}
+
+void KWindowSystemPrivateX11::addChangeQueue(KWindowChangeQueuePrivate *queue)
+{
+    // the property changes are only tracked with the per-window information
+    init(INFO_WINDOWS);
+    QMutexLocker locker(&s_changeQueues->mutex);
+    if (!s_changeQueues->queues.contains(queue)) {
+        s_changeQueues->queues.append(queue);
+    }
+    s_changeQueues->active.store(true, std::memory_order_release);
+}
+
+void KWindowSystemPrivateX11::removeChangeQueue(KWindowChangeQueuePrivate *queue)
+{
+    if (!s_changeQueues.exists()) {
+        return;
+    }
+    // only waits for the main thread to finish pushing, never for its event loop
+    QMutexLocker locker(&s_changeQueues->mutex);
+    s_changeQueues->queues.removeAll(queue);
+    s_changeQueues->active.store(!s_changeQueues->queues.isEmpty(), std::memory_order_release);
+}
+
+quint64 KWindowSystemPrivateX11::stackingOrderGeneration()
+{
+    init(INFO_BASIC);
+    return s_d_func()->stackingOrderGeneration;
+}
+
 int KWindowSystemPrivateX11::currentDesktop()
 {
     if (!QX11Info::connection()) {
@@ -707,8 +1466,79 @@ WId KWindowSystemPrivateX11::groupLeader(WId win)
 
 QPixmap KWindowSystemPrivateX11::icon(WId win, int width, int height, bool scale, int flags)
 {
-    NETWinInfo info(QX11Info::connection(), win, QX11Info::appRootWindow(), NET::WMIcon, NET::WM2WindowClass | NET::WM2IconPixmap);
-    return iconFromNetWinInfo(width, height, scale, flags, &info);
+    // the caches are only used in the main thread, which maintains them
+    const bool mainThread = QThread::currentThread() == QCoreApplication::instance()->thread();
+    if (mainThread) {
+        checkIconTheme();
+    }
+    NETEventFilter *const s_d = s_d_func();
+    const bool cacheable = mainThread && s_d && s_d->what >= INFO_WINDOWS && s_d->windows.contains(win);
+    const IconCacheKey key = {win, width, height, scale, flags};
+    if (cacheable) {
+        if (const QPixmap *cached = s_d->iconCache.object(key)) {
+            return *cached;
+        }
+    }
+
+    // for a specific size it's cheaper to fetch just the matching icon of a large property than all of them
+    const bool fetchSingleIcon = (flags & KWindowSystem::NETWM) && width > 0 && height > 0;
+    NETWinInfo info(QX11Info::connection(),
+                    win,
+                    QX11Info::appRootWindow(),
+                    fetchSingleIcon ? NET::Properties() : NET::WMIcon,
+                    NET::WM2WindowClass | NET::WM2IconPixmap);
+    if (fetchSingleIcon) {
+        info.fetchIcon(width, height);
+    }
+    const QPixmap result = iconFromNetWinInfo(width, height, scale, flags, &info);
+    if (cacheable) {
+        s_d->cacheIcon(key, result);
+    }
+    return result;
+}
+
+QIcon KWindowSystemPrivateX11::themeIcon(const QString &name)
+{
+    if (QThread::currentThread() != QCoreApplication::instance()->thread()) {
+        return QIcon::fromTheme(name);
+    }
+    checkIconTheme();
+    auto it = m_themeIcons.constFind(name);
+    if (it == m_themeIcons.constEnd()) {
+        it = m_themeIcons.insert(name, QIcon::fromTheme(name));
+    }
+    return it.value();
+}
+
+void KWindowSystemPrivateX11::checkIconTheme()
+{
+    const QString theme = QIcon::themeName();
+    if (theme == m_iconTheme) {
+        return;
+    }
+    m_iconTheme = theme;
+    m_themeIcons.clear();
+    if (NETEventFilter *const s_d = s_d_func()) {
+        s_d->clearIcons();
+    }
+}
+
+// Smooth scaling and the raster pixmaps work on premultiplied pixels, convert the icon once
+static QImage toPremultiplied(const QImage &image)
+{
+    if (image.format() != QImage::Format_ARGB32) {
+        return image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    }
+    QImage result(image.size(), QImage::Format_ARGB32_Premultiplied);
+    if (result.isNull()) {
+        return result;
+    }
+    for (int y = 0; y < image.height(); ++y) {
+        KXUtils::PixelConversion::premultiply(reinterpret_cast<const uint32_t *>(image.constScanLine(y)),
+                                              reinterpret_cast<uint32_t *>(result.scanLine(y)),
+                                              image.width());
+    }
+    return result;
 }
 
 QPixmap KWindowSystemPrivateX11::iconFromNetWinInfo(int width, int height, bool scale, int flags, NETWinInfo *info)
@@ -718,9 +1548,9 @@ QPixmap KWindowSystemPrivateX11::iconFromNetWinInfo(int width, int height, bool
         return result;
     }
     if (flags & KWindowSystem::NETWM) {
-        NETIcon ni = info->icon(width, height);
-        if (ni.data && ni.size.width > 0 && ni.size.height > 0) {
-            QImage img((uchar *)ni.data, (int)ni.size.width, (int)ni.size.height, QImage::Format_ARGB32);
+        QImage img = info->iconImage(width, height);
+        if (!img.isNull()) {
+            img = toPremultiplied(img);
             if (scale && width > 0 && height > 0 && img.size() != QSize(width, height) && !img.isNull()) {
                 img = img.scaled(width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
             }
@@ -736,12 +1566,13 @@ QPixmap KWindowSystemPrivateX11::iconFromNetWinInfo(int width, int height, bool
         xcb_pixmap_t p_mask = info->icccmIconPixmapMask();
 
         if (p != XCB_PIXMAP_NONE) {
-            QPixmap pm = KXUtils::createPixmapFromHandle(info->xcbConnection(), p, p_mask);
-            if (scale && width > 0 && height > 0 && !pm.isNull() //
-                && (pm.width() != width || pm.height() != height)) {
-                result = QPixmap::fromImage(pm.toImage().scaled(width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
-            } else {
-                result = pm;
+            QImage img = KXUtils::createImageFromHandle(info->xcbConnection(), p, p_mask);
+            if (scale && width > 0 && height > 0 && !img.isNull() //
+                && (img.width() != width || img.height() != height)) {
+                img = img.scaled(width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+            }
+            if (!img.isNull()) {
+                result = QPixmap::fromImage(img);
             }
         }
     }
@@ -768,10 +1599,10 @@ QPixmap KWindowSystemPrivateX11::iconFromNetWinInfo(int width, int height, bool
         // Try to load the icon from the classhint if the app didn't specify
         // its own:
         if (result.isNull()) {
-            const QIcon icon = QIcon::fromTheme(QString::fromUtf8(info->windowClassClass()).toLower());
+            const QIcon icon = themeIcon(QString::fromUtf8(info->windowClassClass()).toLower());
             const QPixmap pm = icon.isNull() ? QPixmap() : icon.pixmap(iconWidth, iconWidth);
             if (scale && !pm.isNull()) {
-                result = QPixmap::fromImage(pm.toImage().scaled(width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
+                result = pm.scaled(width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
             } else {
                 result = pm;
             }
@@ -782,10 +1613,10 @@ QPixmap KWindowSystemPrivateX11::iconFromNetWinInfo(int width, int height, bool
         // If the icon is still a null pixmap, load the icon for X applications
         // as a last resort:
         if (result.isNull()) {
-            const QIcon icon = QIcon::fromTheme(QStringLiteral("xorg"));
+            const QIcon icon = themeIcon(QStringLiteral("xorg"));
             const QPixmap pm = icon.isNull() ? QPixmap() : icon.pixmap(iconWidth, iconWidth);
             if (scale && !pm.isNull()) {
-                result = QPixmap::fromImage(pm.toImage().scaled(width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
+                result = pm.scaled(width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
             } else {
                 result = pm;
             }
@@ -925,65 +1756,83 @@ QRect KWindowSystemPrivateX11::workArea(const QList<WId> &exclude, int desktop)
     init(INFO_WINDOWS); // invalidates s_d_func's return value
     NETEventFilter *const s_d = s_d_func();
 
-    QRect all = displayGeometry();
-    QRect a = all;
+    const QRect all = displayGeometry();
+    s_d->checkWorkAreasDisplayGeometry(all);
 
     if (desktop == -1) {
         desktop = s_d->currentDesktop();
     }
 
-    QList<WId>::ConstIterator it1;
-    for (it1 = s_d->windows.constBegin(); it1 != s_d->windows.constEnd(); ++it1) {
-        if (exclude.contains(*it1)) {
-            continue;
+    // Kicker (very) extensively calls this function, causing hundreds of roundtrips just
+    // to repeatedly find out struts of all windows. Therefore strut values for strut
+    // windows are cached, as are the resulting work areas.
+    s_d->resolvePossibleStrutWindows();
+
+    NETEventFilter::WorkAreaKey key{desktop, {}};
+    for (WId w : exclude) {
+        if (s_d->strutWindows.contains(w)) {
+            key.excludedStrutWindows.append(w);
         }
+    }
+    std::sort(key.excludedStrutWindows.begin(), key.excludedStrutWindows.end());
+    const auto cached = s_d->workAreas.constFind(key);
+    if (cached != s_d->workAreas.constEnd()) {
+        return cached.value();
+    }
 
-        // Kicker (very) extensively calls this function, causing hundreds of roundtrips just
-        // to repeatedly find out struts of all windows. Therefore strut values for strut
-        // windows are cached here.
-        NETStrut strut;
-        auto it2 = s_d->strutWindows.begin();
-        for (; it2 != s_d->strutWindows.end(); ++it2) {
-            if ((*it2).window == *it1) {
-                break;
-            }
+    QRect a = all;
+    for (const NETEventFilter::StrutData &data : std::as_const(s_d->strutWindows)) {
+        if (!(data.desktop == desktop || data.desktop == NETWinInfo::OnAllDesktops)) {
+            continue;
+        }
+        if (std::binary_search(key.excludedStrutWindows.constBegin(), key.excludedStrutWindows.constEnd(), data.window)) {
+            continue;
         }
+        a = a.intersected(strutArea(all, data.strut));
+    }
 
-        if (it2 != s_d->strutWindows.end()) {
-            if (!((*it2).desktop == desktop || (*it2).desktop == NETWinInfo::OnAllDesktops)) {
-                continue;
-            }
+    // the exclude lists vary little, but don't let odd callers grow it without limit
+    if (s_d->workAreas.count() >= 64) {
+        s_d->workAreas.clear();
+    }
+    s_d->workAreas.insert(key, a);
+    return a;
+}
 
-            strut = (*it2).strut;
-        } else if (s_d->possibleStrutWindows.contains(*it1)) {
-            NETWinInfo info(QX11Info::connection(), (*it1), QX11Info::appRootWindow(), NET::WMStrut | NET::WMDesktop, NET::Properties2());
-            strut = info.strut();
-            s_d->possibleStrutWindows.removeAll(*it1);
-            s_d->strutWindows.append(NETEventFilter::StrutData(*it1, info.strut(), info.desktop()));
+QRect KWindowSystemPrivateX11::screenWorkArea(QScreen *screen, int desktop)
+{
+    init(INFO_WINDOWS); // invalidates s_d_func's return value
+    NETEventFilter *const s_d = s_d_func();
 
-            if (!(info.desktop() == desktop || info.desktop() == NETWinInfo::OnAllDesktops)) {
-                continue;
-            }
-        } else {
-            continue; // not a strut window
-        }
+    const QRect all = displayGeometry();
+    s_d->checkWorkAreasDisplayGeometry(all);
 
-        QRect r = all;
-        if (strut.left > 0) {
-            r.setLeft(r.left() + (int)strut.left);
-        }
-        if (strut.top > 0) {
-            r.setTop(r.top() + (int)strut.top);
-        }
-        if (strut.right > 0) {
-            r.setRight(r.right() - (int)strut.right);
-        }
-        if (strut.bottom > 0) {
-            r.setBottom(r.bottom() - (int)strut.bottom);
+    if (desktop == -1) {
+        desktop = s_d->currentDesktop();
+    }
+
+    s_d->resolvePossibleStrutWindows();
+
+    // the struts are in native coordinates, like displayGeometry()
+    const QRect geometry = screen->geometry();
+    const NETEventFilter::ScreenWorkAreaKey key{desktop, QRect(geometry.topLeft(), geometry.size() * screen->devicePixelRatio())};
+    const auto cached = s_d->screenWorkAreas.constFind(key);
+    if (cached != s_d->screenWorkAreas.constEnd()) {
+        return cached.value();
+    }
+
+    QRect a = key.output;
+    for (const NETEventFilter::StrutData &data : std::as_const(s_d->strutWindows)) {
+        if (data.desktop == desktop || data.desktop == NETWinInfo::OnAllDesktops) {
+            a = a.intersected(extendedStrutArea(all, key.output, data));
         }
+    }
 
-        a = a.intersected(r);
+    // outputs which are gone are never asked for again
+    if (s_d->screenWorkAreas.count() >= 64) {
+        s_d->screenWorkAreas.clear();
     }
+    s_d->screenWorkAreas.insert(key, a);
     return a;
 }
 
@@ -7,14 +7,22 @@
 #ifndef KWINDOWSYSTEM_P_X11_H
 #define KWINDOWSYSTEM_P_X11_H
 
+#include "kwindowinfo_p_x11.h"
 #include "kwindowsystem_p.h"
 #include "netwm.h"
 
 #include <QAbstractNativeEventFilter>
+#include <QCache>
+#include <QContiguousCache>
+#include <QExplicitlySharedDataPointer>
+#include <QHash>
+#include <QIcon>
+#include <QMutex>
+#include <QSet>
 
 class NETEventFilter;
 
-class KWindowSystemPrivateX11 : public KWindowSystemPrivate
+class KWindowSystemPrivateX11 : public KWindowSystemPrivateV3
 {
 public:
     QList<WId> windows() override;
@@ -47,6 +55,8 @@ public:
     bool icccmCompliantMappingState() override;
     QRect workArea(int desktop) override;
     QRect workArea(const QList<WId> &excludes, int desktop) override;
+    QRect screenWorkArea(QScreen *screen, int desktop) override;
+    quint64 stackingOrderGeneration() override;
     QString desktopName(int desktop) override;
     void setDesktopName(int desktop, const QString &name) override;
     bool showingDesktop() override;
@@ -77,6 +87,15 @@ public:
     QPoint constrainViewportRelativePosition(const QPoint &pos) override;
 
     void connectNotify(const QMetaMethod &signal) override;
+    void disconnectNotify(const QMetaMethod &signal, bool connected) override;
+
+    void setWindowInfoCacheEnabled(bool enabled) override;
+    void setWindowChangesCoalesced(bool coalesced) override;
+    QExplicitlySharedDataPointer<const KWindowSystemSnapshotPrivate> snapshot() override;
+    KWindowChanges changesSince(quint64 generation) override;
+    void addChangeQueue(KWindowChangeQueuePrivate *queue) override;
+    void removeChangeQueue(KWindowChangeQueuePrivate *queue) override;
+    bool hasWId(WId window) override;
 
     enum FilterInfo {
         INFO_BASIC = 1, // desktop info, not per-window
@@ -89,7 +108,12 @@ private:
     {
         return d.data();
     }
+    QIcon themeIcon(const QString &name);
+    void checkIconTheme();
     QScopedPointer<NETEventFilter> d;
+    // theme icons by name, shared by all windows of a class
+    QHash<QString, QIcon> m_themeIcons;
+    QString m_iconTheme;
 };
 
 class MainThreadInstantiator : public QObject
@@ -104,28 +128,137 @@ private:
     KWindowSystemPrivateX11::FilterInfo m_what;
 };
 
+/**
+ * The client windows in the order they got added, with constant time lookup,
+ * insertion and removal. Removing leaves a hole in the ordered list, which gets
+ * compacted once the list is needed or too many holes accumulated.
+ */
+class ClientWindowList
+{
+public:
+    bool contains(WId window) const
+    {
+        return m_index.contains(window);
+    }
+    int count() const
+    {
+        return m_index.count();
+    }
+    void append(WId window);
+    void remove(WId window);
+    const QList<WId> &list() const;
+
+private:
+    void compact() const;
+
+    mutable QHash<WId, int> m_index; // position in m_list
+    mutable QList<WId> m_list; // XCB_WINDOW_NONE for removed windows
+    mutable int m_holes = 0;
+};
+
+/**
+ * The recent window changes, for KWindowSystem::changesSince(). Bounded, the
+ * oldest changes are dropped first. Shared by all event filters, thread-safe.
+ */
+class WindowChangeJournal
+{
+public:
+    WindowChangeJournal();
+    // allocates the entries, nothing is recorded before
+    void enable();
+    void record(WId window, KWindowChange::Kind kind, NET::Properties properties = NET::Properties(), NET::Properties2 properties2 = NET::Properties2());
+    // the changes recorded so far are incomplete, e.g. as they were not tracked
+    void invalidate();
+    KWindowChanges changesSince(quint64 generation) const;
+
+private:
+    struct Entry {
+        quint64 generation;
+        WId window;
+        KWindowChange::Kind kind;
+        NET::Properties properties;
+        NET::Properties2 properties2;
+    };
+    mutable QMutex m_mutex;
+    QContiguousCache<Entry> m_entries;
+    quint64 m_generation = 0;
+    // the changes after this generation are all known
+    quint64 m_completeSince = 0;
+};
+
+struct IconCacheKey {
+    WId window;
+    int width;
+    int height;
+    bool scale;
+    int flags;
+};
+
+inline bool operator==(const IconCacheKey &a, const IconCacheKey &b)
+{
+    return a.window == b.window && a.width == b.width && a.height == b.height && a.scale == b.scale && a.flags == b.flags;
+}
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+inline size_t qHash(const IconCacheKey &key, size_t seed = 0)
+#else
+inline uint qHash(const IconCacheKey &key, uint seed = 0)
+#endif
+{
+    return qHash(key.window, seed) ^ qHash((key.width << 16) ^ key.height, seed) ^ qHash((key.flags << 1) | int(key.scale), seed);
+}
+
 class NETEventFilter : public NETRootInfo, public QAbstractNativeEventFilter
 {
 public:
     NETEventFilter(KWindowSystemPrivateX11::FilterInfo _what);
     ~NETEventFilter() override;
     void activate();
-    QList<WId> windows;
+    ClientWindowList windows;
     QList<WId> stackingOrder;
+    // increased whenever stackingOrder changes
+    quint64 stackingOrderGeneration;
+    bool stackingOrderDeltaConnected;
 
     struct StrutData {
-        StrutData(WId window_, const NETStrut &strut_, int desktop_)
+        StrutData(WId window_, const NETStrut &strut_, const NETExtendedStrut &extendedStrut_, int desktop_)
             : window(window_)
             , strut(strut_)
+            , extendedStrut(extendedStrut_)
             , desktop(desktop_)
         {
         }
         WId window;
         NETStrut strut;
+        NETExtendedStrut extendedStrut;
         int desktop;
     };
-    QList<StrutData> strutWindows;
-    QList<WId> possibleStrutWindows;
+    // clients with a strut, and the ones whose strut is not known yet
+    QHash<WId, StrutData> strutWindows;
+    QSet<WId> possibleStrutWindows;
+    // fetches the struts of all possibleStrutWindows at once
+    void resolvePossibleStrutWindows();
+    // also applies the strut to the remembered work areas
+    void addStrutWindow(const StrutData &data);
+
+    // Work areas as computed by KWindowSystem::workArea(exclude, desktop), for the
+    // display geometry they were computed with. Added struts are applied to them,
+    // they are invalidated when a strut is removed or changed.
+    struct WorkAreaKey {
+        int desktop;
+        // only the excluded windows which have a strut matter, sorted
+        QVector<WId> excludedStrutWindows;
+    };
+    QHash<WorkAreaKey, QRect> workAreas;
+    // the same for KWindowSystem::screenWorkArea(), by the native geometry of the output
+    struct ScreenWorkAreaKey {
+        int desktop;
+        QRect output;
+    };
+    QHash<ScreenWorkAreaKey, QRect> screenWorkAreas;
+    QRect workAreasDisplayGeometry;
+    void invalidateWorkAreas();
+    void checkWorkAreasDisplayGeometry(const QRect &displayGeometry);
     bool strutSignalConnected;
     bool compositingEnabled;
     bool haveXfixes;
@@ -139,17 +272,98 @@ public:
     bool nativeEventFilter(const QByteArray &eventType, void *message, long *) override;
 #endif
 
-    void updateStackingOrder();
+    // returns whether the order changed
+    bool updateStackingOrder();
     bool removeStrutWindow(WId);
 
+    // Mirror of the commonly used properties of all clients, updated from the
+    // events, see KWindowSystem::setWindowInfoCacheEnabled()
+    void setMirrorEnabled(bool enabled);
+    static KWindowInfoPrivate *mirroredWindowInfo(WId window, NET::Properties properties, NET::Properties2 properties2);
+
+    // Icons as resolved by KWindowSystemPrivateX11::icon(), least recently used ones
+    // are dropped first. Only for clients, as only their icon changes are known.
+    QCache<IconCacheKey, QPixmap> iconCache;
+    void cacheIcon(const IconCacheKey &key, const QPixmap &icon);
+    void discardIcons(WId window);
+    void clearIcons();
+    // the keys of iconCache by window, may still list keys iconCache dropped already
+    QMultiHash<WId, IconCacheKey> iconCacheKeys;
+
+    // see KWindowSystem::setWindowChangesCoalesced()
+    void setWindowChangesCoalesced(bool coalesced);
+
+    void publishSnapshot();
+
 protected:
     void addClient(xcb_window_t) override;
     void removeClient(xcb_window_t) override;
 
 private:
     bool nativeEventFilter(xcb_generic_event_t *event);
+    void addToMirror(WId window);
+    // registers the clients collected by addClient(), with one roundtrip for all of them
+    void addPendingClients();
+    QVector<xcb_window_t> m_pendingClients;
+
+    // for changesSince() and the change queues
+    void recordChange(WId window, KWindowChange::Kind kind, NET::Properties properties = NET::Properties(), NET::Properties2 properties2 = NET::Properties2());
+    void emitWindowChanged(WId window, NET::Properties properties, NET::Properties2 properties2);
+    void emitPendingWindowChanges();
+    struct WindowChange {
+        WId window; // XCB_WINDOW_NONE when removed meanwhile
+        NET::Properties properties;
+        NET::Properties2 properties2;
+    };
+    bool m_coalesceWindowChanges;
+    QVector<WindowChange> m_pendingWindowChanges; // in the order of the first change
+    QHash<WId, int> m_pendingWindowChangeIndex;
+
+    // see KWindowSystem::snapshot(), published once the events processed together are handled
+    void scheduleSnapshot();
+    bool m_snapshotScheduled;
+
+    // receives the calls queued for after the current batch of events, which are dropped with it
+    QObject m_queuedCallsContext;
     xcb_window_t winId;
     xcb_window_t m_appRootWindow;
+    bool m_mirrorEnabled;
+    struct MirroredWindow {
+        QExplicitlySharedDataPointer<KWindowInfoPrivateX11> info;
+        // changed since info was fetched, refetched when it is looked up
+        NET::Properties dirtyProperties;
+        NET::Properties2 dirtyProperties2;
+    };
+    QHash<WId, MirroredWindow> m_mirror;
 };
 
+inline bool operator==(const NETEventFilter::WorkAreaKey &a, const NETEventFilter::WorkAreaKey &b)
+{
+    return a.desktop == b.desktop && a.excludedStrutWindows == b.excludedStrutWindows;
+}
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+inline size_t qHash(const NETEventFilter::WorkAreaKey &key, size_t seed = 0)
+#else
+inline uint qHash(const NETEventFilter::WorkAreaKey &key, uint seed = 0)
+#endif
+{
+    return qHash(key.desktop, seed) ^ qHash(key.excludedStrutWindows, seed);
+}
+
+inline bool operator==(const NETEventFilter::ScreenWorkAreaKey &a, const NETEventFilter::ScreenWorkAreaKey &b)
+{
+    return a.desktop == b.desktop && a.output == b.output;
+}
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+inline size_t qHash(const NETEventFilter::ScreenWorkAreaKey &key, size_t seed = 0)
+#else
+inline uint qHash(const NETEventFilter::ScreenWorkAreaKey &key, uint seed = 0)
+#endif
+{
+    const QRect &output = key.output;
+    return qHash(key.desktop, seed) ^ qHash((output.x() << 16) ^ output.y(), seed) ^ qHash((output.width() << 16) ^ output.height(), seed);
+}
+
 #endif
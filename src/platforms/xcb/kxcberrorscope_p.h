@@ -0,0 +1,106 @@
+/*
+    SPDX-FileCopyrightText: 2022 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-or-later
+*/
+
+#ifndef KXCBERRORSCOPE_P_H
+#define KXCBERRORSCOPE_P_H
+
+#include <xcb/xcb.h>
+
+#include <cstdlib>
+
+/**
+ * Collects the X errors of a group of xcb requests, like KXErrorHandler does for
+ * Xlib, but without a global error handler and without an XSync.
+ *
+ * The requests have to be sent checked, which for requests with a reply is the
+ * default of xcb. The error of a checked request is kept with its cookie instead
+ * of being delivered as an event, so the errors seen are exactly those of the
+ * requests read through the scope, no matter which other requests are pending,
+ * e.g. for other windows, or which thread reads the events meanwhile.
+ *
+ * @code
+ * KXcbErrorScope errors;
+ * auto geometry = errors.reply(c, xcb_get_geometry_reply, xcb_get_geometry(c, window));
+ * errors.check(c, xcb_map_window_checked(c, window));
+ * if (errors.hasBadWindow()) {
+ *     ...
+ * }
+ * @endcode
+ */
+class KXcbErrorScope
+{
+public:
+    /**
+     * Waits for the reply of @p cookie, read with @p replyFunction. Returns the reply,
+     * to be freed by the caller, or nullptr, in which case the error is recorded.
+     */
+    template<typename Reply, typename Cookie>
+    Reply *reply(xcb_connection_t *c, Reply *(*replyFunction)(xcb_connection_t *, Cookie, xcb_generic_error_t **), Cookie cookie)
+    {
+        xcb_generic_error_t *error = nullptr;
+        Reply *result = replyFunction(c, cookie, &error);
+        record(error);
+        return result;
+    }
+
+    /**
+     * Records the error of the request without a reply sent with @p cookie, from
+     * an xcb_*_checked() function. Unless a later request with a reply was read
+     * already, this waits for a roundtrip.
+     */
+    void check(xcb_connection_t *c, xcb_void_cookie_t cookie)
+    {
+        record(xcb_request_check(c, cookie));
+    }
+
+    /**
+     * Takes ownership of @p error, which may be nullptr.
+     */
+    void record(xcb_generic_error_t *error)
+    {
+        if (!error) {
+            return;
+        }
+        if (!m_errorCode) {
+            m_errorCode = error->error_code;
+        }
+        if (error->error_code == XCB_WINDOW) {
+            m_badWindow = true;
+        }
+        free(error);
+    }
+
+    /**
+     * Whether any of the requests failed.
+     */
+    bool hasError() const
+    {
+        return m_errorCode != 0;
+    }
+
+    /**
+     * Whether any of the requests failed with BadWindow, i.e. the window didn't
+     * exist (anymore).
+     */
+    bool hasBadWindow() const
+    {
+        return m_badWindow;
+    }
+
+    /**
+     * The error code of the first error, or 0.
+     */
+    uint8_t errorCode() const
+    {
+        return m_errorCode;
+    }
+
+private:
+    uint8_t m_errorCode = 0;
+    bool m_badWindow = false;
+};
+
+#endif
@@ -0,0 +1,299 @@
+/*
+    This file is part of the KDE libraries
+    SPDX-FileCopyrightText: 2022 KDE Contributors
+
+    SPDX-License-Identifier: LGPL-2.1-or-later
+*/
+
+#ifndef KXPIXELCONVERSION_P_H
+#define KXPIXELCONVERSION_P_H
+
+#include <QtGlobal>
+#include <qrgb.h>
+
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// AVX2 is picked at runtime, the library is not built for it
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define KXUTILS_HAVE_AVX2 1
+#define KXUTILS_AVX2_FUNCTION __attribute__((target("avx2")))
+#endif
+
+/**
+ * Pixel conversion kernels used when importing icons and pixmaps from the X server.
+ *
+ * All kernels work on 32 bit pixels in host byte order. The kernels in the Scalar, Sse2
+ * and Avx2 namespaces process any pixel count, the vector ones hand the tail to the
+ * scalar ones. The functions in PixelConversion itself pick the widest implementation
+ * the CPU supports.
+ *
+ * The kernels live in this header, as the code using them is built into the library
+ * as well as into the platform plugin.
+ */
+namespace KXUtils
+{
+namespace PixelConversion
+{
+namespace Scalar
+{
+/**
+ * Converts @p count pixels of a 30 bit deep (10 bits per channel) image in place
+ * into opaque 32 bit pixels.
+ */
+inline void convertRgb30(uint32_t *pixels, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        const uint32_t p = pixels[i];
+        pixels[i] = 0xff000000 | ((p >> 6) & 0xff0000) | ((p >> 4) & 0xff00) | ((p >> 2) & 0xff);
+    }
+}
+
+/**
+ * Sets the unused alpha byte of @p count pixels of a 24 bit deep image, which the
+ * X server leaves undefined.
+ */
+inline void setOpaque(uint32_t *pixels, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        pixels[i] |= 0xff000000;
+    }
+}
+
+/**
+ * Premultiplies @p count ARGB32 pixels from @p src into @p dst, with the same
+ * rounding as qPremultiply. @p src and @p dst may be the same.
+ */
+inline void premultiply(const uint32_t *src, uint32_t *dst, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        dst[i] = qPremultiply(src[i]);
+    }
+}
+
+/**
+ * Clears the premultiplied pixels whose bit in the least significant bit first
+ * @p mask is not set.
+ */
+inline void applyMask(uint32_t *pixels, const uchar *mask, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        if (!(mask[i >> 3] & (1 << (i & 7)))) {
+            pixels[i] = 0;
+        }
+    }
+}
+} // namespace Scalar
+
+#if defined(__SSE2__)
+namespace Sse2
+{
+inline void convertRgb30(uint32_t *pixels, int count)
+{
+    const __m128i redMask = _mm_set1_epi32(0x00ff0000);
+    const __m128i greenMask = _mm_set1_epi32(0x0000ff00);
+    const __m128i blueMask = _mm_set1_epi32(0x000000ff);
+    const __m128i alpha = _mm_set1_epi32(int(0xff000000));
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i *p = reinterpret_cast<__m128i *>(pixels + i);
+        const __m128i v = _mm_loadu_si128(p);
+        const __m128i r = _mm_and_si128(_mm_srli_epi32(v, 6), redMask);
+        const __m128i g = _mm_and_si128(_mm_srli_epi32(v, 4), greenMask);
+        const __m128i b = _mm_and_si128(_mm_srli_epi32(v, 2), blueMask);
+        _mm_storeu_si128(p, _mm_or_si128(_mm_or_si128(r, g), _mm_or_si128(b, alpha)));
+    }
+    Scalar::convertRgb30(pixels + i, count - i);
+}
+
+inline void setOpaque(uint32_t *pixels, int count)
+{
+    const __m128i alpha = _mm_set1_epi32(int(0xff000000));
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i *p = reinterpret_cast<__m128i *>(pixels + i);
+        _mm_storeu_si128(p, _mm_or_si128(_mm_loadu_si128(p), alpha));
+    }
+    Scalar::setOpaque(pixels + i, count - i);
+}
+
+// (c * a + ((c * a) >> 8) + 0x80) >> 8 per 16 bit channel, like qPremultiply
+inline __m128i premultiplyChannels(__m128i channels)
+{
+    const __m128i half = _mm_set1_epi16(0x80);
+    __m128i alpha = _mm_shufflelo_epi16(channels, _MM_SHUFFLE(3, 3, 3, 3));
+    alpha = _mm_shufflehi_epi16(alpha, _MM_SHUFFLE(3, 3, 3, 3));
+    channels = _mm_mullo_epi16(channels, alpha);
+    channels = _mm_add_epi16(_mm_add_epi16(channels, _mm_srli_epi16(channels, 8)), half);
+    return _mm_srli_epi16(channels, 8);
+}
+
+inline void premultiply(const uint32_t *src, uint32_t *dst, int count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alphaMask = _mm_set1_epi32(int(0xff000000));
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        const __m128i lo = premultiplyChannels(_mm_unpacklo_epi8(v, zero));
+        const __m128i hi = premultiplyChannels(_mm_unpackhi_epi8(v, zero));
+        const __m128i result = _mm_packus_epi16(lo, hi);
+        // keep the alpha channel itself
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_or_si128(_mm_andnot_si128(alphaMask, result), _mm_and_si128(alphaMask, v)));
+    }
+    Scalar::premultiply(src + i, dst + i, count - i);
+}
+
+inline void applyMask(uint32_t *pixels, const uchar *mask, int count)
+{
+    const __m128i bitsLo = _mm_set_epi32(8, 4, 2, 1);
+    const __m128i bitsHi = _mm_set_epi32(128, 64, 32, 16);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const uchar bits = mask[i >> 3];
+        if (bits == 0xff) {
+            continue;
+        }
+        const __m128i m = _mm_set1_epi32(bits);
+        __m128i *p = reinterpret_cast<__m128i *>(pixels + i);
+        _mm_storeu_si128(p, _mm_and_si128(_mm_loadu_si128(p), _mm_cmpeq_epi32(_mm_and_si128(m, bitsLo), bitsLo)));
+        _mm_storeu_si128(p + 1, _mm_and_si128(_mm_loadu_si128(p + 1), _mm_cmpeq_epi32(_mm_and_si128(m, bitsHi), bitsHi)));
+    }
+    Scalar::applyMask(pixels + i, mask + (i >> 3), count - i);
+}
+} // namespace Sse2
+#endif
+
+#if defined(KXUTILS_HAVE_AVX2)
+namespace Avx2
+{
+inline bool isSupported()
+{
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+
+KXUTILS_AVX2_FUNCTION inline void convertRgb30(uint32_t *pixels, int count)
+{
+    const __m256i redMask = _mm256_set1_epi32(0x00ff0000);
+    const __m256i greenMask = _mm256_set1_epi32(0x0000ff00);
+    const __m256i blueMask = _mm256_set1_epi32(0x000000ff);
+    const __m256i alpha = _mm256_set1_epi32(int(0xff000000));
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i *p = reinterpret_cast<__m256i *>(pixels + i);
+        const __m256i v = _mm256_loadu_si256(p);
+        const __m256i r = _mm256_and_si256(_mm256_srli_epi32(v, 6), redMask);
+        const __m256i g = _mm256_and_si256(_mm256_srli_epi32(v, 4), greenMask);
+        const __m256i b = _mm256_and_si256(_mm256_srli_epi32(v, 2), blueMask);
+        _mm256_storeu_si256(p, _mm256_or_si256(_mm256_or_si256(r, g), _mm256_or_si256(b, alpha)));
+    }
+    Scalar::convertRgb30(pixels + i, count - i);
+}
+
+KXUTILS_AVX2_FUNCTION inline void setOpaque(uint32_t *pixels, int count)
+{
+    const __m256i alpha = _mm256_set1_epi32(int(0xff000000));
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i *p = reinterpret_cast<__m256i *>(pixels + i);
+        _mm256_storeu_si256(p, _mm256_or_si256(_mm256_loadu_si256(p), alpha));
+    }
+    Scalar::setOpaque(pixels + i, count - i);
+}
+
+KXUTILS_AVX2_FUNCTION inline __m256i premultiplyChannels(__m256i channels)
+{
+    const __m256i half = _mm256_set1_epi16(0x80);
+    __m256i alpha = _mm256_shufflelo_epi16(channels, _MM_SHUFFLE(3, 3, 3, 3));
+    alpha = _mm256_shufflehi_epi16(alpha, _MM_SHUFFLE(3, 3, 3, 3));
+    channels = _mm256_mullo_epi16(channels, alpha);
+    channels = _mm256_add_epi16(_mm256_add_epi16(channels, _mm256_srli_epi16(channels, 8)), half);
+    return _mm256_srli_epi16(channels, 8);
+}
+
+KXUTILS_AVX2_FUNCTION inline void premultiply(const uint32_t *src, uint32_t *dst, int count)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alphaMask = _mm256_set1_epi32(int(0xff000000));
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        // unpacking and packing both work per 128 bit lane, so the pixel order is kept
+        const __m256i lo = premultiplyChannels(_mm256_unpacklo_epi8(v, zero));
+        const __m256i hi = premultiplyChannels(_mm256_unpackhi_epi8(v, zero));
+        const __m256i result = _mm256_packus_epi16(lo, hi);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i),
+                            _mm256_or_si256(_mm256_andnot_si256(alphaMask, result), _mm256_and_si256(alphaMask, v)));
+    }
+    Scalar::premultiply(src + i, dst + i, count - i);
+}
+
+KXUTILS_AVX2_FUNCTION inline void applyMask(uint32_t *pixels, const uchar *mask, int count)
+{
+    const __m256i bits = _mm256_set_epi32(128, 64, 32, 16, 8, 4, 2, 1);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const uchar m = mask[i >> 3];
+        if (m == 0xff) {
+            continue;
+        }
+        __m256i *p = reinterpret_cast<__m256i *>(pixels + i);
+        const __m256i keep = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(m), bits), bits);
+        _mm256_storeu_si256(p, _mm256_and_si256(_mm256_loadu_si256(p), keep));
+    }
+    Scalar::applyMask(pixels + i, mask + (i >> 3), count - i);
+}
+} // namespace Avx2
+#endif
+
+#if defined(KXUTILS_HAVE_AVX2) && defined(__SSE2__)
+#define KXUTILS_DISPATCH(function, ...)                                                                                                                        \
+    if (Avx2::isSupported()) {                                                                                                                                 \
+        Avx2::function(__VA_ARGS__);                                                                                                                           \
+    } else {                                                                                                                                                   \
+        Sse2::function(__VA_ARGS__);                                                                                                                           \
+    }
+#elif defined(KXUTILS_HAVE_AVX2)
+#define KXUTILS_DISPATCH(function, ...)                                                                                                                        \
+    if (Avx2::isSupported()) {                                                                                                                                 \
+        Avx2::function(__VA_ARGS__);                                                                                                                           \
+    } else {                                                                                                                                                   \
+        Scalar::function(__VA_ARGS__);                                                                                                                         \
+    }
+#elif defined(__SSE2__)
+#define KXUTILS_DISPATCH(function, ...) Sse2::function(__VA_ARGS__);
+#else
+#define KXUTILS_DISPATCH(function, ...) Scalar::function(__VA_ARGS__);
+#endif
+
+inline void convertRgb30(uint32_t *pixels, int count)
+{
+    KXUTILS_DISPATCH(convertRgb30, pixels, count)
+}
+
+inline void setOpaque(uint32_t *pixels, int count)
+{
+    KXUTILS_DISPATCH(setOpaque, pixels, count)
+}
+
+inline void premultiply(const uint32_t *src, uint32_t *dst, int count)
+{
+    KXUTILS_DISPATCH(premultiply, src, dst, count)
+}
+
+inline void applyMask(uint32_t *pixels, const uchar *mask, int count)
+{
+    KXUTILS_DISPATCH(applyMask, pixels, mask, count)
+}
+
+#undef KXUTILS_DISPATCH
+
+} // namespace PixelConversion
+} // namespace KXUtils
+
+#endif
@@ -7,8 +7,10 @@
 */
 
 #include "kwindowsystem_xcb_debug.h"
+#include "kxpixelconversion_p.h"
 #include "kxutils_p.h"
 #include <QBitmap>
+#include <QMutex>
 
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
 #include <private/qtx11extras_p.h>
@@ -17,68 +19,261 @@
 #endif
 
 #include <xcb/xcb.h>
+#if KWINDOWSYSTEM_HAVE_XCB_SHM
+#include <xcb/shm.h>
+
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#endif
+
+#include <cstring>
 
 namespace KXUtils
 {
-template<typename T>
-T fromNative(xcb_pixmap_t pixmap, xcb_connection_t *c)
+static QImage::Format formatForDepth(uint8_t depth)
 {
-    const xcb_get_geometry_cookie_t geoCookie = xcb_get_geometry_unchecked(c, pixmap);
-    ScopedCPointer<xcb_get_geometry_reply_t> geo(xcb_get_geometry_reply(c, geoCookie, nullptr));
-    if (geo.isNull()) {
-        // getting geometry for the pixmap failed
-        return T();
-    }
-
-    const xcb_get_image_cookie_t imageCookie = xcb_get_image_unchecked(c, XCB_IMAGE_FORMAT_Z_PIXMAP, pixmap, 0, 0, geo->width, geo->height, ~0);
-    ScopedCPointer<xcb_get_image_reply_t> xImage(xcb_get_image_reply(c, imageCookie, nullptr));
-    if (xImage.isNull()) {
-        // request for image data failed
-        return T();
-    }
-    QImage::Format format = QImage::Format_Invalid;
-    switch (xImage->depth) {
+    switch (depth) {
     case 1:
-        format = QImage::Format_MonoLSB;
-        break;
+        return QImage::Format_MonoLSB;
     case 16:
-        format = QImage::Format_RGB16;
-        break;
+        return QImage::Format_RGB16;
     case 24:
-        format = QImage::Format_RGB32;
-        break;
-    case 30: {
+        return QImage::Format_RGB32;
+    case 30:
         // Qt doesn't have a matching image format. We need to convert manually
-        uint32_t *pixels = reinterpret_cast<uint32_t *>(xcb_get_image_data(xImage.data()));
-        for (uint i = 0; i < xImage.data()->length; ++i) {
-            int r = (pixels[i] >> 22) & 0xff;
-            int g = (pixels[i] >> 12) & 0xff;
-            int b = (pixels[i] >> 2) & 0xff;
+    case 32:
+        return QImage::Format_ARGB32_Premultiplied;
+    default:
+        return QImage::Format_Invalid; // we don't know
+    }
+}
+
+#if KWINDOWSYSTEM_HAVE_XCB_SHM
+// below this the round trips for the segment cost more than going through the socket
+static const size_t s_shmThreshold = 16 * 1024;
+// an upload through the socket needs no round trip at all, unlike one through the segment
+static const size_t s_shmUploadThreshold = 128 * 1024;
+// large enough for a 256x256 icon, so the segment rarely has to grow
+static const size_t s_shmMinimumSize = 256 * 256 * 4;
+
+namespace
+{
+// One shared memory segment reused by all image transfers. The pixels get copied out
+// right after each transfer, the mutex serializes the users.
+class ShmSegment
+{
+public:
+    ~ShmSegment()
+    {
+        // the connection is likely gone at this point, the server drops the segment with it
+        release(false);
+    }
 
-            pixels[i] = qRgba(r, g, b, 0xff);
+    bool reserve(xcb_connection_t *c, size_t size);
+    void release(bool detach);
+
+    QMutex mutex;
+    xcb_connection_t *connection = nullptr;
+    xcb_shm_seg_t segment = 0;
+    uchar *data = nullptr;
+    size_t size = 0;
+    bool supported = false;
+};
+}
+
+Q_GLOBAL_STATIC(ShmSegment, s_shm)
+
+bool ShmSegment::reserve(xcb_connection_t *c, size_t needed)
+{
+    if (c != connection) {
+        release(false);
+        connection = c;
+        const xcb_query_extension_reply_t *extension = xcb_get_extension_data(c, &xcb_shm_id);
+        supported = extension && extension->present;
+    }
+    if (!supported) {
+        return false;
+    }
+    if (needed <= size) {
+        return true;
+    }
+    release(true);
+
+    const size_t newSize = qMax(needed, s_shmMinimumSize);
+    const int id = shmget(IPC_PRIVATE, newSize, IPC_CREAT | 0600);
+    if (id == -1) {
+        supported = false;
+        return false;
+    }
+    void *address = shmat(id, nullptr, 0);
+    if (address == reinterpret_cast<void *>(-1)) {
+        shmctl(id, IPC_RMID, nullptr);
+        supported = false;
+        return false;
+    }
+    const xcb_shm_seg_t newSegment = xcb_generate_id(c);
+    ScopedCPointer<xcb_generic_error_t> error(xcb_request_check(c, xcb_shm_attach_checked(c, newSegment, id, false)));
+    // once the server has attached it, the segment is gone when both sides detach
+    shmctl(id, IPC_RMID, nullptr);
+    if (!error.isNull()) {
+        // e.g. a remote display
+        qCDebug(LOG_KKEYSERVER_X11) << "Attaching the shared memory segment failed, error" << error->error_code;
+        shmdt(address);
+        supported = false;
+        return false;
+    }
+    segment = newSegment;
+    data = static_cast<uchar *>(address);
+    size = newSize;
+    return true;
+}
+
+void ShmSegment::release(bool detach)
+{
+    if (!data) {
+        return;
+    }
+    if (detach) {
+        xcb_shm_detach(connection, segment);
+    }
+    shmdt(data);
+    segment = 0;
+    data = nullptr;
+    size = 0;
+}
+
+static int bytesPerLine(xcb_connection_t *c, uint8_t depth, uint16_t width, QImage::Format format)
+{
+    const xcb_setup_t *setup = xcb_get_setup(c);
+    for (auto it = xcb_setup_pixmap_formats_iterator(setup); it.rem; xcb_format_next(&it)) {
+        if (it.data->depth != depth) {
+            continue;
         }
-        // fall through, Qt format is still Format_ARGB32_Premultiplied
-        Q_FALLTHROUGH();
+        if (it.data->bits_per_pixel != QImage::toPixelFormat(format).bitsPerPixel()) {
+            return 0;
+        }
+        const int pad = it.data->scanline_pad;
+        return (width * it.data->bits_per_pixel + pad - 1) / pad * pad / 8;
     }
-    case 32:
-        format = QImage::Format_ARGB32_Premultiplied;
-        break;
-    default:
-        return T(); // we don't know
+    return 0;
+}
+
+// Transfers the pixels through the shared segment instead of the socket
+static QImage getImageShm(xcb_connection_t *c, xcb_pixmap_t pixmap, const xcb_get_geometry_reply_t *geo, QImage::Format format)
+{
+    const int bpl = bytesPerLine(c, geo->depth, geo->width, format);
+    const size_t size = size_t(bpl) * geo->height;
+    if (bpl <= 0 || size < s_shmThreshold || qEnvironmentVariableIsSet("QT_X11_NO_MITSHM")) {
+        return QImage();
+    }
+    ShmSegment *shm = s_shm();
+    if (!shm) {
+        return QImage();
+    }
+    QMutexLocker locker(&shm->mutex);
+    if (!shm->reserve(c, size)) {
+        return QImage();
+    }
+    const xcb_shm_get_image_cookie_t cookie =
+        xcb_shm_get_image_unchecked(c, pixmap, 0, 0, geo->width, geo->height, ~0, XCB_IMAGE_FORMAT_Z_PIXMAP, shm->segment, 0);
+    ScopedCPointer<xcb_shm_get_image_reply_t> reply(xcb_shm_get_image_reply(c, cookie, nullptr));
+    if (reply.isNull() || reply->depth != geo->depth || reply->size < size) {
+        return QImage();
+    }
+    QImage image(geo->width, geo->height, format);
+    if (image.isNull()) {
+        return QImage();
+    }
+    const int rowBytes = qMin(bpl, int(image.bytesPerLine()));
+    for (int y = 0; y < geo->height; ++y) {
+        memcpy(image.scanLine(y), shm->data + y * bpl, rowBytes);
+    }
+    return image;
+}
+
+static bool putImageShm(xcb_connection_t *c, xcb_drawable_t drawable, xcb_gcontext_t gc, const QImage &image, uint8_t depth)
+{
+    const int bpl = bytesPerLine(c, depth, image.width(), image.format());
+    const size_t size = size_t(bpl) * image.height();
+    if (bpl <= 0 || size < s_shmUploadThreshold || qEnvironmentVariableIsSet("QT_X11_NO_MITSHM")) {
+        return false;
+    }
+    ShmSegment *shm = s_shm();
+    if (!shm) {
+        return false;
+    }
+    QMutexLocker locker(&shm->mutex);
+    if (!shm->reserve(c, size)) {
+        return false;
+    }
+    const int rowBytes = qMin(bpl, int(image.bytesPerLine()));
+    for (int y = 0; y < image.height(); ++y) {
+        memcpy(shm->data + y * bpl, image.constScanLine(y), rowBytes);
+    }
+    const uint16_t width = uint16_t(image.width());
+    const uint16_t height = uint16_t(image.height());
+    // waits until the server has read the segment, so it can be reused afterwards
+    const xcb_void_cookie_t cookie =
+        xcb_shm_put_image_checked(c, drawable, gc, width, height, 0, 0, width, height, 0, 0, depth, XCB_IMAGE_FORMAT_Z_PIXMAP, false, shm->segment, 0);
+    ScopedCPointer<xcb_generic_error_t> error(xcb_request_check(c, cookie));
+    return error.isNull();
+}
+#endif
+
+static QImage getImage(xcb_connection_t *c, xcb_pixmap_t pixmap, const xcb_get_geometry_reply_t *geo, QImage::Format format)
+{
+    const xcb_get_image_cookie_t imageCookie = xcb_get_image_unchecked(c, XCB_IMAGE_FORMAT_Z_PIXMAP, pixmap, 0, 0, geo->width, geo->height, ~0);
+    ScopedCPointer<xcb_get_image_reply_t> xImage(xcb_get_image_reply(c, imageCookie, nullptr));
+    if (xImage.isNull() || xImage->depth != geo->depth) {
+        // request for image data failed
+        return QImage();
     }
     QImage
         image(xcb_get_image_data(xImage.data()), geo->width, geo->height, xcb_get_image_data_length(xImage.data()) / geo->height, format, free, xImage.data());
     xImage.take();
+    return image;
+}
+
+static QImage fromNative(xcb_pixmap_t pixmap, xcb_connection_t *c)
+{
+    const xcb_get_geometry_cookie_t geoCookie = xcb_get_geometry_unchecked(c, pixmap);
+    ScopedCPointer<xcb_get_geometry_reply_t> geo(xcb_get_geometry_reply(c, geoCookie, nullptr));
+    if (geo.isNull() || geo->width == 0 || geo->height == 0) {
+        // getting geometry for the pixmap failed
+        return QImage();
+    }
+    const QImage::Format format = formatForDepth(geo->depth);
+    if (format == QImage::Format_Invalid) {
+        return QImage();
+    }
+
+    QImage image;
+#if KWINDOWSYSTEM_HAVE_XCB_SHM
+    image = getImageShm(c, pixmap, geo.data(), format);
+#endif
     if (image.isNull()) {
-        return T();
+        image = getImage(c, pixmap, geo.data(), format);
     }
-    if (image.format() == QImage::Format_MonoLSB) {
+    if (image.isNull()) {
+        return QImage();
+    }
+
+    switch (geo->depth) {
+    case 1:
         // work around an abort in QImage::color
         image.setColorCount(2);
         image.setColor(0, QColor(Qt::white).rgb());
         image.setColor(1, QColor(Qt::black).rgb());
+        break;
+    case 24:
+        // the server leaves the padding byte undefined, Qt expects it to be opaque
+        PixelConversion::setOpaque(reinterpret_cast<uint32_t *>(image.bits()), image.bytesPerLine() / 4 * image.height());
+        break;
+    case 30:
+        PixelConversion::convertRgb30(reinterpret_cast<uint32_t *>(image.bits()), image.bytesPerLine() / 4 * image.height());
+        break;
     }
-    return T::fromImage(image);
+    return image;
 }
 
 // Create QPixmap from X pixmap. Take care of different depths if needed.
@@ -88,26 +283,88 @@ QPixmap createPixmapFromHandle(WId pixmap, WId pixmap_mask)
 }
 
 QPixmap createPixmapFromHandle(xcb_connection_t *c, WId pixmap, WId pixmap_mask)
+{
+    const QImage image = createImageFromHandle(c, pixmap, pixmap_mask);
+    if (image.isNull()) {
+        return QPixmap();
+    }
+    return QPixmap::fromImage(image);
+}
+
+QImage createImageFromHandle(xcb_connection_t *c, WId pixmap, WId pixmap_mask)
 {
 #if Q_BYTE_ORDER == Q_BIG_ENDIAN
     qCDebug(LOG_KKEYSERVER_X11) << "Byte order not supported";
-    return QPixmap();
+    return QImage();
 #endif
     const xcb_setup_t *setup = xcb_get_setup(c);
     if (setup->image_byte_order != XCB_IMAGE_ORDER_LSB_FIRST) {
         qCDebug(LOG_KKEYSERVER_X11) << "Byte order not supported";
-        return QPixmap();
+        return QImage();
     }
 
-    QPixmap pix = fromNative<QPixmap>(pixmap, c);
-    if (pixmap_mask != XCB_PIXMAP_NONE) {
-        QBitmap mask = fromNative<QBitmap>(pixmap_mask, c);
-        if (mask.size() != pix.size()) {
-            return QPixmap();
-        }
-        pix.setMask(mask);
+    QImage image = fromNative(pixmap, c);
+    if (image.isNull() || pixmap_mask == XCB_PIXMAP_NONE) {
+        return image;
+    }
+    QImage mask = fromNative(pixmap_mask, c);
+    if (mask.size() != image.size()) {
+        return QImage();
+    }
+    if (mask.format() != QImage::Format_MonoLSB) {
+        // masks are bitmaps, anything else goes the slow way
+        mask = QBitmap::fromImage(mask).toImage().convertToFormat(QImage::Format_MonoLSB);
+    }
+
+    // the opaque RGB32 pixels already are valid premultiplied ones, other depths need a conversion
+    if (image.format() != QImage::Format_ARGB32_Premultiplied && !image.reinterpretAsFormat(QImage::Format_ARGB32_Premultiplied)) {
+        image = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    }
+    // like QPixmap::setMask, a set bit keeps the pixel
+    for (int y = 0; y < image.height(); ++y) {
+        PixelConversion::applyMask(reinterpret_cast<uint32_t *>(image.scanLine(y)), mask.constScanLine(y), image.width());
+    }
+    return image;
+}
+
+bool putImage(xcb_connection_t *c, xcb_drawable_t drawable, xcb_gcontext_t gc, const QImage &image, uint8_t depth)
+{
+    if (image.isNull()) {
+        return false;
+    }
+#if KWINDOWSYSTEM_HAVE_XCB_SHM
+    if (putImageShm(c, drawable, gc, image, depth)) {
+        return true;
+    }
+#endif
+    // the maximum length is in units of four bytes and already takes BIG-REQUESTS into account
+    const size_t maximumLength = size_t(xcb_get_maximum_request_length(c)) * 4;
+    if (maximumLength <= sizeof(xcb_put_image_request_t)) {
+        // the connection is broken
+        return false;
+    }
+    const int bpl = image.bytesPerLine();
+    const int rowsPerRequest = qMin(size_t(image.height()), (maximumLength - sizeof(xcb_put_image_request_t)) / bpl);
+    if (rowsPerRequest == 0) {
+        qCDebug(LOG_KKEYSERVER_X11) << "Image row too large for a request:" << bpl << "bytes";
+        return false;
+    }
+    for (int y = 0; y < image.height(); y += rowsPerRequest) {
+        const int rows = qMin(rowsPerRequest, image.height() - y);
+        xcb_put_image(c,
+                      XCB_IMAGE_FORMAT_Z_PIXMAP,
+                      drawable,
+                      gc,
+                      uint16_t(image.width()),
+                      uint16_t(rows),
+                      0,
+                      int16_t(y),
+                      0,
+                      depth,
+                      rows * bpl,
+                      image.constScanLine(y));
     }
-    return pix;
+    return true;
 }
 
 // Functions for X timestamp comparing. For Time being 32bit they're fairly simple
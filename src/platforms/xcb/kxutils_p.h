@@ -8,10 +8,13 @@
 #ifndef KXUTILS_H
 #define KXUTILS_H
 
+#include <QImage>
 #include <QPixmap>
 #include <QScopedPointer>
 #include <config-kwindowsystem.h>
 
+#include <cstdint>
+
 #if KWINDOWSYSTEM_HAVE_X11
 
 #include <kwindowsystem_export.h>
@@ -42,6 +45,23 @@ public:
 QPixmap createPixmapFromHandle(WId pixmap, WId mask = 0);
 QPixmap createPixmapFromHandle(xcb_connection_t *c, WId pixmap, WId mask = 0);
 
+/**
+ * Like createPixmapFromHandle(), but returns the pixels as a QImage, for callers which
+ * go on processing them. With a @p mask the image is in Format_ARGB32_Premultiplied.
+ * @since 5.96
+ */
+QImage createImageFromHandle(xcb_connection_t *c, WId pixmap, WId mask = 0);
+
+/**
+ * Uploads @p image to the top left corner of @p drawable, which has the given @p depth.
+ * Large images go through a shared memory segment if the server supports MIT-SHM,
+ * otherwise the image is split into as many requests as the maximum request length
+ * requires. The image data must match the server's format for the depth.
+ * Returns @c false if the image could not be uploaded.
+ * @since 5.96
+ */
+bool putImage(xcb_connection_t *c, uint32_t drawable, uint32_t gc, const QImage &image, uint8_t depth);
+
 /**
  * Compares two X timestamps, taking into account wrapping and 64bit architectures.
  * Return value is like with strcmp(), 0 for equal, -1 for time1 < time2, 1 for time1 > time2.
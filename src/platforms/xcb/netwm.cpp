@@ -17,6 +17,8 @@
 
 #include <QGuiApplication>
 #include <QHash>
+#include <QImage>
+#include <QScopedPointer>
 
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
 #include <private/qtx11extras_p.h>
@@ -59,20 +61,112 @@ static QSharedDataPointer<Atoms> atomsForConnection(xcb_connection_t *c)
     return it.value();
 }
 
+// like atomsForConnection, but without touching the reference count
+static const Atoms *constAtomsForConnection(xcb_connection_t *c)
+{
+    auto it = s_gAtomsHash->constFind(c);
+    if (it == s_gAtomsHash->constEnd()) {
+        return atomsForConnection(c).constData();
+    }
+    return it.value().constData();
+}
+
+static Atoms::Group atomGroup(KwsAtom atom)
+{
+    switch (atom) {
+    case UTF8_STRING:
+    case _NET_SUPPORTED:
+    case _NET_SUPPORTING_WM_CHECK:
+    case _NET_CLIENT_LIST:
+    case _NET_CLIENT_LIST_STACKING:
+    case _NET_NUMBER_OF_DESKTOPS:
+    case _NET_DESKTOP_GEOMETRY:
+    case _NET_DESKTOP_VIEWPORT:
+    case _NET_CURRENT_DESKTOP:
+    case _NET_DESKTOP_NAMES:
+    case _NET_ACTIVE_WINDOW:
+    case _NET_WORKAREA:
+    case _NET_VIRTUAL_ROOTS:
+    case _NET_DESKTOP_LAYOUT:
+    case _NET_SHOWING_DESKTOP:
+        return Atoms::RootGroup;
+    case _NET_CLOSE_WINDOW:
+    case _NET_RESTACK_WINDOW:
+    case _NET_WM_MOVERESIZE:
+    case _NET_MOVERESIZE_WINDOW:
+    case _NET_WM_ACTION_MOVE:
+    case _NET_WM_ACTION_RESIZE:
+    case _NET_WM_ACTION_MINIMIZE:
+    case _NET_WM_ACTION_SHADE:
+    case _NET_WM_ACTION_STICK:
+    case _NET_WM_ACTION_MAXIMIZE_VERT:
+    case _NET_WM_ACTION_MAXIMIZE_HORZ:
+    case _NET_WM_ACTION_FULLSCREEN:
+    case _NET_WM_ACTION_CHANGE_DESKTOP:
+    case _NET_WM_ACTION_CLOSE:
+    case WM_TAKE_FOCUS:
+    case WM_DELETE_WINDOW:
+    case _NET_WM_PING:
+    case _NET_WM_SYNC_REQUEST:
+    case _NET_WM_CONTEXT_HELP:
+    case _NET_WM_FULL_PLACEMENT:
+        return Atoms::WindowManagerGroup;
+    case _KDE_NET_WM_DESKTOP_FILE:
+    case _KDE_NET_WM_STATE_SKIP_SWITCHER:
+    case _KDE_NET_WM_FRAME_STRUT:
+    case _KDE_NET_WM_WINDOW_TYPE_OVERRIDE:
+    case _KDE_NET_WM_WINDOW_TYPE_TOPMENU:
+    case _KDE_NET_WM_WINDOW_TYPE_ON_SCREEN_DISPLAY:
+    case _KDE_NET_WM_WINDOW_TYPE_CRITICAL_NOTIFICATION:
+    case _KDE_NET_WM_TEMPORARY_RULES:
+    case _KDE_NET_WM_APPMENU_SERVICE_NAME:
+    case _KDE_NET_WM_APPMENU_OBJECT_PATH:
+    case _KDE_NET_WM_ACTIVITIES:
+    case _KDE_NET_WM_BLOCK_COMPOSITING:
+    case _KDE_NET_WM_SHADOW:
+        return Atoms::KdeGroup;
+    default:
+        return Atoms::ClientGroup;
+    }
+}
+
 Atoms::Atoms(xcb_connection_t *c)
     : QSharedData()
     , m_connection(c)
 {
     for (int i = 0; i < KwsAtomCount; ++i) {
+        m_atomGroups[i] = atomGroup(KwsAtom(i));
         m_atoms[i] = XCB_ATOM_NONE;
     }
-    init();
+}
+
+Atoms::Atoms(const Atoms &other)
+    : QSharedData()
+    , m_connection(other.m_connection)
+{
+    QMutexLocker locker(&other.m_mutex);
+    for (int i = 0; i < KwsAtomCount; ++i) {
+        m_atomGroups[i] = other.m_atomGroups[i];
+        m_atoms[i] = other.m_atoms[i];
+    }
+    for (int i = 0; i < GroupCount; ++i) {
+        m_dispatch[i] = other.m_dispatch[i];
+        m_interned[i].storeRelaxed(other.m_interned[i].loadRelaxed());
+    }
 }
 
 static const uint32_t netwm_sendevent_mask = (XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT | XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY);
 
 const long MAX_PROP_SIZE = 100000;
 
+// _NET_WM_ICON is read up to 16 MiB, anything bigger is either broken or abuses the
+// property for something else than icons, in 32 bit units
+const uint32_t MAX_ICON_PROP_SIZE = 16 * 1024 * 1024 / sizeof(uint32_t);
+// how many icons NETWinInfo::fetchIcon() looks at at most
+const int MAX_ICON_COUNT = 64;
+// what NETWinInfo::fetchIcon() fetches first, a property up to this size is used completely
+const uint32_t ICON_CHUNK_SIZE = 32 * 1024 / sizeof(uint32_t);
+
 static char *nstrdup(const char *s1)
 {
     if (!s1) {
@@ -110,6 +204,101 @@ static xcb_window_t *nwindup(const xcb_window_t *w1, int n)
     return w2;
 }
 
+NETStringArena::NETStringArena(const NETStringArena &)
+{
+}
+
+NETStringArena::~NETStringArena()
+{
+    while (m_block) {
+        Block *next = m_block->next;
+        ::operator delete(m_block);
+        m_block = next;
+    }
+}
+
+void NETStringArena::addBlock(int size)
+{
+    const int blockSize = qMax(size, int(MinBlockSize));
+    Block *block = static_cast<Block *>(::operator new(sizeof(Block) + blockSize));
+    block->next = m_block;
+    block->size = blockSize;
+    block->used = 0;
+    block->released = 0;
+    m_block = block;
+}
+
+char *NETStringArena::allocate(int size)
+{
+    if (!m_block || m_block->size - m_block->used < size) {
+        addBlock(size);
+    }
+    char *data = reinterpret_cast<char *>(m_block + 1) + m_block->used;
+    m_block->used += size;
+    return data;
+}
+
+const char *NETStringArena::copy(const char *str, int length)
+{
+    if (!str || length <= 0) {
+        return nullptr;
+    }
+    // like strncpy(), stops at an embedded null
+    length = qstrnlen(str, length);
+    if (length == 0) {
+        return nullptr;
+    }
+    char *data = allocate(length + 1);
+    memcpy(data, str, length);
+    data[length] = '\0';
+    return data;
+}
+
+const char *NETStringArena::copy(const char *str)
+{
+    if (!str) {
+        return nullptr;
+    }
+    const int size = strlen(str) + 1;
+    char *data = allocate(size);
+    memcpy(data, str, size);
+    return data;
+}
+
+void NETStringArena::release(const char *str)
+{
+    if (!str) {
+        return;
+    }
+    Block *previous = nullptr;
+    for (Block *block = m_block; block; previous = block, block = block->next) {
+        const char *data = reinterpret_cast<const char *>(block + 1);
+        if (str < data || str >= data + block->used) {
+            continue;
+        }
+        block->released += strlen(str) + 1;
+        if (block->released < block->used) {
+            return;
+        }
+        // no string in use points into the block anymore
+        if (block == m_block) {
+            block->used = 0;
+            block->released = 0;
+        } else {
+            previous->next = block->next;
+            ::operator delete(block);
+        }
+        return;
+    }
+}
+
+void NETWinInfoPrivate::setString(const char *&field, const char *value, int length)
+{
+    // the strings of the other fields stay where they are, the pointers returned for them remain valid
+    strings.release(field);
+    field = length < 0 ? strings.copy(value) : strings.copy(value, length);
+}
+
 static void refdec_nri(NETRootInfoPrivate *p)
 {
 #ifdef NETWMDEBUG
@@ -145,26 +334,20 @@ static void refdec_nwi(NETWinInfoPrivate *p)
         fprintf(stderr, "NET: \tno more references, deleting\n");
 #endif
 
-        delete[] p->name;
-        delete[] p->visible_name;
-        delete[] p->window_role;
-        delete[] p->icon_name;
-        delete[] p->visible_icon_name;
-        delete[] p->startup_id;
-        delete[] p->class_class;
-        delete[] p->class_name;
-        delete[] p->activities;
-        delete[] p->client_machine;
-        delete[] p->desktop_file;
-        delete[] p->gtk_application_id;
-        delete[] p->appmenu_object_path;
-        delete[] p->appmenu_service_name;
+        // the strings are freed with p->strings
 
         int i;
-        for (i = 0; i < p->icons.size(); i++) {
-            delete[] p->icons[i].data;
+        if (!p->icon_reply) {
+            for (i = 0; i < p->icons.size(); i++) {
+                delete[] p->icons[i].data;
+            }
         }
         delete[] p->icon_sizes;
+
+        // don't leave unread replies behind in the connection
+        for (i = 0; i < p->pending_count; i++) {
+            xcb_discard_reply(p->conn, p->pending_cookies[i].sequence);
+        }
     }
 }
 
@@ -260,6 +443,22 @@ static QList<QByteArray> get_stringlist_reply(xcb_connection_t *c, const xcb_get
     return list;
 }
 
+// like get_string_reply(), but stores the string right in the strings of @p p
+static void read_string_reply(NETWinInfoPrivate *p, const char *&field, const xcb_get_property_cookie_t cookie, xcb_atom_t type)
+{
+    xcb_get_property_reply_t *reply = xcb_get_property_reply(p->conn, cookie, nullptr);
+    const char *data = nullptr;
+    int len = 0;
+
+    if (reply && reply->type == type && reply->format == 8 && reply->value_len > 0) {
+        data = (const char *)xcb_get_property_value(reply);
+        len = reply->value_len;
+    }
+
+    p->setString(field, data, len);
+    free(reply);
+}
+
 #ifdef NETWMDEBUG
 static QByteArray get_atom_name(xcb_connection_t *c, xcb_atom_t atom)
 {
@@ -277,44 +476,179 @@ static QByteArray get_atom_name(xcb_connection_t *c, xcb_atom_t atom)
 }
 #endif
 
-void Atoms::init()
+// Which properties a PropertyNotify on the root window makes dirty
+static const struct {
+    KwsAtom atom;
+    NET::Properties properties;
+    NET::Properties2 properties2;
+} s_rootPropertyDirty[] = {
+    {_NET_CLIENT_LIST, NET::ClientList, {}},
+    {_NET_CLIENT_LIST_STACKING, NET::ClientListStacking, {}},
+    {_NET_DESKTOP_NAMES, NET::DesktopNames, {}},
+    {_NET_WORKAREA, NET::WorkArea, {}},
+    {_NET_NUMBER_OF_DESKTOPS, NET::NumberOfDesktops, {}},
+    {_NET_DESKTOP_GEOMETRY, NET::DesktopGeometry, {}},
+    {_NET_DESKTOP_VIEWPORT, NET::DesktopViewport, {}},
+    {_NET_CURRENT_DESKTOP, NET::CurrentDesktop, {}},
+    {_NET_ACTIVE_WINDOW, NET::ActiveWindow, {}},
+    {_NET_SHOWING_DESKTOP, {}, NET::WM2ShowingDesktop},
+    {_NET_SUPPORTED, NET::Supported, {}},
+    {_NET_SUPPORTING_WM_CHECK, NET::SupportingWMCheck, {}},
+    {_NET_VIRTUAL_ROOTS, NET::VirtualRoots, {}},
+    {_NET_DESKTOP_LAYOUT, {}, NET::WM2DesktopLayout},
+};
+
+// Which properties a PropertyNotify on a client window makes dirty
+static const struct {
+    KwsAtom atom;
+    NET::Properties properties;
+    NET::Properties2 properties2;
+} s_windowPropertyDirty[] = {
+    {_NET_WM_NAME, NET::WMName, {}},
+    {_NET_WM_VISIBLE_NAME, NET::WMVisibleName, {}},
+    {_NET_WM_DESKTOP, NET::WMDesktop, {}},
+    {_NET_WM_WINDOW_TYPE, NET::WMWindowType, {}},
+    {_NET_WM_STATE, NET::WMState, {}},
+    {_NET_WM_STRUT, NET::WMStrut, {}},
+    {_NET_WM_STRUT_PARTIAL, {}, NET::WM2ExtendedStrut},
+    {_NET_WM_ICON_GEOMETRY, NET::WMIconGeometry, {}},
+    {_NET_WM_ICON, NET::WMIcon, {}},
+    {_NET_WM_PID, NET::WMPid, {}},
+    {_NET_WM_HANDLED_ICONS, NET::WMHandledIcons, {}},
+    {_NET_STARTUP_ID, {}, NET::WM2StartupId},
+    {_NET_WM_WINDOW_OPACITY, {}, NET::WM2Opacity},
+    {_NET_WM_ALLOWED_ACTIONS, {}, NET::WM2AllowedActions},
+    {WM_STATE, NET::XAWMState, {}},
+    {_NET_FRAME_EXTENTS, NET::WMFrameExtents, {}},
+    {_KDE_NET_WM_FRAME_STRUT, NET::WMFrameExtents, {}},
+    {_NET_WM_FRAME_OVERLAP, {}, NET::WM2FrameOverlap},
+    {_NET_WM_ICON_NAME, NET::WMIconName, {}},
+    {_NET_WM_VISIBLE_ICON_NAME, NET::WMVisibleIconName, {}},
+    {_NET_WM_USER_TIME, {}, NET::WM2UserTime},
+    {WM_WINDOW_ROLE, {}, NET::WM2WindowRole},
+    {_KDE_NET_WM_ACTIVITIES, {}, NET::WM2Activities},
+    {_KDE_NET_WM_BLOCK_COMPOSITING, {}, NET::WM2BlockCompositing},
+    {_NET_WM_BYPASS_COMPOSITOR, {}, NET::WM2BlockCompositing},
+    {_KDE_NET_WM_SHADOW, {}, NET::WM2KDEShadow},
+    {WM_PROTOCOLS, {}, NET::WM2Protocols},
+    {_NET_WM_OPAQUE_REGION, {}, NET::WM2OpaqueRegion},
+    {_KDE_NET_WM_DESKTOP_FILE, {}, NET::WM2DesktopFileName},
+    {_GTK_APPLICATION_ID, {}, NET::WM2GTKApplicationId},
+    {_NET_WM_FULLSCREEN_MONITORS, {}, NET::WM2FullscreenMonitors},
+    {_GTK_FRAME_EXTENTS, {}, NET::WM2GTKFrameExtents},
+    {_KDE_NET_WM_APPMENU_SERVICE_NAME, {}, NET::WM2AppMenuServiceName},
+    {_KDE_NET_WM_APPMENU_OBJECT_PATH, {}, NET::WM2AppMenuObjectPath},
+};
+
+void Atoms::intern(Group group) const
 {
+    QMutexLocker locker(&m_mutex);
+    if (m_interned[group].loadRelaxed()) {
+        // another thread was faster
+        return;
+    }
+
 #define ENUM_CREATE_CHAR_ARRAY 1
 #include "atoms_p.h" // creates const char* array "KwsAtomStrings"
     // Send the intern atom requests
     xcb_intern_atom_cookie_t cookies[KwsAtomCount];
     for (int i = 0; i < KwsAtomCount; ++i) {
-        cookies[i] = xcb_intern_atom(m_connection, false, strlen(KwsAtomStrings[i]), KwsAtomStrings[i]);
+        if (m_atomGroups[i] == group) {
+            cookies[i] = xcb_intern_atom(m_connection, false, strlen(KwsAtomStrings[i]), KwsAtomStrings[i]);
+        }
     }
 
     // Get the replies
+    Dispatch &dispatch = m_dispatch[group];
     for (int i = 0; i < KwsAtomCount; ++i) {
+        if (m_atomGroups[i] != group) {
+            continue;
+        }
         xcb_intern_atom_reply_t *reply = xcb_intern_atom_reply(m_connection, cookies[i], nullptr);
         if (!reply) {
             continue;
         }
 
         m_atoms[i] = reply->atom;
+        if (reply->atom != XCB_ATOM_NONE) {
+            dispatch.kwsAtoms.insert(reply->atom, KwsAtom(i));
+        }
         free(reply);
     }
+
+    for (const auto &entry : s_rootPropertyDirty) {
+        if (m_atomGroups[entry.atom] == group && m_atoms[entry.atom] != XCB_ATOM_NONE) {
+            dispatch.rootProperties.insert(m_atoms[entry.atom], {entry.properties, entry.properties2});
+        }
+    }
+
+    if (group == ClientGroup) {
+        // predefined atoms from ICCCM
+        dispatch.windowProperties.insert(XCB_ATOM_WM_HINTS,
+                                         {NET::Properties(),
+                                          NET::WM2GroupLeader | NET::WM2Urgency | NET::WM2Input | NET::WM2InitialMappingState | NET::WM2IconPixmap});
+        dispatch.windowProperties.insert(XCB_ATOM_WM_TRANSIENT_FOR, {NET::Properties(), NET::WM2TransientFor});
+        dispatch.windowProperties.insert(XCB_ATOM_WM_CLASS, {NET::Properties(), NET::WM2WindowClass});
+        dispatch.windowProperties.insert(XCB_ATOM_WM_CLIENT_MACHINE, {NET::Properties(), NET::WM2ClientMachine});
+    }
+    for (const auto &entry : s_windowPropertyDirty) {
+        if (m_atomGroups[entry.atom] == group && m_atoms[entry.atom] != XCB_ATOM_NONE) {
+            dispatch.windowProperties.insert(m_atoms[entry.atom], {entry.properties, entry.properties2});
+        }
+    }
+
+    m_interned[group].storeRelease(1);
 }
 
-static void readIcon(xcb_connection_t *c, const xcb_get_property_cookie_t cookie, NETRArray<NETIcon> &icons, int &icon_count)
+KwsAtom Atoms::kwsAtom(xcb_atom_t atom) const
 {
-#ifdef NETWMDEBUG
-    fprintf(stderr, "NET: readIcon\n");
-#endif
+    for (int group = 0; group < GroupCount; ++group) {
+        ensureInterned(Group(group));
+        auto it = m_dispatch[group].kwsAtoms.constFind(atom);
+        if (it != m_dispatch[group].kwsAtoms.constEnd()) {
+            return it.value();
+        }
+    }
+    return KwsAtomCount;
+}
 
-    // reset
-    for (int i = 0; i < icons.size(); i++) {
-        delete[] icons[i].data;
+Atoms::Dirty Atoms::rootPropertyDirty(xcb_atom_t atom) const
+{
+    // all root window properties are in the root group
+    ensureInterned(RootGroup);
+    return m_dispatch[RootGroup].rootProperties.value(atom);
+}
+
+Atoms::Dirty Atoms::windowPropertyDirty(xcb_atom_t atom) const
+{
+    // client window properties are in the client group, or KDE extensions
+    for (Group group : {ClientGroup, KdeGroup}) {
+        ensureInterned(group);
+        auto it = m_dispatch[group].windowProperties.constFind(atom);
+        if (it != m_dispatch[group].windowProperties.constEnd()) {
+            return it.value();
+        }
     }
+    return Dirty();
+}
+
+// Frees the icons, unless their data belongs to @p icon_reply
+static void clearIcons(NETRArray<NETIcon> &icons, int &icon_count, QSharedPointer<xcb_get_property_reply_t> &icon_reply)
+{
+    if (!icon_reply) {
+        for (int i = 0; i < icons.size(); i++) {
+            delete[] icons[i].data;
+        }
+    }
+    icon_reply.reset();
 
     icons.reset();
     icon_count = 0;
+}
 
-    xcb_get_property_reply_t *reply = xcb_get_property_reply(c, cookie, nullptr);
-
+// takes ownership of reply, the icons have to be cleared before
+static void readIconReply(xcb_get_property_reply_t *reply, NETRArray<NETIcon> &icons, int &icon_count, QSharedPointer<xcb_get_property_reply_t> &icon_reply)
+{
     if (!reply || reply->value_len < 3 || reply->format != 32 || reply->type != XCB_ATOM_CARDINAL) {
         if (reply) {
             free(reply);
@@ -325,10 +659,25 @@ static void readIcon(xcb_connection_t *c, const xcb_get_property_cookie_t cookie
 
     uint32_t *data = (uint32_t *)xcb_get_property_value(reply);
 
+    // the icons point into the reply instead of copying their data out of it
+    icon_reply.reset(reply, free);
+
+    // count first, so that the array is allocated just once
+    int count = 0;
+    for (unsigned int j = 0; j < reply->value_len - 2;) {
+        const uint32_t width = data[j++];
+        const uint32_t height = data[j++];
+        if (j + width * height > reply->value_len) {
+            break;
+        }
+        j += width * height;
+        count++;
+    }
+    icons.reserve(count);
+
     for (unsigned int i = 0, j = 0; j < reply->value_len - 2; i++) {
         uint32_t width = data[j++];
         uint32_t height = data[j++];
-        uint32_t size = width * height * sizeof(uint32_t);
         if (j + width * height > reply->value_len) {
             fprintf(stderr, "Ill-encoded icon data; proposed size leads to out of bounds access. Skipping. (%d x %d)\n", width, height);
             break;
@@ -341,15 +690,27 @@ static void readIcon(xcb_connection_t *c, const xcb_get_property_cookie_t cookie
 
         icons[i].size.width = width;
         icons[i].size.height = height;
-        icons[i].data = new unsigned char[size];
-
-        memcpy((void *)icons[i].data, (const void *)&data[j], size);
+        icons[i].data = reinterpret_cast<unsigned char *>(&data[j]);
 
         j += width * height;
         icon_count++;
     }
+}
 
-    free(reply);
+static void readIcon(xcb_connection_t *c,
+                     const xcb_get_property_cookie_t cookie,
+                     NETRArray<NETIcon> &icons,
+                     int &icon_count,
+                     QSharedPointer<xcb_get_property_reply_t> &icon_reply)
+{
+#ifdef NETWMDEBUG
+    fprintf(stderr, "NET: readIcon\n");
+#endif
+
+    // reset
+    clearIcons(icons, icon_count, icon_reply);
+
+    readIconReply(xcb_get_property_reply(c, cookie, nullptr), icons, icon_count, icon_reply);
 
 #ifdef NETWMDEBUG
     fprintf(stderr, "NET: readIcon got %d icons\n", icon_count);
@@ -380,6 +741,15 @@ NETRArray<Z>::NETRArray()
     d = (Z *)calloc(capacity, sizeof(Z)); // allocate 2 elts and set to zero
 }
 
+template<class Z>
+NETRArray<Z>::NETRArray(const NETRArray<Z> &other)
+    : sz(other.sz)
+    , capacity(other.capacity)
+{
+    d = (Z *)malloc(sizeof(Z) * capacity);
+    memcpy((void *)d, (const void *)other.d, sizeof(Z) * capacity);
+}
+
 template<class Z>
 NETRArray<Z>::~NETRArray()
 {
@@ -395,6 +765,16 @@ void NETRArray<Z>::reset()
     memset((void *)d, 0, sizeof(Z) * capacity);
 }
 
+template<class Z>
+void NETRArray<Z>::reserve(int count)
+{
+    if (count > capacity) {
+        d = (Z *)realloc(d, sizeof(Z) * count);
+        memset((void *)&d[capacity], 0, sizeof(Z) * (count - capacity));
+        capacity = count;
+    }
+}
+
 template<class Z>
 Z &NETRArray<Z>::operator[](int index)
 {
@@ -1670,7 +2050,8 @@ void NETRootInfo::event(xcb_generic_event_t *event, NET::Properties *properties,
         fprintf(stderr, "NETRootInfo::event: handling ClientMessage event\n");
 #endif
 
-        if (message->type == p->atom(_NET_NUMBER_OF_DESKTOPS)) {
+        switch (p->atomTable()->kwsAtom(message->type)) {
+        case _NET_NUMBER_OF_DESKTOPS: {
             dirty = NumberOfDesktops;
 
 #ifdef NETWMDEBUG
@@ -1678,7 +2059,9 @@ void NETRootInfo::event(xcb_generic_event_t *event, NET::Properties *properties,
 #endif
 
             changeNumberOfDesktops(message->data.data32[0]);
-        } else if (message->type == p->atom(_NET_DESKTOP_GEOMETRY)) {
+            break;
+        }
+        case _NET_DESKTOP_GEOMETRY: {
             dirty = DesktopGeometry;
 
             NETSize sz;
@@ -1690,7 +2073,9 @@ void NETRootInfo::event(xcb_generic_event_t *event, NET::Properties *properties,
 #endif
 
             changeDesktopGeometry(~0, sz);
-        } else if (message->type == p->atom(_NET_DESKTOP_VIEWPORT)) {
+            break;
+        }
+        case _NET_DESKTOP_VIEWPORT: {
             dirty = DesktopViewport;
 
             NETPoint pt;
@@ -1702,7 +2087,9 @@ void NETRootInfo::event(xcb_generic_event_t *event, NET::Properties *properties,
 #endif
 
             changeDesktopViewport(p->current_desktop, pt);
-        } else if (message->type == p->atom(_NET_CURRENT_DESKTOP)) {
+            break;
+        }
+        case _NET_CURRENT_DESKTOP: {
             dirty = CurrentDesktop;
 
 #ifdef NETWMDEBUG
@@ -1710,7 +2097,9 @@ void NETRootInfo::event(xcb_generic_event_t *event, NET::Properties *properties,
 #endif
 
             changeCurrentDesktop(message->data.data32[0] + 1);
-        } else if (message->type == p->atom(_NET_ACTIVE_WINDOW)) {
+            break;
+        }
+        case _NET_ACTIVE_WINDOW: {
             dirty = ActiveWindow;
 
 #ifdef NETWMDEBUG
@@ -1727,7 +2116,9 @@ void NETRootInfo::event(xcb_generic_event_t *event, NET::Properties *properties,
                 active_window = message->data.data32[2];
             }
             changeActiveWindow(message->window, src, timestamp, active_window);
-        } else if (message->type == p->atom(_NET_WM_MOVERESIZE)) {
+            break;
+        }
+        case _NET_WM_MOVERESIZE: {
 #ifdef NETWMDEBUG
             fprintf(stderr,
                     "NETRootInfo::event: moveResize(%ld, %ld, %ld, %ld)\n",
@@ -1738,7 +2129,9 @@ void NETRootInfo::event(xcb_generic_event_t *event, NET::Properties *properties,
 #endif
 
             moveResize(message->window, message->data.data32[0], message->data.data32[1], message->data.data32[2]);
-        } else if (message->type == p->atom(_NET_MOVERESIZE_WINDOW)) {
+            break;
+        }
+        case _NET_MOVERESIZE_WINDOW: {
 #ifdef NETWMDEBUG
             fprintf(stderr,
                     "NETRootInfo::event: moveResizeWindow(%ld, %ld, %ld, %ld, %ld, %ld)\n",
@@ -1756,13 +2149,17 @@ void NETRootInfo::event(xcb_generic_event_t *event, NET::Properties *properties,
                              message->data.data32[2],
                              message->data.data32[3],
                              message->data.data32[4]);
-        } else if (message->type == p->atom(_NET_CLOSE_WINDOW)) {
+            break;
+        }
+        case _NET_CLOSE_WINDOW: {
 #ifdef NETWMDEBUG
             fprintf(stderr, "NETRootInfo::event: closeWindow(0x%lx)\n", message->window);
 #endif
 
             closeWindow(message->window);
-        } else if (message->type == p->atom(_NET_RESTACK_WINDOW)) {
+            break;
+        }
+        case _NET_RESTACK_WINDOW: {
 #ifdef NETWMDEBUG
             fprintf(stderr, "NETRootInfo::event: restackWindow(0x%lx)\n", message->window);
 #endif
@@ -1775,14 +2172,21 @@ void NETRootInfo::event(xcb_generic_event_t *event, NET::Properties *properties,
                 timestamp = message->data.data32[3];
             }
             restackWindow(message->window, src, message->data.data32[1], message->data.data32[2], timestamp);
-        } else if (message->type == p->atom(WM_PROTOCOLS) && (xcb_atom_t)message->data.data32[0] == p->atom(_NET_WM_PING)) {
+            break;
+        }
+        case WM_PROTOCOLS: {
+            if ((xcb_atom_t)message->data.data32[0] != p->atom(_NET_WM_PING)) {
+                break;
+            }
             dirty = WMPing;
 
 #ifdef NETWMDEBUG
             fprintf(stderr, "NETRootInfo::event: gotPing(0x%lx,%lu)\n", message->window, message->data.data32[1]);
 #endif
             gotPing(message->data.data32[2], message->data.data32[1]);
-        } else if (message->type == p->atom(_NET_SHOWING_DESKTOP)) {
+            break;
+        }
+        case _NET_SHOWING_DESKTOP: {
             dirty2 = WM2ShowingDesktop;
 
 #ifdef NETWMDEBUG
@@ -1790,6 +2194,10 @@ void NETRootInfo::event(xcb_generic_event_t *event, NET::Properties *properties,
 #endif
 
             changeShowingDesktop(message->data.data32[0]);
+            break;
+        }
+        default:
+            break;
         }
     }
 
@@ -1799,35 +2207,9 @@ void NETRootInfo::event(xcb_generic_event_t *event, NET::Properties *properties,
 #endif
 
         xcb_property_notify_event_t *pe = reinterpret_cast<xcb_property_notify_event_t *>(event);
-        if (pe->atom == p->atom(_NET_CLIENT_LIST)) {
-            dirty |= ClientList;
-        } else if (pe->atom == p->atom(_NET_CLIENT_LIST_STACKING)) {
-            dirty |= ClientListStacking;
-        } else if (pe->atom == p->atom(_NET_DESKTOP_NAMES)) {
-            dirty |= DesktopNames;
-        } else if (pe->atom == p->atom(_NET_WORKAREA)) {
-            dirty |= WorkArea;
-        } else if (pe->atom == p->atom(_NET_NUMBER_OF_DESKTOPS)) {
-            dirty |= NumberOfDesktops;
-        } else if (pe->atom == p->atom(_NET_DESKTOP_GEOMETRY)) {
-            dirty |= DesktopGeometry;
-        } else if (pe->atom == p->atom(_NET_DESKTOP_VIEWPORT)) {
-            dirty |= DesktopViewport;
-        } else if (pe->atom == p->atom(_NET_CURRENT_DESKTOP)) {
-            dirty |= CurrentDesktop;
-        } else if (pe->atom == p->atom(_NET_ACTIVE_WINDOW)) {
-            dirty |= ActiveWindow;
-        } else if (pe->atom == p->atom(_NET_SHOWING_DESKTOP)) {
-            dirty2 |= WM2ShowingDesktop;
-        } else if (pe->atom == p->atom(_NET_SUPPORTED)) {
-            dirty |= Supported; // update here?
-        } else if (pe->atom == p->atom(_NET_SUPPORTING_WM_CHECK)) {
-            dirty |= SupportingWMCheck;
-        } else if (pe->atom == p->atom(_NET_VIRTUAL_ROOTS)) {
-            dirty |= VirtualRoots;
-        } else if (pe->atom == p->atom(_NET_DESKTOP_LAYOUT)) {
-            dirty2 |= WM2DesktopLayout;
-        }
+        const Atoms::Dirty propertyDirty = p->atomTable()->rootPropertyDirty(pe->atom);
+        dirty |= propertyDirty.properties;
+        dirty2 |= propertyDirty.properties2;
 
         do_update = true;
     }
@@ -2624,6 +3006,47 @@ NETWinInfo::~NETWinInfo()
     }
 }
 
+void NETWinInfo::detach()
+{
+    if (p->ref == 1) {
+        return;
+    }
+    if (p->pending_count > 0) {
+        readUpdateReplies();
+    }
+
+    NETWinInfoPrivate *copy = new NETWinInfoPrivate(*p);
+    copy->ref = 1;
+    copy->name = copy->strings.copy(p->name);
+    copy->visible_name = copy->strings.copy(p->visible_name);
+    copy->icon_name = copy->strings.copy(p->icon_name);
+    copy->visible_icon_name = copy->strings.copy(p->visible_icon_name);
+    copy->startup_id = copy->strings.copy(p->startup_id);
+    copy->class_class = copy->strings.copy(p->class_class);
+    copy->class_name = copy->strings.copy(p->class_name);
+    copy->window_role = copy->strings.copy(p->window_role);
+    copy->client_machine = copy->strings.copy(p->client_machine);
+    copy->desktop_file = copy->strings.copy(p->desktop_file);
+    copy->appmenu_object_path = copy->strings.copy(p->appmenu_object_path);
+    copy->appmenu_service_name = copy->strings.copy(p->appmenu_service_name);
+    copy->gtk_application_id = copy->strings.copy(p->gtk_application_id);
+    copy->activities = copy->strings.copy(p->activities);
+    // icons backed by a reply share it, only owned data needs copying
+    for (int i = 0; !copy->icon_reply && i < copy->icons.size(); i++) {
+        NETIcon &icon = copy->icons[i];
+        if (icon.data) {
+            const int size = icon.size.width * icon.size.height * sizeof(uint32_t);
+            unsigned char *data = new unsigned char[size];
+            memcpy(data, icon.data, size);
+            icon.data = data;
+        }
+    }
+    copy->icon_sizes = nullptr;
+
+    refdec_nwi(p);
+    p = copy;
+}
+
 // assignment operator
 
 const NETWinInfo &NETWinInfo::operator=(const NETWinInfo &wininfo)
@@ -2658,15 +3081,16 @@ void NETWinInfo::setIconInternal(NETRArray<NETIcon> &icons, int &icon_count, xcb
     }
 
     if (replace) {
-        for (int i = 0; i < icons.size(); i++) {
-            delete[] icons[i].data;
-
-            icons[i].data = nullptr;
-            icons[i].size.width = 0;
-            icons[i].size.height = 0;
+        clearIcons(icons, icon_count, p->icon_reply);
+    } else if (p->icon_reply) {
+        // the icons are going to be mixed with one of our own, so they need to own their data
+        for (int i = 0; i < icon_count; i++) {
+            const int sz = icons[i].size.width * icons[i].size.height;
+            uint32_t *d = new uint32_t[sz];
+            memcpy(d, icons[i].data, sz * sizeof(uint32_t));
+            icons[i].data = (unsigned char *)d;
         }
-
-        icon_count = 0;
+        p->icon_reply.reset();
     }
 
     // assign icon
@@ -3160,8 +3584,7 @@ void NETWinInfo::setName(const char *name)
         return;
     }
 
-    delete[] p->name;
-    p->name = nstrdup(name);
+    p->setString(p->name, name);
 
     if (p->name[0] != '\0') {
         xcb_change_property(p->conn, XCB_PROP_MODE_REPLACE, p->window, p->atom(_NET_WM_NAME), p->atom(UTF8_STRING), 8, strlen(p->name), (const void *)p->name);
@@ -3176,8 +3599,7 @@ void NETWinInfo::setVisibleName(const char *visibleName)
         return;
     }
 
-    delete[] p->visible_name;
-    p->visible_name = nstrdup(visibleName);
+    p->setString(p->visible_name, visibleName);
 
     if (p->visible_name[0] != '\0') {
         xcb_change_property(p->conn,
@@ -3199,8 +3621,7 @@ void NETWinInfo::setIconName(const char *iconName)
         return;
     }
 
-    delete[] p->icon_name;
-    p->icon_name = nstrdup(iconName);
+    p->setString(p->icon_name, iconName);
 
     if (p->icon_name[0] != '\0') {
         xcb_change_property(p->conn,
@@ -3222,8 +3643,7 @@ void NETWinInfo::setVisibleIconName(const char *visibleIconName)
         return;
     }
 
-    delete[] p->visible_icon_name;
-    p->visible_icon_name = nstrdup(visibleIconName);
+    p->setString(p->visible_icon_name, visibleIconName);
 
     if (p->visible_icon_name[0] != '\0') {
         xcb_change_property(p->conn,
@@ -3301,8 +3721,7 @@ void NETWinInfo::setStartupId(const char *id)
         return;
     }
 
-    delete[] p->startup_id;
-    p->startup_id = nstrdup(id);
+    p->setString(p->startup_id, id);
 
     xcb_change_property(p->conn,
                         XCB_PROP_MODE_REPLACE,
@@ -3451,8 +3870,7 @@ void NETWinInfo::setAppMenuObjectPath(const char *name)
         return;
     }
 
-    delete[] p->appmenu_object_path;
-    p->appmenu_object_path = nstrdup(name);
+    p->setString(p->appmenu_object_path, name);
 
     xcb_change_property(p->conn,
                         XCB_PROP_MODE_REPLACE,
@@ -3470,8 +3888,7 @@ void NETWinInfo::setAppMenuServiceName(const char *name)
         return;
     }
 
-    delete[] p->appmenu_service_name;
-    p->appmenu_service_name = nstrdup(name);
+    p->setString(p->appmenu_service_name, name);
 
     xcb_change_property(p->conn,
                         XCB_PROP_MODE_REPLACE,
@@ -3534,6 +3951,125 @@ NETIcon NETWinInfo::icon(int width, int height) const
     return iconInternal(p->icons, p->icon_count, width, height);
 }
 
+void NETWinInfo::fetchIcon(int width, int height)
+{
+    clearIcons(p->icons, p->icon_count, p->icon_reply);
+    delete[] p->icon_sizes;
+    p->icon_sizes = nullptr;
+
+    // a small property is fetched completely by the first request and used like with
+    // WMIcon, only for a large one the headers are walked to pick a single icon
+    const xcb_atom_t atom = p->atom(_NET_WM_ICON);
+    const xcb_get_property_cookie_t firstCookie = xcb_get_property(p->conn, false, p->window, atom, XCB_ATOM_CARDINAL, 0, ICON_CHUNK_SIZE);
+    xcb_get_property_reply_t *first = xcb_get_property_reply(p->conn, firstCookie, nullptr);
+    if (!first || first->bytes_after == 0) {
+        readIconReply(first, p->icons, p->icon_count, p->icon_reply);
+        return;
+    }
+    const QSharedPointer<xcb_get_property_reply_t> firstReply(first, free);
+    if (first->format != 32 || first->type != XCB_ATOM_CARDINAL || first->value_len < 2) {
+        return;
+    }
+    uint32_t *firstData = reinterpret_cast<uint32_t *>(xcb_get_property_value(first));
+    const uint32_t firstLength = first->value_len;
+    const uint32_t length = qMin(uint64_t(first->value_len) + first->bytes_after / sizeof(uint32_t), uint64_t(MAX_ICON_PROP_SIZE));
+
+    // walk the width and height headers, each one tells where the next one is,
+    // only those beyond the first chunk cost a roundtrip
+    NETRArray<NETIcon> headers;
+    uint32_t offsets[MAX_ICON_COUNT];
+    int count = 0;
+    uint32_t offset = 0;
+    for (int i = 0; i < MAX_ICON_COUNT; ++i) {
+        uint32_t header[2];
+        if (offset + 2 <= firstLength) {
+            header[0] = firstData[offset];
+            header[1] = firstData[offset + 1];
+        } else {
+            const xcb_get_property_cookie_t cookie = xcb_get_property(p->conn, false, p->window, atom, XCB_ATOM_CARDINAL, offset, 2);
+            QScopedPointer<xcb_get_property_reply_t, QScopedPointerPodDeleter> reply(xcb_get_property_reply(p->conn, cookie, nullptr));
+            if (!reply || reply->format != 32 || reply->type != XCB_ATOM_CARDINAL || reply->value_len < 2) {
+                break;
+            }
+            const uint32_t *data = reinterpret_cast<uint32_t *>(xcb_get_property_value(reply.data()));
+            header[0] = data[0];
+            header[1] = data[1];
+        }
+
+        const uint64_t size = uint64_t(header[0]) * header[1];
+        if (offset + 2 + size > length) {
+            fprintf(stderr, "Ill-encoded icon data; proposed size leads to out of bounds access. Skipping. (%u x %u)\n", header[0], header[1]);
+            break;
+        }
+        if (size > 0) {
+            headers[count].size.width = header[0];
+            headers[count].size.height = header[1];
+            offsets[count] = offset + 2;
+            count++;
+        }
+        offset += 2 + size;
+        if (offset + 2 > length) {
+            break;
+        }
+    }
+    if (!count) {
+        return;
+    }
+
+    // fetch only the data of the icon icon() would pick
+    const NETIcon chosen = iconInternal(headers, count, width, height);
+    int index = 0;
+    while (headers[index].size.width != chosen.size.width || headers[index].size.height != chosen.size.height) {
+        index++;
+    }
+    const uint32_t size = chosen.size.width * chosen.size.height;
+    if (uint64_t(offsets[index]) + size <= firstLength) {
+        // in the first chunk already
+        p->icon_reply = firstReply;
+        p->icons[0].size = chosen.size;
+        p->icons[0].data = reinterpret_cast<unsigned char *>(firstData + offsets[index]);
+        p->icon_count = 1;
+        return;
+    }
+    const xcb_get_property_cookie_t cookie = xcb_get_property(p->conn, false, p->window, atom, XCB_ATOM_CARDINAL, offsets[index], size);
+    xcb_get_property_reply_t *reply = xcb_get_property_reply(p->conn, cookie, nullptr);
+    if (!reply || reply->format != 32 || reply->type != XCB_ATOM_CARDINAL || reply->value_len != size) {
+        // changed in between
+        free(reply);
+        return;
+    }
+
+    p->icon_reply.reset(reply, free);
+    p->icons[0].size = chosen.size;
+    p->icons[0].data = reinterpret_cast<unsigned char *>(xcb_get_property_value(reply));
+    p->icon_count = 1;
+}
+
+static void releaseIconReply(void *info)
+{
+    delete static_cast<QSharedPointer<xcb_get_property_reply_t> *>(info);
+}
+
+QImage NETWinInfo::iconImage(int width, int height) const
+{
+    const NETIcon icon = iconInternal(p->icons, p->icon_count, width, height);
+    if (!icon.data || icon.size.width <= 0 || icon.size.height <= 0) {
+        return QImage();
+    }
+    if (!p->icon_reply) {
+        // set by ourselves, the data goes away with the next setIcon()
+        return QImage(icon.data, icon.size.width, icon.size.height, QImage::Format_ARGB32).copy();
+    }
+    // read-only, so that writing to the image detaches it from the shared reply
+    const uchar *data = icon.data;
+    return QImage(data,
+                  icon.size.width,
+                  icon.size.height,
+                  QImage::Format_ARGB32,
+                  releaseIconReply,
+                  new QSharedPointer<xcb_get_property_reply_t>(p->icon_reply));
+}
+
 const int *NETWinInfo::iconSizes() const
 {
     if (p->icon_sizes == nullptr) {
@@ -3602,6 +4138,29 @@ NET::Properties NETWinInfo::event(xcb_generic_event_t *ev)
     return properties;
 }
 
+void NETWinInfo::dirtyProperties(xcb_connection_t *connection, xcb_generic_event_t *event, NET::Properties *properties, NET::Properties2 *properties2)
+{
+    NET::Properties dirty;
+    NET::Properties2 dirty2;
+    const uint8_t eventType = event->response_type & ~0x80;
+
+    if (eventType == XCB_PROPERTY_NOTIFY) {
+        xcb_property_notify_event_t *pe = reinterpret_cast<xcb_property_notify_event_t *>(event);
+        const Atoms::Dirty propertyDirty = constAtomsForConnection(connection)->windowPropertyDirty(pe->atom);
+        dirty = propertyDirty.properties;
+        dirty2 = propertyDirty.properties2;
+    } else if (eventType == XCB_CONFIGURE_NOTIFY) {
+        dirty = WMGeometry;
+    }
+
+    if (properties) {
+        *properties = dirty;
+    }
+    if (properties2) {
+        *properties2 = dirty2;
+    }
+}
+
 void NETWinInfo::event(xcb_generic_event_t *event, NET::Properties *properties, NET::Properties2 *properties2)
 {
     NET::Properties dirty;
@@ -3615,7 +4174,8 @@ void NETWinInfo::event(xcb_generic_event_t *event, NET::Properties *properties,
         fprintf(stderr, "NETWinInfo::event: handling ClientMessage event\n");
 #endif // NETWMDEBUG
 
-        if (message->type == p->atom(_NET_WM_STATE)) {
+        switch (p->atomTable()->kwsAtom(message->type)) {
+        case _NET_WM_STATE: {
             dirty = WMState;
 
             // we need to generate a change mask
@@ -3634,36 +4194,54 @@ void NETWinInfo::event(xcb_generic_event_t *event, NET::Properties *properties,
                 fprintf(stderr, "NETWinInfo::event:  message %ld '%s'\n", message->data.data32[i], ba.constData());
 #endif
 
-                if ((xcb_atom_t)message->data.data32[i] == p->atom(_NET_WM_STATE_MODAL)) {
+                switch (p->atomTable()->kwsAtom((xcb_atom_t)message->data.data32[i])) {
+                case _NET_WM_STATE_MODAL:
                     mask |= Modal;
-                } else if ((xcb_atom_t)message->data.data32[i] == p->atom(_NET_WM_STATE_STICKY)) {
+                    break;
+                case _NET_WM_STATE_STICKY:
                     mask |= Sticky;
-                } else if ((xcb_atom_t)message->data.data32[i] == p->atom(_NET_WM_STATE_MAXIMIZED_VERT)) {
+                    break;
+                case _NET_WM_STATE_MAXIMIZED_VERT:
                     mask |= MaxVert;
-                } else if ((xcb_atom_t)message->data.data32[i] == p->atom(_NET_WM_STATE_MAXIMIZED_HORZ)) {
+                    break;
+                case _NET_WM_STATE_MAXIMIZED_HORZ:
                     mask |= MaxHoriz;
-                } else if ((xcb_atom_t)message->data.data32[i] == p->atom(_NET_WM_STATE_SHADED)) {
+                    break;
+                case _NET_WM_STATE_SHADED:
                     mask |= Shaded;
-                } else if ((xcb_atom_t)message->data.data32[i] == p->atom(_NET_WM_STATE_SKIP_TASKBAR)) {
+                    break;
+                case _NET_WM_STATE_SKIP_TASKBAR:
                     mask |= SkipTaskbar;
-                } else if ((xcb_atom_t)message->data.data32[i] == p->atom(_NET_WM_STATE_SKIP_PAGER)) {
+                    break;
+                case _NET_WM_STATE_SKIP_PAGER:
                     mask |= SkipPager;
-                } else if ((xcb_atom_t)message->data.data32[i] == p->atom(_KDE_NET_WM_STATE_SKIP_SWITCHER)) {
+                    break;
+                case _KDE_NET_WM_STATE_SKIP_SWITCHER:
                     mask |= SkipSwitcher;
-                } else if ((xcb_atom_t)message->data.data32[i] == p->atom(_NET_WM_STATE_HIDDEN)) {
+                    break;
+                case _NET_WM_STATE_HIDDEN:
                     mask |= Hidden;
-                } else if ((xcb_atom_t)message->data.data32[i] == p->atom(_NET_WM_STATE_FULLSCREEN)) {
+                    break;
+                case _NET_WM_STATE_FULLSCREEN:
                     mask |= FullScreen;
-                } else if ((xcb_atom_t)message->data.data32[i] == p->atom(_NET_WM_STATE_ABOVE)) {
+                    break;
+                case _NET_WM_STATE_ABOVE:
                     mask |= KeepAbove;
-                } else if ((xcb_atom_t)message->data.data32[i] == p->atom(_NET_WM_STATE_BELOW)) {
+                    break;
+                case _NET_WM_STATE_BELOW:
                     mask |= KeepBelow;
-                } else if ((xcb_atom_t)message->data.data32[i] == p->atom(_NET_WM_STATE_DEMANDS_ATTENTION)) {
+                    break;
+                case _NET_WM_STATE_DEMANDS_ATTENTION:
                     mask |= DemandsAttention;
-                } else if ((xcb_atom_t)message->data.data32[i] == p->atom(_NET_WM_STATE_STAYS_ON_TOP)) {
+                    break;
+                case _NET_WM_STATE_STAYS_ON_TOP:
                     mask |= KeepAbove;
-                } else if ((xcb_atom_t)message->data.data32[i] == p->atom(_NET_WM_STATE_FOCUSED)) {
+                    break;
+                case _NET_WM_STATE_FOCUSED:
                     mask |= Focused;
+                    break;
+                default:
+                    break;
                 }
             }
 
@@ -3689,7 +4267,9 @@ void NETWinInfo::event(xcb_generic_event_t *event, NET::Properties *properties,
 #endif
 
             changeState(state, mask);
-        } else if (message->type == p->atom(_NET_WM_DESKTOP)) {
+            break;
+        }
+        case _NET_WM_DESKTOP: {
             dirty = WMDesktop;
 
             if (message->data.data32[0] == (unsigned)OnAllDesktops) {
@@ -3697,7 +4277,9 @@ void NETWinInfo::event(xcb_generic_event_t *event, NET::Properties *properties,
             } else {
                 changeDesktop(message->data.data32[0] + 1);
             }
-        } else if (message->type == p->atom(_NET_WM_FULLSCREEN_MONITORS)) {
+            break;
+        }
+        case _NET_WM_FULLSCREEN_MONITORS: {
             dirty2 = WM2FullscreenMonitors;
 
             NETFullscreenMonitors topology;
@@ -3717,6 +4299,10 @@ void NETWinInfo::event(xcb_generic_event_t *event, NET::Properties *properties,
                     message->data.data32[3]);
 #endif
             changeFullscreenMonitors(topology);
+            break;
+        }
+        default:
+            break;
         }
     }
 
@@ -3726,86 +4312,9 @@ void NETWinInfo::event(xcb_generic_event_t *event, NET::Properties *properties,
 #endif
 
         xcb_property_notify_event_t *pe = reinterpret_cast<xcb_property_notify_event_t *>(event);
-
-        if (pe->atom == p->atom(_NET_WM_NAME)) {
-            dirty |= WMName;
-        } else if (pe->atom == p->atom(_NET_WM_VISIBLE_NAME)) {
-            dirty |= WMVisibleName;
-        } else if (pe->atom == p->atom(_NET_WM_DESKTOP)) {
-            dirty |= WMDesktop;
-        } else if (pe->atom == p->atom(_NET_WM_WINDOW_TYPE)) {
-            dirty |= WMWindowType;
-        } else if (pe->atom == p->atom(_NET_WM_STATE)) {
-            dirty |= WMState;
-        } else if (pe->atom == p->atom(_NET_WM_STRUT)) {
-            dirty |= WMStrut;
-        } else if (pe->atom == p->atom(_NET_WM_STRUT_PARTIAL)) {
-            dirty2 |= WM2ExtendedStrut;
-        } else if (pe->atom == p->atom(_NET_WM_ICON_GEOMETRY)) {
-            dirty |= WMIconGeometry;
-        } else if (pe->atom == p->atom(_NET_WM_ICON)) {
-            dirty |= WMIcon;
-        } else if (pe->atom == p->atom(_NET_WM_PID)) {
-            dirty |= WMPid;
-        } else if (pe->atom == p->atom(_NET_WM_HANDLED_ICONS)) {
-            dirty |= WMHandledIcons;
-        } else if (pe->atom == p->atom(_NET_STARTUP_ID)) {
-            dirty2 |= WM2StartupId;
-        } else if (pe->atom == p->atom(_NET_WM_WINDOW_OPACITY)) {
-            dirty2 |= WM2Opacity;
-        } else if (pe->atom == p->atom(_NET_WM_ALLOWED_ACTIONS)) {
-            dirty2 |= WM2AllowedActions;
-        } else if (pe->atom == p->atom(WM_STATE)) {
-            dirty |= XAWMState;
-        } else if (pe->atom == p->atom(_NET_FRAME_EXTENTS)) {
-            dirty |= WMFrameExtents;
-        } else if (pe->atom == p->atom(_KDE_NET_WM_FRAME_STRUT)) {
-            dirty |= WMFrameExtents;
-        } else if (pe->atom == p->atom(_NET_WM_FRAME_OVERLAP)) {
-            dirty2 |= WM2FrameOverlap;
-        } else if (pe->atom == p->atom(_NET_WM_ICON_NAME)) {
-            dirty |= WMIconName;
-        } else if (pe->atom == p->atom(_NET_WM_VISIBLE_ICON_NAME)) {
-            dirty |= WMVisibleIconName;
-        } else if (pe->atom == p->atom(_NET_WM_USER_TIME)) {
-            dirty2 |= WM2UserTime;
-        } else if (pe->atom == XCB_ATOM_WM_HINTS) {
-            dirty2 |= WM2GroupLeader;
-            dirty2 |= WM2Urgency;
-            dirty2 |= WM2Input;
-            dirty2 |= WM2InitialMappingState;
-            dirty2 |= WM2IconPixmap;
-        } else if (pe->atom == XCB_ATOM_WM_TRANSIENT_FOR) {
-            dirty2 |= WM2TransientFor;
-        } else if (pe->atom == XCB_ATOM_WM_CLASS) {
-            dirty2 |= WM2WindowClass;
-        } else if (pe->atom == p->atom(WM_WINDOW_ROLE)) {
-            dirty2 |= WM2WindowRole;
-        } else if (pe->atom == XCB_ATOM_WM_CLIENT_MACHINE) {
-            dirty2 |= WM2ClientMachine;
-        } else if (pe->atom == p->atom(_KDE_NET_WM_ACTIVITIES)) {
-            dirty2 |= WM2Activities;
-        } else if (pe->atom == p->atom(_KDE_NET_WM_BLOCK_COMPOSITING) || pe->atom == p->atom(_NET_WM_BYPASS_COMPOSITOR)) {
-            dirty2 |= WM2BlockCompositing;
-        } else if (pe->atom == p->atom(_KDE_NET_WM_SHADOW)) {
-            dirty2 |= WM2KDEShadow;
-        } else if (pe->atom == p->atom(WM_PROTOCOLS)) {
-            dirty2 |= WM2Protocols;
-        } else if (pe->atom == p->atom(_NET_WM_OPAQUE_REGION)) {
-            dirty2 |= WM2OpaqueRegion;
-        } else if (pe->atom == p->atom(_KDE_NET_WM_DESKTOP_FILE)) {
-            dirty2 = WM2DesktopFileName;
-        } else if (pe->atom == p->atom(_GTK_APPLICATION_ID)) {
-            dirty2 = WM2GTKApplicationId;
-        } else if (pe->atom == p->atom(_NET_WM_FULLSCREEN_MONITORS)) {
-            dirty2 = WM2FullscreenMonitors;
-        } else if (pe->atom == p->atom(_GTK_FRAME_EXTENTS)) {
-            dirty2 |= WM2GTKFrameExtents;
-        } else if (pe->atom == p->atom(_KDE_NET_WM_APPMENU_SERVICE_NAME)) {
-            dirty2 |= WM2AppMenuServiceName;
-        } else if (pe->atom == p->atom(_KDE_NET_WM_APPMENU_OBJECT_PATH)) {
-            dirty2 |= WM2AppMenuObjectPath;
-        }
+        const Atoms::Dirty propertyDirty = p->atomTable()->windowPropertyDirty(pe->atom);
+        dirty |= propertyDirty.properties;
+        dirty2 |= propertyDirty.properties2;
 
         do_update = true;
     } else if (eventType == XCB_CONFIGURE_NOTIFY) {
@@ -3860,6 +4369,60 @@ void NETWinInfo::updateWMState()
 
 void NETWinInfo::update(NET::Properties dirtyProperties, NET::Properties2 dirtyProperties2)
 {
+    sendUpdateRequests(dirtyProperties, dirtyProperties2);
+    readUpdateReplies();
+}
+
+void NETWinInfoPrivateAccess::requestProperties(NETWinInfo *info, NET::Properties properties, NET::Properties2 properties2)
+{
+    info->requestProperties(properties, properties2);
+}
+
+void NETWinInfoPrivateAccess::sendUpdateRequests(NETWinInfo *info, NET::Properties dirtyProperties, NET::Properties2 dirtyProperties2)
+{
+    info->sendUpdateRequests(dirtyProperties, dirtyProperties2);
+}
+
+void NETWinInfoPrivateAccess::readUpdateReplies(NETWinInfo *info)
+{
+    info->readUpdateReplies();
+}
+
+void NETWinInfoPrivateAccess::detach(NETWinInfo *info)
+{
+    info->detach();
+}
+
+NETWinInfoPrivate *NETWinInfoPrivateAccess::d(NETWinInfo *info)
+{
+    return info->p;
+}
+
+const NETWinInfoPrivate *NETWinInfoPrivateAccess::d(const NETWinInfo *info)
+{
+    return info->p;
+}
+
+void NETWinInfo::requestProperties(NET::Properties properties, NET::Properties2 properties2)
+{
+    p->properties |= properties;
+    p->properties2 |= properties2;
+
+    sendUpdateRequests(properties, properties2);
+}
+
+void NETWinInfo::sendUpdateRequests(NET::Properties dirtyProperties, NET::Properties2 dirtyProperties2)
+{
+    if (p->pending_count > 0) {
+        // the values of those properties weren't updated yet, so instead of waiting for
+        // the replies, they are requested again along with the new ones
+        for (int i = 0; i < p->pending_count; i++) {
+            xcb_discard_reply(p->conn, p->pending_cookies[i].sequence);
+        }
+        dirtyProperties |= p->pending_dirty;
+        dirtyProperties2 |= p->pending_dirty2;
+    }
+
     Properties dirty = dirtyProperties & p->properties;
     Properties2 dirty2 = dirtyProperties2 & p->properties2;
 
@@ -3868,148 +4431,164 @@ void NETWinInfo::update(NET::Properties dirtyProperties, NET::Properties2 dirtyP
         dirty |= XAWMState;
     }
 
-    xcb_get_property_cookie_t cookies[255];
-    int c = 0;
+    p->pending_dirty = dirty;
+    p->pending_dirty2 = dirty2;
+
+    // reused, so that it only grows to the number of properties once
+    std::vector<xcb_get_property_cookie_t> &cookies = p->pending_cookies;
+    cookies.clear();
 
     if (dirty & XAWMState) {
-        cookies[c++] = xcb_get_property(p->conn, false, p->window, p->atom(WM_STATE), p->atom(WM_STATE), 0, 1);
+        cookies.push_back(xcb_get_property(p->conn, false, p->window, p->atom(WM_STATE), p->atom(WM_STATE), 0, 1));
     }
 
     if (dirty & WMState) {
-        cookies[c++] = xcb_get_property(p->conn, false, p->window, p->atom(_NET_WM_STATE), XCB_ATOM_ATOM, 0, 2048);
+        cookies.push_back(xcb_get_property(p->conn, false, p->window, p->atom(_NET_WM_STATE), XCB_ATOM_ATOM, 0, 2048));
     }
 
     if (dirty & WMDesktop) {
-        cookies[c++] = xcb_get_property(p->conn, false, p->window, p->atom(_NET_WM_DESKTOP), XCB_ATOM_CARDINAL, 0, 1);
+        cookies.push_back(xcb_get_property(p->conn, false, p->window, p->atom(_NET_WM_DESKTOP), XCB_ATOM_CARDINAL, 0, 1));
     }
 
     if (dirty & WMName) {
-        cookies[c++] = xcb_get_property(p->conn, false, p->window, p->atom(_NET_WM_NAME), p->atom(UTF8_STRING), 0, MAX_PROP_SIZE);
+        cookies.push_back(xcb_get_property(p->conn, false, p->window, p->atom(_NET_WM_NAME), p->atom(UTF8_STRING), 0, MAX_PROP_SIZE));
     }
 
     if (dirty & WMVisibleName) {
-        cookies[c++] = xcb_get_property(p->conn, false, p->window, p->atom(_NET_WM_VISIBLE_NAME), p->atom(UTF8_STRING), 0, MAX_PROP_SIZE);
+        cookies.push_back(xcb_get_property(p->conn, false, p->window, p->atom(_NET_WM_VISIBLE_NAME), p->atom(UTF8_STRING), 0, MAX_PROP_SIZE));
     }
 
     if (dirty & WMIconName) {
-        cookies[c++] = xcb_get_property(p->conn, false, p->window, p->atom(_NET_WM_ICON_NAME), p->atom(UTF8_STRING), 0, MAX_PROP_SIZE);
+        cookies.push_back(xcb_get_property(p->conn, false, p->window, p->atom(_NET_WM_ICON_NAME), p->atom(UTF8_STRING), 0, MAX_PROP_SIZE));
     }
 
     if (dirty & WMVisibleIconName) {
-        cookies[c++] = xcb_get_property(p->conn, false, p->window, p->atom(_NET_WM_VISIBLE_ICON_NAME), p->atom(UTF8_STRING), 0, MAX_PROP_SIZE);
+        cookies.push_back(xcb_get_property(p->conn, false, p->window, p->atom(_NET_WM_VISIBLE_ICON_NAME), p->atom(UTF8_STRING), 0, MAX_PROP_SIZE));
     }
 
     if (dirty & WMWindowType) {
-        cookies[c++] = xcb_get_property(p->conn, false, p->window, p->atom(_NET_WM_WINDOW_TYPE), XCB_ATOM_ATOM, 0, 2048);
+        cookies.push_back(xcb_get_property(p->conn, false, p->window, p->atom(_NET_WM_WINDOW_TYPE), XCB_ATOM_ATOM, 0, 2048));
     }
 
     if (dirty & WMStrut) {
-        cookies[c++] = xcb_get_property(p->conn, false, p->window, p->atom(_NET_WM_STRUT), XCB_ATOM_CARDINAL, 0, 4);
+        cookies.push_back(xcb_get_property(p->conn, false, p->window, p->atom(_NET_WM_STRUT), XCB_ATOM_CARDINAL, 0, 4));
     }
 
     if (dirty2 & WM2ExtendedStrut) {
-        cookies[c++] = xcb_get_property(p->conn, false, p->window, p->atom(_NET_WM_STRUT_PARTIAL), XCB_ATOM_CARDINAL, 0, 12);
+        cookies.push_back(xcb_get_property(p->conn, false, p->window, p->atom(_NET_WM_STRUT_PARTIAL), XCB_ATOM_CARDINAL, 0, 12));
     }
 
     if (dirty2 & WM2FullscreenMonitors) {
-        cookies[c++] = xcb_get_property(p->conn, false, p->window, p->atom(_NET_WM_FULLSCREEN_MONITORS), XCB_ATOM_CARDINAL, 0, 4);
+        cookies.push_back(xcb_get_property(p->conn, false, p->window, p->atom(_NET_WM_FULLSCREEN_MONITORS), XCB_ATOM_CARDINAL, 0, 4));
     }
 
     if (dirty & WMIconGeometry) {
-        cookies[c++] = xcb_get_property(p->conn, false, p->window, p->atom(_NET_WM_ICON_GEOMETRY), XCB_ATOM_CARDINAL, 0, 4);
+        cookies.push_back(xcb_get_property(p->conn, false, p->window, p->atom(_NET_WM_ICON_GEOMETRY), XCB_ATOM_CARDINAL, 0, 4));
     }
 
     if (dirty & WMIcon) {
-        cookies[c++] = xcb_get_property(p->conn, false, p->window, p->atom(_NET_WM_ICON), XCB_ATOM_CARDINAL, 0, 0xffffffff);
+        cookies.push_back(xcb_get_property(p->conn, false, p->window, p->atom(_NET_WM_ICON), XCB_ATOM_CARDINAL, 0, MAX_ICON_PROP_SIZE));
     }
 
     if (dirty & WMFrameExtents) {
-        cookies[c++] = xcb_get_property(p->conn, false, p->window, p->atom(_NET_FRAME_EXTENTS), XCB_ATOM_CARDINAL, 0, 4);
-        cookies[c++] = xcb_get_property(p->conn, false, p->window, p->atom(_KDE_NET_WM_FRAME_STRUT), XCB_ATOM_CARDINAL, 0, 4);
+        cookies.push_back(xcb_get_property(p->conn, false, p->window, p->atom(_NET_FRAME_EXTENTS), XCB_ATOM_CARDINAL, 0, 4));
+        cookies.push_back(xcb_get_property(p->conn, false, p->window, p->atom(_KDE_NET_WM_FRAME_STRUT), XCB_ATOM_CARDINAL, 0, 4));
     }
 
     if (dirty2 & WM2FrameOverlap) {
-        cookies[c++] = xcb_get_property(p->conn, false, p->window, p->atom(_NET_WM_FRAME_OVERLAP), XCB_ATOM_CARDINAL, 0, 4);
+        cookies.push_back(xcb_get_property(p->conn, false, p->window, p->atom(_NET_WM_FRAME_OVERLAP), XCB_ATOM_CARDINAL, 0, 4));
     }
 
     if (dirty2 & WM2Activities) {
-        cookies[c++] = xcb_get_property(p->conn, false, p->window, p->atom(_KDE_NET_WM_ACTIVITIES), XCB_ATOM_STRING, 0, MAX_PROP_SIZE);
+        cookies.push_back(xcb_get_property(p->conn, false, p->window, p->atom(_KDE_NET_WM_ACTIVITIES), XCB_ATOM_STRING, 0, MAX_PROP_SIZE));
     }
 
     if (dirty2 & WM2BlockCompositing) {
-        cookies[c++] = xcb_get_property(p->conn, false, p->window, p->atom(_KDE_NET_WM_BLOCK_COMPOSITING), XCB_ATOM_CARDINAL, 0, 1);
-        cookies[c++] = xcb_get_property(p->conn, false, p->window, p->atom(_NET_WM_BYPASS_COMPOSITOR), XCB_ATOM_CARDINAL, 0, 1);
+        cookies.push_back(xcb_get_property(p->conn, false, p->window, p->atom(_KDE_NET_WM_BLOCK_COMPOSITING), XCB_ATOM_CARDINAL, 0, 1));
+        cookies.push_back(xcb_get_property(p->conn, false, p->window, p->atom(_NET_WM_BYPASS_COMPOSITOR), XCB_ATOM_CARDINAL, 0, 1));
     }
 
     if (dirty & WMPid) {
-        cookies[c++] = xcb_get_property(p->conn, false, p->window, p->atom(_NET_WM_PID), XCB_ATOM_CARDINAL, 0, 1);
+        cookies.push_back(xcb_get_property(p->conn, false, p->window, p->atom(_NET_WM_PID), XCB_ATOM_CARDINAL, 0, 1));
     }
 
     if (dirty2 & WM2StartupId) {
-        cookies[c++] = xcb_get_property(p->conn, false, p->window, p->atom(_NET_STARTUP_ID), p->atom(UTF8_STRING), 0, MAX_PROP_SIZE);
+        cookies.push_back(xcb_get_property(p->conn, false, p->window, p->atom(_NET_STARTUP_ID), p->atom(UTF8_STRING), 0, MAX_PROP_SIZE));
     }
 
     if (dirty2 & WM2Opacity) {
-        cookies[c++] = xcb_get_property(p->conn, false, p->window, p->atom(_NET_WM_WINDOW_OPACITY), XCB_ATOM_CARDINAL, 0, 1);
+        cookies.push_back(xcb_get_property(p->conn, false, p->window, p->atom(_NET_WM_WINDOW_OPACITY), XCB_ATOM_CARDINAL, 0, 1));
     }
 
     if (dirty2 & WM2AllowedActions) {
-        cookies[c++] = xcb_get_property(p->conn, false, p->window, p->atom(_NET_WM_ALLOWED_ACTIONS), XCB_ATOM_ATOM, 0, 2048);
+        cookies.push_back(xcb_get_property(p->conn, false, p->window, p->atom(_NET_WM_ALLOWED_ACTIONS), XCB_ATOM_ATOM, 0, 2048));
     }
 
     if (dirty2 & WM2UserTime) {
-        cookies[c++] = xcb_get_property(p->conn, false, p->window, p->atom(_NET_WM_USER_TIME), XCB_ATOM_CARDINAL, 0, 1);
+        cookies.push_back(xcb_get_property(p->conn, false, p->window, p->atom(_NET_WM_USER_TIME), XCB_ATOM_CARDINAL, 0, 1));
     }
 
     if (dirty2 & WM2TransientFor) {
-        cookies[c++] = xcb_get_property(p->conn, false, p->window, XCB_ATOM_WM_TRANSIENT_FOR, XCB_ATOM_WINDOW, 0, 1);
+        cookies.push_back(xcb_get_property(p->conn, false, p->window, XCB_ATOM_WM_TRANSIENT_FOR, XCB_ATOM_WINDOW, 0, 1));
     }
 
     if (dirty2 & (WM2GroupLeader | WM2Urgency | WM2Input | WM2InitialMappingState | WM2IconPixmap)) {
-        cookies[c++] = xcb_get_property(p->conn, false, p->window, XCB_ATOM_WM_HINTS, XCB_ATOM_WM_HINTS, 0, 9);
+        cookies.push_back(xcb_get_property(p->conn, false, p->window, XCB_ATOM_WM_HINTS, XCB_ATOM_WM_HINTS, 0, 9));
     }
 
     if (dirty2 & WM2WindowClass) {
-        cookies[c++] = xcb_get_property(p->conn, false, p->window, XCB_ATOM_WM_CLASS, XCB_ATOM_STRING, 0, MAX_PROP_SIZE);
+        cookies.push_back(xcb_get_property(p->conn, false, p->window, XCB_ATOM_WM_CLASS, XCB_ATOM_STRING, 0, MAX_PROP_SIZE));
     }
 
     if (dirty2 & WM2WindowRole) {
-        cookies[c++] = xcb_get_property(p->conn, false, p->window, p->atom(WM_WINDOW_ROLE), XCB_ATOM_STRING, 0, MAX_PROP_SIZE);
+        cookies.push_back(xcb_get_property(p->conn, false, p->window, p->atom(WM_WINDOW_ROLE), XCB_ATOM_STRING, 0, MAX_PROP_SIZE));
     }
 
     if (dirty2 & WM2ClientMachine) {
-        cookies[c++] = xcb_get_property(p->conn, false, p->window, XCB_ATOM_WM_CLIENT_MACHINE, XCB_ATOM_STRING, 0, MAX_PROP_SIZE);
+        cookies.push_back(xcb_get_property(p->conn, false, p->window, XCB_ATOM_WM_CLIENT_MACHINE, XCB_ATOM_STRING, 0, MAX_PROP_SIZE));
     }
 
     if (dirty2 & WM2Protocols) {
-        cookies[c++] = xcb_get_property(p->conn, false, p->window, p->atom(WM_PROTOCOLS), XCB_ATOM_ATOM, 0, 2048);
+        cookies.push_back(xcb_get_property(p->conn, false, p->window, p->atom(WM_PROTOCOLS), XCB_ATOM_ATOM, 0, 2048));
     }
 
     if (dirty2 & WM2OpaqueRegion) {
-        cookies[c++] = xcb_get_property(p->conn, false, p->window, p->atom(_NET_WM_OPAQUE_REGION), XCB_ATOM_CARDINAL, 0, MAX_PROP_SIZE);
+        cookies.push_back(xcb_get_property(p->conn, false, p->window, p->atom(_NET_WM_OPAQUE_REGION), XCB_ATOM_CARDINAL, 0, MAX_PROP_SIZE));
     }
 
     if (dirty2 & WM2DesktopFileName) {
-        cookies[c++] = xcb_get_property(p->conn, false, p->window, p->atom(_KDE_NET_WM_DESKTOP_FILE), p->atom(UTF8_STRING), 0, MAX_PROP_SIZE);
+        cookies.push_back(xcb_get_property(p->conn, false, p->window, p->atom(_KDE_NET_WM_DESKTOP_FILE), p->atom(UTF8_STRING), 0, MAX_PROP_SIZE));
     }
 
     if (dirty2 & WM2GTKApplicationId) {
-        cookies[c++] = xcb_get_property(p->conn, false, p->window, p->atom(_GTK_APPLICATION_ID), p->atom(UTF8_STRING), 0, MAX_PROP_SIZE);
+        cookies.push_back(xcb_get_property(p->conn, false, p->window, p->atom(_GTK_APPLICATION_ID), p->atom(UTF8_STRING), 0, MAX_PROP_SIZE));
     }
 
     if (dirty2 & WM2GTKFrameExtents) {
-        cookies[c++] = xcb_get_property(p->conn, false, p->window, p->atom(_GTK_FRAME_EXTENTS), XCB_ATOM_CARDINAL, 0, 4);
+        cookies.push_back(xcb_get_property(p->conn, false, p->window, p->atom(_GTK_FRAME_EXTENTS), XCB_ATOM_CARDINAL, 0, 4));
     }
 
     if (dirty2 & WM2AppMenuObjectPath) {
-        cookies[c++] = xcb_get_property(p->conn, false, p->window, p->atom(_KDE_NET_WM_APPMENU_OBJECT_PATH), XCB_ATOM_STRING, 0, MAX_PROP_SIZE);
+        cookies.push_back(xcb_get_property(p->conn, false, p->window, p->atom(_KDE_NET_WM_APPMENU_OBJECT_PATH), XCB_ATOM_STRING, 0, MAX_PROP_SIZE));
     }
 
     if (dirty2 & WM2AppMenuServiceName) {
-        cookies[c++] = xcb_get_property(p->conn, false, p->window, p->atom(_KDE_NET_WM_APPMENU_SERVICE_NAME), XCB_ATOM_STRING, 0, MAX_PROP_SIZE);
+        cookies.push_back(xcb_get_property(p->conn, false, p->window, p->atom(_KDE_NET_WM_APPMENU_SERVICE_NAME), XCB_ATOM_STRING, 0, MAX_PROP_SIZE));
     }
 
-    c = 0;
+    p->pending_count = int(cookies.size());
+}
+
+void NETWinInfo::readUpdateReplies()
+{
+    const Properties dirty = p->pending_dirty;
+    const Properties2 dirty2 = p->pending_dirty2;
+    const xcb_get_property_cookie_t *cookies = p->pending_cookies.data();
+    int c = 0;
+
+    p->pending_dirty = Properties();
+    p->pending_dirty2 = Properties2();
+    p->pending_count = 0;
 
     if (dirty & XAWMState) {
         p->mapping_state = Withdrawn;
@@ -4128,43 +4707,19 @@ void NETWinInfo::update(NET::Properties dirtyProperties, NET::Properties2 dirtyP
     }
 
     if (dirty & WMName) {
-        delete[] p->name;
-        p->name = nullptr;
-
-        const QByteArray str = get_string_reply(p->conn, cookies[c++], p->atom(UTF8_STRING));
-        if (str.length() > 0) {
-            p->name = nstrndup(str.constData(), str.length());
-        }
+        read_string_reply(p, p->name, cookies[c++], p->atom(UTF8_STRING));
     }
 
     if (dirty & WMVisibleName) {
-        delete[] p->visible_name;
-        p->visible_name = nullptr;
-
-        const QByteArray str = get_string_reply(p->conn, cookies[c++], p->atom(UTF8_STRING));
-        if (str.length() > 0) {
-            p->visible_name = nstrndup(str.constData(), str.length());
-        }
+        read_string_reply(p, p->visible_name, cookies[c++], p->atom(UTF8_STRING));
     }
 
     if (dirty & WMIconName) {
-        delete[] p->icon_name;
-        p->icon_name = nullptr;
-
-        const QByteArray str = get_string_reply(p->conn, cookies[c++], p->atom(UTF8_STRING));
-        if (str.length() > 0) {
-            p->icon_name = nstrndup(str.constData(), str.length());
-        }
+        read_string_reply(p, p->icon_name, cookies[c++], p->atom(UTF8_STRING));
     }
 
     if (dirty & WMVisibleIconName) {
-        delete[] p->visible_icon_name;
-        p->visible_icon_name = nullptr;
-
-        const QByteArray str = get_string_reply(p->conn, cookies[c++], p->atom(UTF8_STRING));
-        if (str.length() > 0) {
-            p->visible_icon_name = nstrndup(str.constData(), str.length());
-        }
+        read_string_reply(p, p->visible_icon_name, cookies[c++], p->atom(UTF8_STRING));
     }
 
     if (dirty & WMWindowType) {
@@ -4318,7 +4873,7 @@ void NETWinInfo::update(NET::Properties dirtyProperties, NET::Properties2 dirtyP
     }
 
     if (dirty & WMIcon) {
-        readIcon(p->conn, cookies[c++], p->icons, p->icon_count);
+        readIcon(p->conn, cookies[c++], p->icons, p->icon_count, p->icon_reply);
         delete[] p->icon_sizes;
         p->icon_sizes = nullptr;
     }
@@ -4355,13 +4910,7 @@ void NETWinInfo::update(NET::Properties dirtyProperties, NET::Properties2 dirtyP
     }
 
     if (dirty2 & WM2Activities) {
-        delete[] p->activities;
-        p->activities = nullptr;
-
-        const QByteArray activities = get_string_reply(p->conn, cookies[c++], XCB_ATOM_STRING);
-        if (activities.length() > 0) {
-            p->activities = nstrndup(activities.constData(), activities.length());
-        }
+        read_string_reply(p, p->activities, cookies[c++], XCB_ATOM_STRING);
     }
 
     if (dirty2 & WM2BlockCompositing) {
@@ -4395,13 +4944,7 @@ void NETWinInfo::update(NET::Properties dirtyProperties, NET::Properties2 dirtyP
     }
 
     if (dirty2 & WM2StartupId) {
-        delete[] p->startup_id;
-        p->startup_id = nullptr;
-
-        const QByteArray id = get_string_reply(p->conn, cookies[c++], p->atom(UTF8_STRING));
-        if (id.length() > 0) {
-            p->startup_id = nstrndup(id.constData(), id.length());
-        }
+        read_string_reply(p, p->startup_id, cookies[c++], p->atom(UTF8_STRING));
     }
 
     if (dirty2 & WM2Opacity) {
@@ -4523,39 +5066,25 @@ void NETWinInfo::update(NET::Properties dirtyProperties, NET::Properties2 dirtyP
     }
 
     if (dirty2 & WM2WindowClass) {
-        delete[] p->class_name;
-        delete[] p->class_class;
-        p->class_name = nullptr;
-        p->class_class = nullptr;
-
         const QList<QByteArray> list = get_stringlist_reply(p->conn, cookies[c++], XCB_ATOM_STRING);
         if (list.count() == 2) {
-            p->class_name = nstrdup(list.at(0).constData());
-            p->class_class = nstrdup(list.at(1).constData());
+            p->setString(p->class_name, list.at(0).constData());
+            p->setString(p->class_class, list.at(1).constData());
         } else if (list.count() == 1) { // Not fully compliant client. Provides a single string
-            p->class_name = nstrdup(list.at(0).constData());
-            p->class_class = nstrdup(list.at(0).constData());
+            p->setString(p->class_name, list.at(0).constData());
+            p->setString(p->class_class, list.at(0).constData());
+        } else {
+            p->setString(p->class_name, nullptr);
+            p->setString(p->class_class, nullptr);
         }
     }
 
     if (dirty2 & WM2WindowRole) {
-        delete[] p->window_role;
-        p->window_role = nullptr;
-
-        const QByteArray role = get_string_reply(p->conn, cookies[c++], XCB_ATOM_STRING);
-        if (role.length() > 0) {
-            p->window_role = nstrndup(role.constData(), role.length());
-        }
+        read_string_reply(p, p->window_role, cookies[c++], XCB_ATOM_STRING);
     }
 
     if (dirty2 & WM2ClientMachine) {
-        delete[] p->client_machine;
-        p->client_machine = nullptr;
-
-        const QByteArray value = get_string_reply(p->conn, cookies[c++], XCB_ATOM_STRING);
-        if (value.length() > 0) {
-            p->client_machine = nstrndup(value.constData(), value.length());
-        }
+        read_string_reply(p, p->client_machine, cookies[c++], XCB_ATOM_STRING);
     }
 
     if (dirty2 & WM2Protocols) {
@@ -4591,23 +5120,11 @@ void NETWinInfo::update(NET::Properties dirtyProperties, NET::Properties2 dirtyP
     }
 
     if (dirty2 & WM2DesktopFileName) {
-        delete[] p->desktop_file;
-        p->desktop_file = nullptr;
-
-        const QByteArray id = get_string_reply(p->conn, cookies[c++], p->atom(UTF8_STRING));
-        if (id.length() > 0) {
-            p->desktop_file = nstrndup(id.constData(), id.length());
-        }
+        read_string_reply(p, p->desktop_file, cookies[c++], p->atom(UTF8_STRING));
     }
 
     if (dirty2 & WM2GTKApplicationId) {
-        delete[] p->gtk_application_id;
-        p->gtk_application_id = nullptr;
-
-        const QByteArray id = get_string_reply(p->conn, cookies[c++], p->atom(UTF8_STRING));
-        if (id.length() > 0) {
-            p->gtk_application_id = nstrndup(id.constData(), id.length());
-        }
+        read_string_reply(p, p->gtk_application_id, cookies[c++], p->atom(UTF8_STRING));
     }
 
     if (dirty2 & WM2GTKFrameExtents) {
@@ -4623,23 +5140,11 @@ void NETWinInfo::update(NET::Properties dirtyProperties, NET::Properties2 dirtyP
     }
 
     if (dirty2 & WM2AppMenuObjectPath) {
-        delete[] p->appmenu_object_path;
-        p->appmenu_object_path = nullptr;
-
-        const QByteArray id = get_string_reply(p->conn, cookies[c++], XCB_ATOM_STRING);
-        if (id.length() > 0) {
-            p->appmenu_object_path = nstrndup(id.constData(), id.length());
-        }
+        read_string_reply(p, p->appmenu_object_path, cookies[c++], XCB_ATOM_STRING);
     }
 
     if (dirty2 & WM2AppMenuServiceName) {
-        delete[] p->appmenu_service_name;
-        p->appmenu_service_name = nullptr;
-
-        const QByteArray id = get_string_reply(p->conn, cookies[c++], XCB_ATOM_STRING);
-        if (id.length() > 0) {
-            p->appmenu_service_name = nstrndup(id.constData(), id.length());
-        }
+        read_string_reply(p, p->appmenu_service_name, cookies[c++], XCB_ATOM_STRING);
     }
 }
 
@@ -4848,16 +5353,14 @@ const char *NETWinInfo::activities() const
 
 void NETWinInfo::setActivities(const char *activities)
 {
-    delete[] p->activities;
-
     if (activities == (char *)nullptr || activities[0] == '\0') {
         // on all activities
         static const char nulluuid[] = KDE_ALL_ACTIVITIES_UUID;
 
-        p->activities = nstrdup(nulluuid);
+        p->setString(p->activities, nulluuid);
 
     } else {
-        p->activities = nstrdup(activities);
+        p->setString(p->activities, activities);
     }
 
     xcb_change_property(p->conn, XCB_PROP_MODE_REPLACE, p->window, p->atom(_KDE_NET_WM_ACTIVITIES), XCB_ATOM_STRING, 8, strlen(p->activities), p->activities);
@@ -4931,8 +5434,7 @@ void NETWinInfo::setDesktopFileName(const char *name)
         return;
     }
 
-    delete[] p->desktop_file;
-    p->desktop_file = nstrdup(name);
+    p->setString(p->desktop_file, name);
 
     xcb_change_property(p->conn,
                         XCB_PROP_MODE_REPLACE,
@@ -20,6 +20,7 @@
 #define KDE_ALL_ACTIVITIES_UUID "00000000-0000-0000-0000-000000000000"
 
 // forward declaration
+class QImage;
 struct NETRootInfoPrivate;
 struct NETWinInfoPrivate;
 template<class Z>
@@ -1330,6 +1331,39 @@ public:
     **/
     NETIcon icon(int width = -1, int height = -1) const;
 
+    /**
+       Returns the icon icon() returns for @p width and @p height as a QImage in
+       QImage::Format_ARGB32. The image shares the icon data as read from the window
+       instead of copying it and keeps it alive, also when this NETWinInfo is destroyed
+       or its icons get updated.
+
+       @param width the preferred width for the icon, -1 to ignore
+
+       @param height the preferred height for the icon, -1 to ignore
+
+       @return the icon, a null image if there is none
+       @since 5.96
+    **/
+    QImage iconImage(int width = -1, int height = -1) const;
+
+    /**
+       Reads only the icon from the window that icon() would return for @p width and
+       @p height, instead of all icons like NET::WMIcon does. The first 32 KiB of the
+       property are read at once; if that's all of it, all icons are kept like with
+       NET::WMIcon. Otherwise the width and height headers of the icons are walked,
+       those beyond the first 32 KiB with a roundtrip each, and only the data of the
+       chosen icon is transferred, which saves most of the data if only a small icon is
+       needed. Then icon(), iconImage() and iconSizes() only know the fetched icon.
+
+       Like NET::WMIcon, the property is only read up to 16 MiB.
+
+       @param width the preferred width for the icon, -1 to ignore
+
+       @param height the preferred height for the icon, -1 to ignore
+       @since 5.96
+    **/
+    void fetchIcon(int width, int height);
+
     /**
       Returns a list of provided icon sizes. Each size is pair width,height, terminated
       with pair 0,0.
@@ -1585,6 +1619,22 @@ public:
     **/
     NET::Properties event(xcb_generic_event_t *event);
 
+    /**
+     * Determines the properties the passed in xcb_generic_event_t changes on a client
+     * window, as event() does for the Client role, but without reading any new
+     * information and without the need for a NETWinInfo instance. This makes it cheap
+     * to find out whether an event is of interest at all.
+     *
+     * It is possible to pass in a null pointer in the arguments.
+     *
+     * @param connection the xcb connection the event was received on
+     * @param event the event
+     * @param properties The NET::Properties that changed
+     * @param properties2 The NET::Properties2 that changed
+     * @since 5.96
+     **/
+    static void dirtyProperties(xcb_connection_t *connection, xcb_generic_event_t *event, NET::Properties *properties, NET::Properties2 *properties2 = nullptr);
+
     /**
      * @returns The window manager protocols this Client supports.
      * @since 5.3
@@ -1707,6 +1757,13 @@ protected:
 
 private:
     void update(NET::Properties dirtyProperties, NET::Properties2 dirtyProperties2 = NET::Properties2());
+    // Split update(): the requests are sent first and the replies are read later on,
+    // which allows to pipeline the roundtrips of several NETWinInfo instances.
+    void requestProperties(NET::Properties properties, NET::Properties2 properties2);
+    void sendUpdateRequests(NET::Properties dirtyProperties, NET::Properties2 dirtyProperties2);
+    void readUpdateReplies();
+    // gives this instance its own copy of the data if it is shared with other instances
+    void detach();
     void updateWMState();
     void setIconInternal(NETRArray<NETIcon> &icons, int &icon_count, xcb_atom_t property, NETIcon icon, bool replace);
     NETIcon iconInternal(NETRArray<NETIcon> &icons, int icon_count, int width, int height) const;
@@ -1718,6 +1775,7 @@ protected:
     virtual void virtual_hook(int id, void *data);
 
 private:
+    friend class NETWinInfoPrivateAccess;
     NETWinInfoPrivate *p; // krazy:exclude=dpointer (implicitly shared)
 };
 
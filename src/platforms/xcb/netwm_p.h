@@ -8,25 +8,88 @@
 #ifndef netwm_p_h
 #define netwm_p_h
 
+#include <QAtomicInt>
+#include <QHash>
+#include <QMutex>
 #include <QSharedData>
 #include <QSharedDataPointer>
+#include <QSharedPointer>
+
+#include <xcb/xcb.h>
+
+#include <vector>
 
 #include "atoms_p.h"
+#include "netwm_def.h"
+
+class NETWinInfo;
 
 class Atoms : public QSharedData
 {
 public:
     explicit Atoms(xcb_connection_t *c);
+    Atoms(const Atoms &other);
+
+    /**
+       The atoms are interned lazily, in groups, so that a client only waits for the
+       atoms it actually uses. All atoms of a group are interned in one go, with the
+       requests pipelined.
+    **/
+    enum Group {
+        RootGroup, // root window properties
+        ClientGroup, // application window properties, types and states
+        WindowManagerGroup, // root window messages, allowed actions and protocols
+        KdeGroup, // KDE extensions
+        GroupCount,
+    };
 
     xcb_atom_t atom(KwsAtom atom) const
     {
+        ensureInterned(m_atomGroups[atom]);
         return m_atoms[atom];
     }
 
+    /**
+       The KwsAtom interned as @p atom, or KwsAtomCount if it is none of ours.
+       Interns all groups.
+    **/
+    KwsAtom kwsAtom(xcb_atom_t atom) const;
+
+    struct Dirty {
+        NET::Properties properties;
+        NET::Properties2 properties2;
+    };
+
+    /**
+       The properties a PropertyNotify for @p atom on the root window, respectively
+       on a client window, makes dirty.
+    **/
+    Dirty rootPropertyDirty(xcb_atom_t atom) const;
+    Dirty windowPropertyDirty(xcb_atom_t atom) const;
+
 private:
-    void init();
-    xcb_atom_t m_atoms[KwsAtomCount];
+    void ensureInterned(Group group) const
+    {
+        if (Q_UNLIKELY(!m_interned[group].loadAcquire())) {
+            intern(group);
+        }
+    }
+    void intern(Group group) const;
+
+    // reverse lookups of the atoms of one group, built once when the group got interned
+    struct Dispatch {
+        QHash<xcb_atom_t, KwsAtom> kwsAtoms;
+        QHash<xcb_atom_t, Dirty> rootProperties;
+        QHash<xcb_atom_t, Dirty> windowProperties;
+    };
+
+    Group m_atomGroups[KwsAtomCount];
     xcb_connection_t *m_connection;
+    // only written with m_mutex held, before the group is marked as interned
+    mutable xcb_atom_t m_atoms[KwsAtomCount];
+    mutable Dispatch m_dispatch[GroupCount];
+    mutable QAtomicInt m_interned[GroupCount];
+    mutable QMutex m_mutex;
 };
 
 /**
@@ -48,6 +111,13 @@ public:
 
     NETRArray();
 
+    /**
+       Constructs a deep copy of @p other.
+    **/
+
+    NETRArray(const NETRArray<Z> &other);
+    NETRArray<Z> &operator=(const NETRArray<Z> &) = delete;
+
     /**
        Resizable array destructor.
     **/
@@ -75,6 +145,11 @@ public:
      **/
     void reset();
 
+    /**
+       Makes room for at least @p count elements without changing the size.
+     **/
+    void reserve(int count);
+
 private:
     int sz;
     int capacity;
@@ -131,6 +206,50 @@ struct NETRootInfoPrivate {
     {
         return atoms->atom(atom);
     }
+    const Atoms *atomTable() const
+    {
+        return atoms.constData();
+    }
+};
+
+/**
+   The storage of the strings of a NETWinInfoPrivate. Instead of a heap buffer each,
+   the strings are appended to blocks, the strings of a fully populated window usually
+   fit into the first one. A replaced string stays in its block until all strings of the
+   block are replaced, strings in use are never moved, so the pointers to them stay valid.
+
+   A copy starts empty, NETWinInfo::detach() copies the strings into it.
+**/
+class NETStringArena
+{
+public:
+    NETStringArena() = default;
+    NETStringArena(const NETStringArena &other);
+    ~NETStringArena();
+    NETStringArena &operator=(const NETStringArena &other) = delete;
+
+    // like nstrndup(), nullptr for an empty string
+    const char *copy(const char *str, int length);
+    // like nstrdup()
+    const char *copy(const char *str);
+    // @p str, returned by copy(), is not used anymore, a block is freed once all its strings are
+    void release(const char *str);
+
+private:
+    enum {
+        MinBlockSize = 512,
+    };
+    struct Block {
+        Block *next;
+        int size;
+        int used;
+        int released;
+        // followed by the data
+    };
+    void addBlock(int size);
+    char *allocate(int size);
+
+    Block *m_block = nullptr; // the one being filled, linked to the older ones
 };
 
 /**
@@ -149,6 +268,9 @@ struct NETWinInfoPrivate {
     NETRArray<NETIcon> icons;
     int icon_count;
     int *icon_sizes; // for iconSizes() only
+    // the _NET_WM_ICON reply the data of the icons points into, shared with detached
+    // copies; null if the icons own their data, see setIcon()
+    QSharedPointer<xcb_get_property_reply_t> icon_reply;
 
     NETRect icon_geom, win_geom;
     NET::States state;
@@ -158,17 +280,18 @@ struct NETWinInfoPrivate {
     NETStrut frame_overlap;
     NETStrut gtk_frame_extents;
     NETRArray<NET::WindowType> types;
-    char *name, *visible_name, *icon_name, *visible_icon_name;
+    // point into strings, set with setString()
+    const char *name, *visible_name, *icon_name, *visible_icon_name;
     int desktop;
     int pid;
     bool handled_icons;
     xcb_timestamp_t user_time;
-    char *startup_id;
+    const char *startup_id;
     unsigned long opacity;
     xcb_window_t transient_for, window_group;
     xcb_pixmap_t icon_pixmap, icon_mask;
     NET::Actions allowed_actions;
-    char *class_class, *class_name, *window_role, *client_machine, *desktop_file, *appmenu_object_path, *appmenu_service_name, *gtk_application_id;
+    const char *class_class, *class_name, *window_role, *client_machine, *desktop_file, *appmenu_object_path, *appmenu_service_name, *gtk_application_id;
 
     NET::Properties properties;
     NET::Properties2 properties2;
@@ -183,13 +306,47 @@ struct NETWinInfoPrivate {
     NET::Protocols protocols;
     std::vector<NETRect> opaqueRegion;
 
+    // requests sent by NETWinInfo::sendUpdateRequests() whose replies are not read yet
+    NET::Properties pending_dirty;
+    NET::Properties2 pending_dirty2;
+    int pending_count = 0;
+    std::vector<xcb_get_property_cookie_t> pending_cookies;
+
     int ref;
 
+    NETStringArena strings;
+    // replaces @p field by a copy of @p value, like nstrdup() for a negative @p length,
+    // otherwise like nstrndup()
+    void setString(const char *&field, const char *value, int length = -1);
+
     QSharedDataPointer<Atoms> atoms;
     xcb_atom_t atom(KwsAtom atom) const
     {
         return atoms->atom(atom);
     }
+    const Atoms *atomTable() const
+    {
+        return atoms.constData();
+    }
+};
+
+/**
+   Gives the rest of the platform plugin access to the internals of a NETWinInfo,
+   without naming its classes in the installed header.
+   @internal
+**/
+class NETWinInfoPrivateAccess
+{
+public:
+    // Split NETWinInfo::update(): the requests are sent first and the replies are read
+    // later on, which allows to pipeline the roundtrips of several NETWinInfo instances.
+    static void requestProperties(NETWinInfo *info, NET::Properties properties, NET::Properties2 properties2);
+    static void sendUpdateRequests(NETWinInfo *info, NET::Properties dirtyProperties, NET::Properties2 dirtyProperties2);
+    static void readUpdateReplies(NETWinInfo *info);
+    // gives @p info its own copy of the data if it is shared with other instances
+    static void detach(NETWinInfo *info);
+    static NETWinInfoPrivate *d(NETWinInfo *info);
+    static const NETWinInfoPrivate *d(const NETWinInfo *info);
 };
 
 #endif // netwm_p_h
@@ -11,7 +11,7 @@
 #include "kwindowsystem_p_x11.h"
 
 X11Plugin::X11Plugin(QObject *parent)
-    : KWindowSystemPluginInterface(parent)
+    : KWindowSystemPluginInterfaceV2(parent)
 {
 }
 
@@ -31,6 +31,9 @@ KWindowSystemPrivate *X11Plugin::createWindowSystem()
 
 KWindowInfoPrivate *X11Plugin::createWindowInfo(WId window, NET::Properties properties, NET::Properties2 properties2)
 {
+    if (KWindowInfoPrivate *info = NETEventFilter::mirroredWindowInfo(window, properties, properties2)) {
+        return info;
+    }
     return new KWindowInfoPrivateX11(window, properties, properties2);
 }
 
@@ -43,3 +46,17 @@ KWindowShadowTilePrivate *X11Plugin::createWindowShadowTile()
 {
     return new KWindowShadowTilePrivateX11();
 }
+
+QList<KWindowInfoPrivate *> X11Plugin::createWindowInfos(const QList<WId> &windows, NET::Properties properties, NET::Properties2 properties2)
+{
+    return KWindowInfoPrivateX11::createMany(windows, properties, properties2);
+}
+
+bool X11Plugin::createWindowInfoAsync(WId window,
+                                      NET::Properties properties,
+                                      NET::Properties2 properties2,
+                                      const std::function<void(KWindowInfoPrivate *)> &callback)
+{
+    KWindowInfoPrivateX11::createAsync(window, properties, properties2, callback);
+    return true;
+}
@@ -8,7 +8,7 @@
 
 #include "kwindowsystemplugininterface_p.h"
 
-class X11Plugin : public KWindowSystemPluginInterface
+class X11Plugin : public KWindowSystemPluginInterfaceV2
 {
     Q_OBJECT
     Q_PLUGIN_METADATA(IID "org.kde.kwindowsystem.KWindowSystemPluginInterface" FILE "xcb.json")
@@ -23,6 +23,11 @@ public:
     KWindowInfoPrivate *createWindowInfo(WId window, NET::Properties properties, NET::Properties2 properties2) override;
     KWindowShadowPrivate *createWindowShadow() override final;
     KWindowShadowTilePrivate *createWindowShadowTile() override final;
+    QList<KWindowInfoPrivate *> createWindowInfos(const QList<WId> &windows, NET::Properties properties, NET::Properties2 properties2) override;
+    bool createWindowInfoAsync(WId window,
+                               NET::Properties properties,
+                               NET::Properties2 properties2,
+                               const std::function<void(KWindowInfoPrivate *)> &callback) override;
 };
 
 #endif
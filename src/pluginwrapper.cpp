@@ -16,6 +16,7 @@
 #include <QJsonArray>
 #include <QLibrary>
 #include <QPluginLoader>
+#include <QTimer>
 
 Q_GLOBAL_STATIC(KWindowSystemPluginWrapper, s_pluginWrapper)
 
@@ -169,6 +170,45 @@ KWindowShadowTilePrivate *KWindowSystemPluginWrapper::createWindowShadowTile() c
     return p;
 }
 
+QList<KWindowInfoPrivate *> KWindowSystemPluginWrapper::createWindowInfos(const QList<WId> &windows, NET::Properties properties, NET::Properties2 properties2) const
+{
+    QList<KWindowInfoPrivate *> infos;
+    if (!windows.isEmpty()) {
+        if (auto pluginV2 = dynamic_cast<KWindowSystemPluginInterfaceV2 *>(m_plugin.data())) {
+            infos = pluginV2->createWindowInfos(windows, properties, properties2);
+        }
+    }
+    if (infos.count() != windows.count()) {
+        // shared, some might be owned by a cache of the plugin too
+        for (KWindowInfoPrivate *info : std::as_const(infos)) {
+            QExplicitlySharedDataPointer<KWindowInfoPrivate> adopted(info);
+        }
+        infos.clear();
+        infos.reserve(windows.count());
+        for (WId window : windows) {
+            infos << createWindowInfo(window, properties, properties2);
+        }
+    }
+    return infos;
+}
+
+void KWindowSystemPluginWrapper::createWindowInfoAsync(WId window,
+                                                       NET::Properties properties,
+                                                       NET::Properties2 properties2,
+                                                       const std::function<void(KWindowInfoPrivate *)> &callback) const
+{
+    if (auto pluginV2 = dynamic_cast<KWindowSystemPluginInterfaceV2 *>(m_plugin.data())) {
+        if (pluginV2->createWindowInfoAsync(window, properties, properties2, callback)) {
+            return;
+        }
+    }
+    // Ensure that the callback is always invoked asynchronously
+    KWindowInfoPrivate *p = createWindowInfo(window, properties, properties2);
+    QTimer::singleShot(0, [p, callback] {
+        callback(p);
+    });
+}
+
 const KWindowSystemPluginWrapper &KWindowSystemPluginWrapper::self()
 {
     return *s_pluginWrapper;
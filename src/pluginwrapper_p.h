@@ -11,6 +11,8 @@
 #include <QScopedPointer>
 #include <QWidgetList> //For WId
 
+#include <functional>
+
 class KWindowEffectsPrivate;
 class KWindowInfoPrivate;
 class KWindowShadowPrivate;
@@ -30,6 +32,11 @@ public:
     KWindowInfoPrivate *createWindowInfo(WId window, NET::Properties properties, NET::Properties2 properties2) const;
     KWindowShadowPrivate *createWindowShadow() const;
     KWindowShadowTilePrivate *createWindowShadowTile() const;
+    QList<KWindowInfoPrivate *> createWindowInfos(const QList<WId> &windows, NET::Properties properties, NET::Properties2 properties2) const;
+    void createWindowInfoAsync(WId window,
+                               NET::Properties properties,
+                               NET::Properties2 properties2,
+                               const std::function<void(KWindowInfoPrivate *)> &callback) const;
 
 private:
     QScopedPointer<KWindowSystemPluginInterface> m_plugin;